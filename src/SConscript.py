@@ -8,7 +8,11 @@ Import('pbaseenv')
 
 list = Split("""
 THcInterface.cxx THcParmList.cxx THcAnalyzer.cxx
-THcHallCSpectrometer.cxx
+THcHallCSpectrometer.cxx THcReconMatrix.cxx THcTrackProjection.cxx THcParmSnapshot.cxx
+THcRunRangeIndex.cxx THcParmUsage.cxx THcCutBatch.cxx
+THcScalerHistory.cxx THcScalerRing.cxx THcOutputMerger.cxx THcEventPipeline.cxx
+THcTaskPool.cxx THcEventIndex.cxx THcReadAhead.cxx
+THcColumnWriter.cxx THcColumnReader.cxx THcRawSkim.cxx
 THcDetectorMap.cxx
 THcRawHit.cxx THcHitList.cxx
 THcSignalHit.cxx
@@ -198,11 +198,24 @@ THaAnalysisObject::EStatus THcAerogel::Init( const TDatime& date )
 
   cout << "THcAerogel::Init " << GetName() << endl;
 
+  // Pedestals are calculated on the first event that is not a pedestal
+  // event, also from the sums restored by a resumed replay
+  fAnalyzePedestals = 1;
+
+  // Nothing to do if the parameters and the detector map are unchanged
+  // since the last successful Init
+  if( fParmUsage.IsUpToDate() ) {
+    fParmUsage.Reuse();
+    return fStatus = kOK;
+  }
+  fParmUsage.Start();
+
   char EngineDID[] = "xAERO";
   EngineDID[0] = toupper(GetApparatus()->GetName()[0]);
   if( gHcDetectorMap->FillMap(fDetMap, EngineDID) < 0 ) {
     static const char* const here = "Init()";
     Error( Here(here), "Error filling detectormap for %s.", EngineDID );
+    fParmUsage.Stop(kFALSE);
     return kInitError;
   }
 
@@ -211,9 +224,12 @@ THaAnalysisObject::EStatus THcAerogel::Init( const TDatime& date )
   InitHitList(fDetMap, "THcAerogelHit", fDetMap->GetTotNumChan()+1);
 
   EStatus status;
-  if( (status = THaNonTrackingDetector::Init( date )) )
+  if( (status = THaNonTrackingDetector::Init( date )) ) {
+    fParmUsage.Stop(kFALSE);
     return fStatus=status;
+  }
 
+  fParmUsage.Stop(kTRUE);
   return fStatus = kOK;
 }
 
@@ -646,6 +662,23 @@ void THcAerogel::InitializePedestals( )
     fNegPedCount[i] = 0;
   }
 
+  // Pedestal sums are run accumulators, saved by replay checkpoints
+  TString base = Form("%caero_", tolower(GetApparatus()->GetName()[0]));
+  gHcParms->DefineAccumulator(base+"ped_events", "Pedestal events",
+			      &fNPedestalEvents, 1);
+  gHcParms->DefineAccumulator(base+"pos_ped_sum", "Pos pedestal sums",
+			      fPosPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"pos_ped_sum2", "Pos pedestal sums of squares",
+			      fPosPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"pos_ped_count", "Pos pedestal counts",
+			      fPosPedCount, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_sum", "Neg pedestal sums",
+			      fNegPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_sum2", "Neg pedestal sums of squares",
+			      fNegPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_count", "Neg pedestal counts",
+			      fNegPedCount, fNelem);
+
   fPosNpe = new Double_t [fNelem];
   fNegNpe = new Double_t [fNelem];
 }
@@ -695,6 +728,8 @@ void THcAerogel::CalculatePedestals( )
   // Use the accumulated pedestal data to calculate pedestals
   // Later add check to see if pedestals have drifted ("Danger Will Robinson!")
   //  cout << "Plane: " << fPlaneNum << endl;
+  if(fNPedestalEvents == 0) return;	// Keep the pedestals of the parameters
+
   for(Int_t i=0; i<fNelem;i++) {
 
     // Positive tubes
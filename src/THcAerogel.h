@@ -11,6 +11,7 @@
 #include "THaNonTrackingDetector.h"
 #include "THcHitList.h"
 #include "THcAerogelHit.h"
+#include "THcParmUsage.h"
 
 class THcAerogel : public THaNonTrackingDetector, public THcHitList {
 
@@ -114,6 +115,8 @@ class THcAerogel : public THaNonTrackingDetector, public THcHitList {
   TClonesArray* frNegAdcPulseInt;
   TClonesArray* frNegAdcPulseAmp;
 
+  THcParmUsage fParmUsage;  //! Parameters read by the last Init
+
   void Setup(const char* name, const char* description);
   virtual void  InitializePedestals( );
 
@@ -16,13 +16,140 @@ the appropriate block defined in the global test/histogram lists.
 Hall C ENGINE style reports are implemented with the PrintReport
 method.  This can be used for generating end of run summary sheets.
 
+With SetEventParallel, Process replays the run with several worker
+processes.  The workers are forked after the parameters have been
+loaded, so that each owns a copy of the apparatus and detectors while
+sharing the calibration data with the others.  Every worker reads the
+whole run.  The physics events are analyzed in blocks of consecutive
+events, each block by the worker that claimed it from a counter shared
+by the workers; the other events (scalers, control events) and the
+pedestal events (SetPedestalEvtype, by default type 4) are analyzed by
+every worker, so that all detectors have their pedestals.  At the end,
+THcOutputMerger writes the event tree entries of all blocks, in event
+order, to the output file.  Histograms are summed over the workers,
+except those filled on the events every worker analyzes, which are
+taken from the last worker, as are the run accumulators filled on them
+(e.g. the pedestal sums).  The run and the
+event counts are those of the last worker, which read the whole run:
+~~~
+     analyzer->SetEventParallel(8);
+     analyzer->Process(run);
+~~~
+SetPartitions instead splits the run into one range of consecutive
+events per worker.  A worker reads the events before its range for
+their scaler, control and pedestal events only, and stops at the end
+of its range.  The ranges and blocks are counted in physics events from
+the first event of the run, with or without the event index.  The run totals (efficiency counters declared with
+THcParmList::AddAccumulator, cut counts) are written by each worker
+with WriteTotals, summed by the merge, and loaded back into gHcParms
+and the cuts, so that PrintReport shows the totals of the whole run.
+With SetMergeReference, the merged output is compared with the output
+of an earlier serial replay.
+With SetPipelined, the raw events are read by a THcEventPipeline on a
+separate thread, overlapping file input with the analysis of earlier
+events.  This only reads ahead: the events are still decoded in the
+event loop, one at a time, into the analyzer's THaEvData.  The time each stage spent waiting for the other is printed at
+the end of the run.
+
+With SetEventIndex, the raw events are read through a THcEventIndex of
+the run file, kept next to it.  Physics events before the first event
+of the run (THaRun::SetEventRange), or other than pedestal events before
+the range of a partition, are then skipped without being read, SelectEventType restricts the events read to some
+types (e.g. physics, scaler and pedestal events), and SetPrescale(n)
+analyzes only every n-th physics event.  SetMappedInput reads the events
+through the index as well, from a memory mapping of the file: the
+decoder and the event type handlers get pointers into the mapping.
+SetReadAhead reads them through the index too, with a THcReadAhead
+thread reading the file ahead into large buffers, and prints the time
+the event loop waited for I/O at the end of the run.
+
+With SetColumnarOutput, the variables, formulas and cuts of the output
+definition file are also written, for every analyzed physics event, to
+a columnar file (see THcColumnWriter), which THcColumnReader reads one
+column at a time without ROOT I/O.
+
+With SetSkim, the raw events of the physics events that pass a cut
+block, together with all pedestal, scaler and control events, are copied
+to a new raw file (see THcRawSkim), which replays like the full run in a
+fraction of the time.
+
+With SetCheckpoint, a serial replay saves its state every few thousand
+events: the output file is brought up to date on disk, and a checkpoint
+file records the position of the next event in the raw file (an entry
+of the event index), the run accumulators of gHcParms (efficiency
+counters, pedestal sums), the checkpoint variables (scaler baselines)
+and the cut counts.  A replay that completes removes its checkpoint, so
+one is left only by a replay that failed, crashed or was killed.  With SetResume,
+the replay continues after that checkpoint with the saved state, and
+its output is appended to the output written up to the checkpoint.  The
+detectors calculate their pedestals from the restored pedestal sums on
+the first event after the checkpoint:
+~~~
+     analyzer->SetCheckpoint("run1234.ckpt");
+     analyzer->SetResume();           // if run1234.ckpt exists
+     analyzer->Process(run);
+~~~
+
+With SetParallelApparatus, the apparatuses (e.g. HMS, SOS and the beam
+line) are decoded and reconstructed concurrently by a THcTaskPool, one
+stage at a time: the tests of a stage still see the results of all
+apparatuses.  Apparatuses that use the results of another one must be
+declared, so that they wait for it in every stage:
+~~~
+     analyzer->SetParallelApparatus(3);
+     analyzer->AddApparatusDependency("H", "RB");   // H after RB
+~~~
+During the event, an apparatus writes only its own state: its hit and
+track TClonesArrays, the data members it registered in gHaVars, and the
+counters and sums it registered in gHcParms (the accumulators such as
+dc_events and the pedestal sums, and hodo_did, hodo_should,
+prune_events and prune_rejected).
+gHaVars and gHcParms themselves are not changed, and the cuts of
+gHaCuts (Pedestal_event) are only read, their stage having been
+evaluated before.  What is shared is ROOT itself: the objects in the
+TClonesArrays are constructed through TClass, and Form and TString use
+ROOT's buffers, so ROOT's thread safety is enabled
+(ROOT::EnableThreadSafety, or TThread::Initialize before ROOT 6) when
+the first pool is set up.
+
 \author S. A. Wood,  13-March-2012
 
 */
 #include "THcAnalyzer.h"
+#include "THcOutputMerger.h"
+#include "THcEventPipeline.h"
+#include "THcEventIndex.h"
+#include "THcReadAhead.h"
+#include "THcColumnWriter.h"
+#include "THcRawSkim.h"
+#include "THcTaskPool.h"
+#include "THaApparatus.h"
+#include "THaSpectrometer.h"
+#include "THaPhysicsModule.h"
 #include "THaRunBase.h"
+#include "THaRun.h"
+#include "THaEvData.h"
+#include "THaCodaData.h"
+#include "THaCut.h"
+#include "THaCutList.h"
+#include "THaVar.h"
+#include "THaVarList.h"
+#include "THaGlobals.h"
 #include "THaBenchmark.h"
 #include "TList.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TNamed.h"
+#include "TParameter.h"
+#include "TSystem.h"
+#include "TError.h"
+#include "TROOT.h"
+#include "RVersion.h"
+#if ROOT_VERSION_CODE < ROOT_VERSION(6,0,0)
+#include "TThread.h"
+#endif
 #include "THcParmList.h"
 #include "THcFormula.h"
 #include "THcGlobals.h"
@@ -32,7 +159,14 @@ method.  This can be used for generating end of run summary sheets.
 #include <algorithm>
 #include <iomanip>
 #include <cstring>
+#include <cstdio>
 #include <iostream>
+#include <sstream>
+#include <set>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
 
 using namespace std;
 
@@ -40,11 +174,113 @@ using namespace std;
 // Pointer to single instance of this object
 //THcAnalyzer* THcAnalyzer::fgAnalyzer = 0;
 
+namespace {
+  // Tree entries of a block of events, in the output of worker input
+  struct WorkerRange {
+    Long64_t block;
+    Int_t    input;
+    Long64_t first, last;
+    bool operator<( const WorkerRange& rhs ) const { return block < rhs.block; }
+  };
+
+  // Gives the driver write access to the counters of a cut, to set the
+  // totals of a parallel replay
+  struct CutCounts : public THaCut {
+    template<typename T>
+    static void Set( THaCut* cut, T THaCut::* member, Double_t value )
+    { cut->*member = static_cast<T>(value); }
+    static void SetCounts( THaCut* cut, Double_t ncalled, Double_t npassed )
+    {
+      Set(cut, &CutCounts::fNCalled, ncalled);
+      Set(cut, &CutCounts::fNPassed, npassed);
+    }
+  };
+
+  // Names of the cuts of a cut definition file, as read by THcCutBatch
+  void GetCutNames( const char* filename, vector<string>& names )
+  {
+    ifstream ifile(filename);
+    string line;
+    while( getline(ifile, line) ) {
+      string::size_type pos = line.find('#');
+      if( pos != string::npos ) line.erase(pos);
+      istringstream is(line);
+      string name;
+      if( (is >> name) && name != "Block:" )
+	names.push_back(name);
+    }
+  }
+}
+
+namespace {
+  // Position and output tree entries saved by a checkpoint
+  struct Checkpoint {
+    TString  rawfile;
+    Long64_t entry, offset;
+    map<string,Long64_t> trees;
+
+    Bool_t Read( const char* file )
+    {
+      TFile* f = TFile::Open(file);
+      if( !f || f->IsZombie() ) {
+	delete f;
+	return kFALSE;
+      }
+      TNamed* name = dynamic_cast<TNamed*>(f->Get("hcckpt_rawfile"));
+      TParameter<Long64_t>* pentry =
+	dynamic_cast<TParameter<Long64_t>*>(f->Get("hcckpt_entry"));
+      TParameter<Long64_t>* poffset =
+	dynamic_cast<TParameter<Long64_t>*>(f->Get("hcckpt_offset"));
+      Bool_t ok = name && pentry && poffset;
+      if( ok ) {
+	rawfile = name->GetTitle();
+	entry = pentry->GetVal();
+	offset = poffset->GetVal();
+      }
+      trees.clear();
+      TIter next(f->GetListOfKeys());
+      while( TKey* key = static_cast<TKey*>(next()) ) {
+	TString keyname = key->GetName();
+	if( !keyname.BeginsWith("hcckpt_tree_") ) continue;
+	TParameter<Long64_t>* n =
+	  dynamic_cast<TParameter<Long64_t>*>(key->ReadObj());
+	if( n ) trees[keyname(12, keyname.Length()-12).Data()] = n->GetVal();
+	delete n;
+      }
+      delete f;
+      return ok;
+    }
+
+    // Write to file, which must be open for writing
+    void Write( TFile* f ) const
+    {
+      f->cd();
+      TNamed("hcckpt_rawfile", rawfile.Data()).Write(0, TObject::kOverwrite);
+      TParameter<Long64_t>("hcckpt_entry", entry).Write(0, TObject::kOverwrite);
+      TParameter<Long64_t>("hcckpt_offset", offset).Write(0, TObject::kOverwrite);
+      for( map<string,Long64_t>::const_iterator it = trees.begin();
+	   it != trees.end(); ++it ) {
+	TString keyname = "hcckpt_tree_";
+	keyname += it->first.c_str();
+	TParameter<Long64_t>(keyname, it->second).Write(0, TObject::kOverwrite);
+      }
+    }
+  };
+}
+
 //FIXME:
 // do we need to "close" scalers/EPICS analysis if we reach the event limit?
 
 //_____________________________________________________________________________
-THcAnalyzer::THcAnalyzer()
+THcAnalyzer::THcAnalyzer() :
+  fPedestalEvtype(4), fPipelineDepth(0), fPipeline(0), fUseIndex(kFALSE), fMapInput(kFALSE),
+  fReadAheadDepth(0), fReadAheadChunk(4<<20), fPrescale(1),
+  fEventIndex(0), fColumnWriter(0), fSkim(0),
+  fSkimPassed(kFALSE), fCheckpointInterval(10000), fNSinceCheckpoint(0),
+  fResume(kFALSE), fResumed(kFALSE), fFatal(kFALSE), fEntry(-1),
+  fNAppThreads(0), fTaskPool(0), fAppStage(kAppDecode), fNWorkers(0),
+  fBlockSize(1000), fWorker(-1), fPartitioned(kFALSE), fNextBlock(0),
+  fClaimed(-1), fNSeen(0), fIndexPos(0)
 {
 
 }
@@ -54,6 +290,1005 @@ THcAnalyzer::~THcAnalyzer()
 {
   // Destructor.
 
+  delete fPipeline;
+  delete fEventIndex;
+  delete fColumnWriter;
+  delete fSkim;
+  delete fTaskPool;
+}
+
+//_____________________________________________________________________________
+void THcAnalyzer::SetEventParallel( Int_t nworkers, Int_t blocksize )
+{
+  // Use nworkers processes in Process.  0 or 1 means a serial replay.
+
+  fNWorkers = nworkers;
+  fBlockSize = blocksize > 0 ? blocksize : 1;
+  fPartitioned = kFALSE;
+}
+
+//_____________________________________________________________________________
+void THcAnalyzer::SetPartitions( Int_t nworkers, Long64_t nevents )
+{
+  // Split the first nevents events of the run among nworkers processes.
+  // The last worker also analyzes any events beyond nevents.
+
+  fNWorkers = nworkers;
+  fBlockSize = nworkers > 0 ? (nevents+nworkers-1)/nworkers : nevents;
+  if( fBlockSize < 1 ) fBlockSize = 1;
+  fPartitioned = kTRUE;
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::Process( THaRunBase* run )
+{
+  // Replay run, serially or with the workers set by SetEventParallel.
+  // In the latter case, returns the result of the first worker's replay.
+
+  if( fNWorkers > 1 && !fColumnFile.IsNull() ) {
+    Warning("THcAnalyzer::Process", "Columnar output is written by serial "
+	    "replays only. Not writing %s.", fColumnFile.Data());
+    fColumnFile = "";
+  }
+  if( fNWorkers > 1 && !fSkimFile.IsNull() ) {
+    Warning("THcAnalyzer::Process", "Raw skims are written by serial "
+	    "replays only. Not writing %s.", fSkimFile.Data());
+    fSkimFile = "";
+  }
+  if( fNWorkers > 1 && !fCheckpointFile.IsNull() ) {
+    Warning("THcAnalyzer::Process", "Checkpoints are written by serial "
+	    "replays only. Not writing %s.", fCheckpointFile.Data());
+    fCheckpointFile = "";
+  }
+  if( fNWorkers <= 1 || fWorker >= 0 ) {
+    fNSinceCheckpoint = 0;
+    fResumed = kFALSE;
+    fFatal = kFALSE;
+    if( !fCheckpointFile.IsNull() ) {
+      if( fResume ) {
+	if( !PrepareResume() ) return -1;
+      } else {
+	// Output of an earlier, unfinished replay
+	gSystem->Unlink(fOutFileName + ".part");
+      }
+    }
+    Int_t ret = THaAnalyzer::Process(run);
+    if( fPipeline ) {
+      fPipeline->Stop();
+      fPipeline->Print();
+      delete fPipeline;
+      fPipeline = 0;
+    }
+    if( fEventIndex ) {
+      fEventIndex->Close();
+      if( fEventIndex->GetReadAhead() )
+	fEventIndex->GetReadAhead()->Print();
+    }
+    delete fEventIndex;
+    fEventIndex = 0;
+    if( fColumnWriter ) {
+      if( !fColumnWriter->Close() ) ret = -1;
+      cout << fColumnFile << ": " << fColumnWriter->GetNEvents()
+	   << " events, " << fColumnWriter->GetNColumns() << " columns, "
+	   << fColumnWriter->GetNBytes() << " bytes" << endl;
+      delete fColumnWriter;
+      fColumnWriter = 0;
+    }
+    if( fSkim ) {
+      if( !fSkim->Close() ) ret = -1;
+      cout << fSkimFile << ": " << fSkim->GetNPassed() << " of "
+	   << fSkim->GetNPhysics() << " physics events passed " << fSkimBlock
+	   << ", " << fSkim->GetNWritten() << " of " << fSkim->GetNEvents()
+	   << " events written" << endl;
+      delete fSkim;
+      fSkim = 0;
+    }
+    if( fResumed && !FinishResume() )
+      ret = -1;
+    fResumed = kFALSE;
+    // The replay ended, so there is nothing to resume.  A replay that
+    // failed keeps its checkpoint, to be resumed from.
+    if( !fCheckpointFile.IsNull() && ret >= 0 && !fFatal )
+      gSystem->Unlink(fCheckpointFile);
+    delete fTaskPool;
+    fTaskPool = 0;
+    return ret;
+  }
+
+  // Shared with the workers: the next block, and the result, events read
+  // and events analyzed of each worker
+  size_t memsize = (3*fNWorkers+1)*sizeof(Long64_t);
+  void* mem = mmap(0, memsize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS,
+		   -1, 0);
+  if( mem == MAP_FAILED ) {
+    Error("THcAnalyzer::Process", "Cannot set up event-parallel replay");
+    return -1;
+  }
+  fNextBlock = static_cast<Long64_t*>(mem);
+  Long64_t* results = fNextBlock+1;
+  Long64_t* nread = results+fNWorkers;
+  Long64_t* nanalyzed = nread+fNWorkers;
+  *fNextBlock = 0;
+
+  cout.flush();
+  fflush(0);
+  TString outfile = fOutFileName;
+  vector<pid_t> pids;
+  for( Int_t i = 0; i < fNWorkers; i++ ) {
+    pid_t pid = fork();
+    if( pid == 0 ) {
+      fWorker = i;
+      fOutFileName = outfile + Form(".w%d", i);
+      // The last range is left open: it extends to the end of the tree
+      Int_t ret = Process(run);
+      if( !WriteRanges(fOutFileName + ".idx") || !WriteTotals(fOutFileName) )
+	ret = -1;
+      results[i] = ret;
+      nread[i] = fNev;
+      nanalyzed[i] = fRun ? fRun->GetNumAnalyzed() : 0;
+      cout.flush();
+      fflush(0);
+      _exit(ret < 0 ? 1 : 0);
+    }
+    if( pid < 0 ) {
+      Error("THcAnalyzer::Process", "Cannot start worker %d", i);
+      break;
+    }
+    pids.push_back(pid);
+  }
+  Bool_t ok = ((Int_t)pids.size() == fNWorkers);
+  for( UInt_t i = 0; i < pids.size(); i++ ) {
+    int status;
+    if( waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) ||
+	WEXITSTATUS(status) != 0 ) {
+      Error("THcAnalyzer::Process", "Worker %d failed", i);
+      ok = kFALSE;
+    }
+  }
+
+  // Ordered output: the event tree entries of every block, taken from
+  // the worker that analyzed it
+  Int_t ret = ok ? static_cast<Int_t>(results[0]) : -1;
+  if( ok ) {
+    THcOutputMerger merger(outfile);
+    // The last worker has seen all scaler events
+    merger.SetPrimary(fNWorkers-1);
+    vector<WorkerRange> blocks;
+    for( Int_t i = 0; i < fNWorkers; i++ ) {
+      TString file = outfile + Form(".w%d", i);
+      WorkerRange range;
+      range.input = merger.AddInput(file);
+      ifstream idx((file + ".idx").Data());
+      string line;
+      while( getline(idx, line) ) {
+	istringstream is(line);
+	string tag, name;
+	if( line.compare(0, 5, "hist ") == 0 ) {
+	  if( is >> tag >> name )
+	    merger.SetUnsummed(name.c_str());
+	} else if( is >> range.block >> range.first >> range.last ) {
+	  blocks.push_back(range);
+	}
+      }
+    }
+    sort(blocks.begin(), blocks.end());
+    for( UInt_t k = 0; k < blocks.size(); k++ )
+      merger.AddRange(blocks[k].input, blocks[k].first, blocks[k].last);
+    if( merger.Merge() < 0 || !LoadTotals(outfile) )
+      ret = -1;
+    else if( !fMergeReference.IsNull() && merger.Verify(fMergeReference) != 0 )
+      ret = -1;
+  }
+  // The run and event counts of the replay, as in a serial one, for
+  // PrintReport.  The last worker has read all events.
+  if( ok && run ) {
+    if( run != fRun ) {
+      delete fRun;
+      fRun = static_cast<THaRunBase*>(run->Clone());
+    }
+    Long64_t n = nanalyzed[fNWorkers-1] - fRun->GetNumAnalyzed();
+    if( n > 0 ) fRun->IncrNumAnalyzed(n);
+    fNev = nread[fNWorkers-1];
+  }
+  for( Int_t i = 0; i < fNWorkers; i++ ) {
+    TString file = outfile + Form(".w%d", i);
+    gSystem->Unlink(file);
+    gSystem->Unlink(file + ".idx");
+  }
+  munmap(mem, memsize);
+  fNextBlock = 0;
+  return ret;
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::MainAnalysis()
+{
+  // In an event-parallel worker, skip the physics events of blocks
+  // claimed by other workers.  A partition worker stops after its block.
+  // A serial replay with a skim copies the events the skim keeps, and
+  // one with checkpoints writes them after every interval events.
+
+  if( fWorker < 0 && fSkimFile.IsNull() && fCheckpointFile.IsNull() )
+    return THaAnalyzer::MainAnalysis();
+  if( fWorker < 0 ) {
+    if( !fSkimFile.IsNull() && !fSkim ) {
+      fSkim = new THcRawSkim;
+      fSkim->SetBlock(fSkimBlock);
+      // A replay of the skim needs the pedestal events
+      if( fPedestalEvtype >= 0 )
+	fSkim->KeepEventType(fPedestalEvtype);
+      for( UInt_t i = 0; i < fSkimTypes.size(); i++ )
+	fSkim->KeepEventType(fSkimTypes[i]);
+      if( !fSkim->Open(fSkimFile) ) {
+	fFatal = kTRUE;
+	return kFatal;
+      }
+    }
+    fSkimPassed = kFALSE;
+    Int_t ret = THaAnalyzer::MainAnalysis();
+    if( ret == kFatal ) {
+      fFatal = kTRUE;
+      return ret;
+    }
+    // Copy the raw event if the skim keeps it
+    if( fSkim && !fSkim->Write(fEvData->GetRawDataBuffer(), fSkimPassed) ) {
+      fFatal = kTRUE;
+      return kFatal;
+    }
+    // The event is complete: its output has been filled
+    if( !fCheckpointFile.IsNull() && fCheckpointInterval > 0 &&
+	++fNSinceCheckpoint >= fCheckpointInterval ) {
+      fNSinceCheckpoint = 0;
+      if( !WriteCheckpoint() ) {
+	fFatal = kTRUE;
+	return kFatal;
+      }
+    }
+    return ret;
+  }
+
+  // Blocks are numbered by the physics events since the first event of
+  // the run.  Through the event index, ReadIndexedEvent counts them,
+  // including those it skips.
+  if( !fEvData->IsPhysicsTrigger() )
+    return WorkerAnalysis();
+  Long64_t block = (fEventIndex ? fNSeen : fNSeen++) / fBlockSize;
+  if( fPartitioned ) {
+    // Block k belongs to worker k, the last worker taking the rest
+    if( block >= fNWorkers ) block = fNWorkers-1;
+    if( block > fWorker ) {
+      CloseRange();
+      return kTerminate;
+    }
+    if( block == fWorker && fRanges.empty() ) {
+      // The earlier events are counted by the workers that own them
+      vector<THaCut*> cuts;
+      GetTotals(fTotalsBase, cuts);
+    }
+    fClaimed = fWorker;
+  } else if( block > fClaimed ) {
+    // Blocks are claimed in increasing order, so the claim is never
+    // behind the events this worker has seen
+    CloseRange();
+    fClaimed = __atomic_fetch_add(fNextBlock, 1, __ATOMIC_RELAXED);
+  }
+  if( block == fClaimed ) {
+    if( fRanges.empty() || fRanges.back().block != block ) {
+      Range_t range;
+      range.block = block;
+      range.first = GetNEntries();
+      range.last = -1;
+      fRanges.push_back(range);
+    }
+    return WorkerAnalysis();
+  }
+  // Every worker needs the pedestals of the detectors
+  if( IsPedestalEvent() )
+    return WorkerAnalysis(kFALSE);
+  return kSkip;
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::IsPedestalEvent() const
+{
+  // True for the pedestal events (SetPedestalEvtype), from which the
+  // detectors take their pedestals
+
+  return fEvData->GetEvType() == fPedestalEvtype;
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::WorkerAnalysis( Bool_t owned )
+{
+  // Analyze an event in a worker.  Pedestal events and events other than
+  // physics events are analyzed by every worker, so the histograms and
+  // run accumulators (e.g. pedestal sums) they fill are recorded, for the
+  // merge to take them from one worker instead of summing them.  The cut
+  // counts of the events of blocks the worker does not own are left to
+  // the owner.
+
+  if( fEvData->IsPhysicsTrigger() && !IsPedestalEvent() )
+    return THaAnalyzer::MainAnalysis();
+
+  vector< pair<TH1*,Double_t> > hists;
+  if( fFile ) {
+    TIter next(fFile->GetList());
+    while( TObject* obj = next() ) {
+      if( TH1* hist = dynamic_cast<TH1*>(obj) )
+	hists.push_back(make_pair(hist, hist->GetEntries()));
+    }
+  }
+  const vector<string>& acc = gHcParms->GetAccumulators();
+  vector< vector<Double_t> > accvalues(acc.size());
+  for( UInt_t i = 0; i < acc.size(); i++ ) {
+    if( THaVar* var = gHcParms->Find(acc[i].c_str()) )
+      for( Int_t k = 0; k < var->GetLen(); k++ )
+	accvalues[i].push_back(var->GetValue(k));
+  }
+  vector< pair<Double_t,Double_t> > counts;
+  if( !owned ) {
+    if( fWorkerCuts.empty() ) {
+      Totals_t totals;
+      GetTotals(totals, fWorkerCuts);
+    }
+    for( UInt_t k = 0; k < fWorkerCuts.size(); k++ )
+      counts.push_back(make_pair((Double_t)fWorkerCuts[k]->GetNCalled(),
+				 (Double_t)fWorkerCuts[k]->GetNPassed()));
+  }
+
+  Int_t ret = THaAnalyzer::MainAnalysis();
+
+  for( UInt_t i = 0; i < hists.size(); i++ ) {
+    if( hists[i].first->GetEntries() != hists[i].second )
+      fSharedHists.insert(hists[i].first->GetName());
+  }
+  for( UInt_t i = 0; i < acc.size(); i++ ) {
+    THaVar* var = gHcParms->Find(acc[i].c_str());
+    Bool_t changed = !var || var->GetLen() != (Int_t)accvalues[i].size();
+    for( Int_t k = 0; !changed && k < var->GetLen(); k++ )
+      changed = (var->GetValue(k) != accvalues[i][k]);
+    if( changed )
+      fSharedHists.insert("hcacc_" + acc[i]);
+  }
+  for( UInt_t k = 0; k < counts.size(); k++ )
+    CutCounts::SetCounts(fWorkerCuts[k], counts[k].first, counts[k].second);
+  return ret;
+}
+
+//_____________________________________________________________________________
+void THcAnalyzer::AddApparatusDependency( const char* app, const char* before )
+{
+  fAppDeps.push_back(make_pair(TString(app), TString(before)));
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::InitTaskPool()
+{
+  // Set up the apparatus tasks and their dependencies
+
+  // The apparatuses construct hits and tracks in their TClonesArrays
+  // on the threads of the pool
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,0,0)
+  ROOT::EnableThreadSafety();
+#else
+  TThread::Initialize();
+#endif
+
+  fAppTasks.clear();
+  TIter next(fApps);
+  while( THaApparatus* app = static_cast<THaApparatus*>(next()) )
+    fAppTasks.push_back(app);
+
+  Int_t ntasks = fAppTasks.size();
+  vector< vector<Int_t> > after(ntasks);
+  for( UInt_t k = 0; k < fAppDeps.size(); k++ ) {
+    Int_t iapp = -1, ibefore = -1;
+    for( Int_t i = 0; i < ntasks; i++ ) {
+      if( fAppDeps[k].first == fAppTasks[i]->GetName() ) iapp = i;
+      if( fAppDeps[k].second == fAppTasks[i]->GetName() ) ibefore = i;
+    }
+    if( iapp < 0 || ibefore < 0 ) {
+      Warning("THcAnalyzer::InitTaskPool", "Ignoring dependency of %s on %s: "
+	      "no such apparatus", fAppDeps[k].first.Data(),
+	      fAppDeps[k].second.Data());
+      continue;
+    }
+    after[iapp].push_back(ibefore);
+  }
+
+  fTaskPool = new THcTaskPool(TMath::Min(fNAppThreads, ntasks));
+  if( !fTaskPool->SetGraph(after) ) {
+    Error("THcAnalyzer::InitTaskPool", "Apparatus dependencies contain "
+	  "a cycle. Reconstructing apparatuses one after another.");
+    delete fTaskPool;
+    fTaskPool = 0;
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcAnalyzer::AppTask( void* analyzer, Int_t task )
+{
+  // Run the current stage for one apparatus
+
+  THcAnalyzer* self = static_cast<THcAnalyzer*>(analyzer);
+  THaApparatus* app = self->fAppTasks[task];
+  THaSpectrometer* spectro = dynamic_cast<THaSpectrometer*>(app);
+  switch( self->fAppStage ) {
+  case kAppDecode:
+    app->Clear();
+    app->Decode(*self->fEvData);
+    break;
+  case kAppCoarseTrack:
+    if( spectro ) spectro->CoarseTrack();
+    break;
+  case kAppCoarseRecon:
+    app->CoarseReconstruct();
+    break;
+  case kAppTrack:
+    if( spectro ) spectro->Track();
+    break;
+  case kAppReconstruct:
+    app->Reconstruct();
+    break;
+  }
+}
+
+//_____________________________________________________________________________
+void THcAnalyzer::RunAppStage( Int_t stage )
+{
+  fAppStage = stage;
+  fTaskPool->Run(AppTask, this);
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::PhysicsAnalysis( Int_t code )
+{
+  // Analysis of physics events, followed by the skim decision and the
+  // columnar output of the events that pass
+
+  code = AnalyzePhysics(code);
+  if( code == kSkip || code == kFatal )
+    return code;
+  if( fSkim )
+    fSkimPassed = fSkim->Passes();
+  if( fColumnFile.IsNull() )
+    return code;
+
+  if( !fColumnWriter ) {
+    const char* odef = fColumnOdef.IsNull() ? fOdefFileName.Data()
+      : fColumnOdef.Data();
+    fColumnWriter = new THcColumnWriter;
+    if( !fColumnWriter->Open(fColumnFile) ||
+	fColumnWriter->Define(odef, gHaVars) < 0 )
+      return kFatal;
+  }
+  if( !fColumnWriter->Fill() )
+    return kFatal;
+  return code;
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::AnalyzePhysics( Int_t code )
+{
+  // Same stages as THaAnalyzer::PhysicsAnalysis, with the apparatuses of
+  // each stage processed concurrently if so requested.
+
+  if( fNAppThreads <= 0 )
+    return THaAnalyzer::PhysicsAnalysis(code);
+  if( !fTaskPool && !InitTaskPool() ) {
+    fNAppThreads = 0;
+    return THaAnalyzer::PhysicsAnalysis(code);
+  }
+
+  //=== Decoding ===
+  if( fDoBench ) fBench->Begin("Decode");
+  RunAppStage(kAppDecode);
+  if( fDoBench ) fBench->Stop("Decode");
+  if( !EvalStage(kDecode) ) return kSkip;
+
+  //=== Coarse processing ===
+  if( fDoBench ) fBench->Begin("CoarseTracking");
+  RunAppStage(kAppCoarseTrack);
+  if( fDoBench ) fBench->Stop("CoarseTracking");
+  if( !EvalStage(kCoarseTrack) ) return kSkip;
+
+  if( fDoBench ) fBench->Begin("CoarseReconstruct");
+  RunAppStage(kAppCoarseRecon);
+  if( fDoBench ) fBench->Stop("CoarseReconstruct");
+  if( !EvalStage(kCoarseRecon) ) return kSkip;
+
+  //=== Tracking ===
+  if( fDoBench ) fBench->Begin("Tracking");
+  RunAppStage(kAppTrack);
+  if( fDoBench ) fBench->Stop("Tracking");
+  if( !EvalStage(kTracking) ) return kSkip;
+
+  //=== Reconstruction ===
+  if( fDoBench ) fBench->Begin("Reconstruct");
+  RunAppStage(kAppReconstruct);
+  if( fDoBench ) fBench->Stop("Reconstruct");
+  if( !EvalStage(kReconstruct) ) return kSkip;
+
+  //=== Physics ===
+  // Physics modules combine apparatuses and run one after another
+  if( fDoBench ) fBench->Begin("Physics");
+  TIter next_physics(fPhysics);
+  while( THaPhysicsModule* theModule =
+	 static_cast<THaPhysicsModule*>(next_physics()) ) {
+    theModule->Clear();
+    Int_t err = theModule->Process(*fEvData);
+    if( err == THaPhysicsModule::kTerminate )
+      code = kTerminate;
+    else if( err == THaPhysicsModule::kFatal ) {
+      code = kFatal;
+      break;
+    }
+  }
+  if( fDoBench ) fBench->Stop("Physics");
+  if( code == kFatal ) return kFatal;
+  if( !EvalStage(kPhysics) ) return kSkip;
+
+  return code;
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::ReadOneEvent( THaRunBase* run, THaEvData* evdata )
+{
+  // In pipelined mode, take the next raw event from the reader thread
+  // and raw-decode it.  The event index takes precedence.
+
+  if( fUseIndex || fMapInput || fReadAheadDepth > 0 ||
+      !fCheckpointFile.IsNull() )
+    return ReadIndexedEvent(run, evdata);
+  if( fPipelineDepth <= 0 )
+    return THaAnalyzer::ReadOneEvent(run, evdata);
+
+  if( !fPipeline ) {
+    THaRun* coda_run = dynamic_cast<THaRun*>(run);
+    if( !coda_run ) {
+      Warning("THcAnalyzer::ReadOneEvent", "Pipelined input needs a CODA "
+	      "file run. Reading events in the event loop.");
+      fPipelineDepth = 0;
+      return THaAnalyzer::ReadOneEvent(run, evdata);
+    }
+    fPipeline = new THcEventPipeline(fPipelineDepth);
+    if( !fPipeline->Start(coda_run->GetFilename()) ) {
+      delete fPipeline;
+      fPipeline = 0;
+      return THaRunBase::READ_FATAL;
+    }
+  }
+
+  Int_t status;
+  const UInt_t* buffer = fPipeline->Next(status);
+  if( !buffer ) {
+    if( status == CODA_EOF )   return THaRunBase::READ_EOF;
+    if( status == CODA_FATAL ) return THaRunBase::READ_FATAL;
+    return THaRunBase::READ_ERROR;
+  }
+  return LoadRawEvent(evdata, buffer);
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::ReadIndexedEvent( THaRunBase* run, THaEvData* evdata )
+{
+  // Read the next selected event through the event index of the run
+
+  if( !fEventIndex ) {
+    THaRun* coda_run = dynamic_cast<THaRun*>(run);
+    if( !coda_run ) {
+      Warning("THcAnalyzer::ReadIndexedEvent", "The event index needs a "
+	      "CODA file run. Reading all events, without checkpoints.");
+      fUseIndex = fMapInput = kFALSE;
+      fReadAheadDepth = 0;
+      fCheckpointFile = "";
+      return ReadOneEvent(run, evdata);
+    }
+    fEventIndex = new THcEventIndex;
+    if( !fEventIndex->Open(coda_run->GetFilename()) ) {
+      delete fEventIndex;
+      fEventIndex = 0;
+      return THaRunBase::READ_FATAL;
+    }
+    // A mapped file is read ahead by the kernel already
+    if( !(fMapInput && fEventIndex->Map()) && fReadAheadDepth > 0 )
+      fEventIndex->SetReadAhead(fReadAheadDepth, fReadAheadChunk);
+    for( UInt_t i = 0; i < fIndexTypes.size(); i++ )
+      fEventIndex->SelectEventType(fIndexTypes[i]);
+    fEventIndex->SetPrescale(fPrescale);
+    Long64_t start = fEventIndex->FindEvent(run->GetFirstEvent());
+    fEventIndex->SetStart(start);
+    fIndexPos = start;
+    fNSeen = 0;
+    if( fResumed ) {
+      // Continue after the checkpoint, with the run state saved there
+      Checkpoint ckpt;
+      if( !ckpt.Read(fCheckpointFile) ) {
+	Error("THcAnalyzer::ReadIndexedEvent", "Cannot read checkpoint %s",
+	      fCheckpointFile.Data());
+	return THaRunBase::READ_FATAL;
+      }
+      Long64_t n = fEventIndex->GetNEntries();
+      if( ckpt.rawfile != coda_run->GetFilename() || ckpt.entry > n ||
+	  (ckpt.entry < n &&
+	   fEventIndex->GetEntry(ckpt.entry).offset != ckpt.offset) ) {
+	Error("THcAnalyzer::ReadIndexedEvent", "Checkpoint %s is not one of "
+	      "this run", fCheckpointFile.Data());
+	return THaRunBase::READ_FATAL;
+      }
+      if( !LoadTotals(fCheckpointFile) )
+	return THaRunBase::READ_FATAL;
+      fEventIndex->Seek(ckpt.entry);
+      cout << "Resuming " << ckpt.rawfile << " at event " << ckpt.entry
+	   << " of " << n << endl;
+    }
+  }
+
+  Long64_t entry;
+  while( (entry = fEventIndex->Next()) >= 0 ) {
+    if( fWorker < 0 ) break;
+    // Number the physics events of a parallel replay as MainAnalysis
+    // does without the index: fNSeen physics events precede this one
+    for( ; fIndexPos < entry; fIndexPos++ ) {
+      if( THcEventIndex::IsPhysics(fEventIndex->GetEntry(fIndexPos).evtype) )
+	fNSeen++;
+    }
+    // A partition worker reads only the pedestal events of the physics
+    // events before its range
+    UInt_t evtype = fEventIndex->GetEntry(entry).evtype;
+    if( !fPartitioned || fNSeen >= (Long64_t)fWorker*fBlockSize ||
+	!THcEventIndex::IsPhysics(evtype) || (Int_t)evtype == fPedestalEvtype )
+      break;
+  }
+  if( entry < 0 )
+    return THaRunBase::READ_EOF;
+  fEntry = entry;
+  // The decoder keeps the pointer; the event stays in place until the
+  // next one is read
+  const UInt_t* buffer = fEventIndex->GetEvent(entry, fEventBuffer);
+  if( !buffer )
+    return THaRunBase::READ_ERROR;
+  return LoadRawEvent(evdata, buffer);
+}
+
+//_____________________________________________________________________________
+Int_t THcAnalyzer::LoadRawEvent( THaEvData* evdata, const UInt_t* buffer )
+{
+  // Raw-decode an event read by THcAnalyzer itself
+
+  switch( evdata->LoadEvent(buffer) ) {
+  case THaEvData::HED_OK:
+  case THaEvData::HED_WARN:
+    return THaRunBase::READ_OK;
+  case THaEvData::HED_FATAL:
+    return THaRunBase::READ_FATAL;
+  default:
+    return THaRunBase::READ_ERROR;
+  }
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::BuildEventIndex( const char* rawfile )
+{
+  // Build the event index of rawfile, for replays with SetEventIndex
+
+  THcEventIndex index;
+  if( !index.Open(rawfile, kFALSE) ) return kFALSE;
+  string name = THcEventIndex::GetIndexName(rawfile);
+  if( !index.Save(name.c_str()) ) {
+    Error("THcAnalyzer::BuildEventIndex", "Cannot write %s", name.c_str());
+    return kFALSE;
+  }
+  cout << name << ": " << index.GetNEntries() << " events" << endl;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Long64_t THcAnalyzer::GetNEntries() const
+{
+  // Entries in the event tree so far
+
+  TTree* tree = fFile ? dynamic_cast<TTree*>(fFile->Get("T")) : 0;
+  return tree ? tree->GetEntries() : 0;
+}
+
+//_____________________________________________________________________________
+void THcAnalyzer::CloseRange()
+{
+  // End the event tree range of the block being analyzed
+
+  if( !fRanges.empty() && fRanges.back().last < 0 )
+    fRanges.back().last = GetNEntries();
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::WriteRanges( const char* file ) const
+{
+  // Write the blocks analyzed by this worker and their tree entries,
+  // followed by the histograms filled on events every worker analyzes
+
+  ofstream ofile(file);
+  for( UInt_t i = 0; i < fRanges.size(); i++ )
+    ofile << fRanges[i].block << " " << fRanges[i].first << " "
+	  << fRanges[i].last << endl;
+  for( set<string>::const_iterator it = fSharedHists.begin();
+       it != fSharedHists.end(); ++it )
+    ofile << "hist " << *it << endl;
+  return ofile.good();
+}
+
+//_____________________________________________________________________________
+void THcAnalyzer::GetTotals( Totals_t& totals, vector<THaCut*>& cuts,
+			     Bool_t state ) const
+{
+  // Current values of the accumulators registered with gHcParms, as
+  // hcacc_<name>, and the counts of the cuts of the cut definition file,
+  // as hccut_ncalled and hccut_npassed.  With state, also the values of
+  // the checkpoint variables, as hcvar_<name>.
+
+  totals.clear();
+  const vector<string>& acc = gHcParms->GetAccumulators();
+  const vector<string>& vars = gHcParms->GetCheckpointVariables();
+  UInt_t nvars = acc.size() + (state ? vars.size() : 0);
+  for( UInt_t i = 0; i < nvars; i++ ) {
+    Bool_t isacc = (i < acc.size());
+    const string& name = isacc ? acc[i] : vars[i-acc.size()];
+    THaVar* var = gHcParms->Find(name.c_str());
+    if( !var ) continue;
+    vector<Double_t>& values = totals[(isacc ? "hcacc_" : "hcvar_") + name];
+    for( Int_t k = 0; k < var->GetLen(); k++ )
+      values.push_back(var->GetValue(k));
+  }
+
+  cuts.clear();
+  vector<string> names;
+  if( !fCutFileName.IsNull() )
+    GetCutNames(fCutFileName, names);
+  for( UInt_t i = 0; i < names.size(); i++ )
+    if( THaCut* cut = gHaCuts->FindCut(names[i].c_str()) )
+      cuts.push_back(cut);
+  if( cuts.empty() ) return;
+  vector<Double_t>& ncalled = totals["hccut_ncalled"];
+  vector<Double_t>& npassed = totals["hccut_npassed"];
+  for( UInt_t k = 0; k < cuts.size(); k++ ) {
+    ncalled.push_back(cuts[k]->GetNCalled());
+    npassed.push_back(cuts[k]->GetNPassed());
+  }
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::WriteTotals( const char* file, Bool_t state ) const
+{
+  // Write the totals of GetTotals to file as histograms.  In a partitioned
+  // replay, only the counts of the range of this worker are written.
+
+  TFile* f = TFile::Open(file, "UPDATE");
+  if( !f || f->IsZombie() ) {
+    Error("THcAnalyzer::WriteTotals", "Cannot open %s", file);
+    delete f;
+    return kFALSE;
+  }
+  Totals_t totals;
+  vector<THaCut*> cuts;
+  GetTotals(totals, cuts, state);
+  f->cd();
+  for( Totals_t::const_iterator it = totals.begin(); it != totals.end(); ++it ) {
+    const vector<Double_t>& values = it->second;
+    // Totals taken from one worker (see WorkerAnalysis) are complete
+    Totals_t::const_iterator base = fTotalsBase.end();
+    if( fSharedHists.find(it->first) == fSharedHists.end() )
+      base = fTotalsBase.find(it->first);
+    Int_t n = values.size();
+    TH1D h(it->first.c_str(), it->first.c_str(), n, 0, n);
+    Bool_t iscut = (it->first.compare(0, 6, "hccut_") == 0);
+    for( Int_t k = 0; k < n; k++ ) {
+      Double_t value = values[k];
+      if( base != fTotalsBase.end() && (Int_t)base->second.size() == n )
+	value -= base->second[k];
+      h.SetBinContent(k+1, value);
+      if( iscut ) h.GetXaxis()->SetBinLabel(k+1, cuts[k]->GetName());
+    }
+    h.Write();
+  }
+  f->Close();
+  delete f;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::LoadTotals( const char* file )
+{
+  // Set the accumulators of gHcParms and the cut counts to the totals in
+  // the merged output file or a checkpoint, and the checkpoint variables
+  // to the values in a checkpoint.  The totals are found by their keys in
+  // file.  Those not registered in this process, e.g. in the driver of a
+  // parallel replay, which does not initialize the detectors and cuts,
+  // are defined with the values from file.
+
+  TFile* f = TFile::Open(file);
+  if( !f || f->IsZombie() ) {
+    Error("THcAnalyzer::LoadTotals", "Cannot open %s", file);
+    delete f;
+    return kFALSE;
+  }
+  // Keys are listed highest cycle first
+  set<string> done;
+  TIter next(f->GetListOfKeys());
+  while( TKey* key = static_cast<TKey*>(next()) ) {
+    TString keyname = key->GetName();
+    Bool_t isacc = keyname.BeginsWith("hcacc_");
+    if( (!isacc && !keyname.BeginsWith("hcvar_")) ||
+	!done.insert(keyname.Data()).second )
+      continue;
+    TH1* h = dynamic_cast<TH1*>(key->ReadObj());
+    if( !h ) continue;
+    TString name = keyname(6, keyname.Length()-6);
+    Int_t n = h->GetNbinsX();
+    THaVar* var = gHcParms->Find(name);
+    if( !var ) {
+      Double_t* values = new Double_t[n];
+      if( n > 1 )
+	gHcParms->Define(Form("%s[%d]", name.Data(), n), "Run total", *values);
+      else
+	gHcParms->Define(name, "Run total", *values);
+      if( isacc ) gHcParms->AddAccumulator(name);
+      var = gHcParms->Find(name);
+    }
+    if( !var || (var->GetType() != kInt && var->GetType() != kDouble) ||
+	var->GetLen() != n ) {
+      Warning("THcAnalyzer::LoadTotals", "Cannot set %s", name.Data());
+      delete h;
+      continue;
+    }
+    void* value = const_cast<void*>(var->GetValuePointer());
+    for( Int_t k = 0; k < n; k++ ) {
+      if( var->GetType() == kInt )
+	static_cast<Int_t*>(value)[k] = TMath::Nint(h->GetBinContent(k+1));
+      else
+	static_cast<Double_t*>(value)[k] = h->GetBinContent(k+1);
+    }
+    delete h;
+  }
+
+  TH1* ncalled = dynamic_cast<TH1*>(f->Get("hccut_ncalled"));
+  TH1* npassed = dynamic_cast<TH1*>(f->Get("hccut_npassed"));
+  if( ncalled && npassed && gHaCuts ) {
+    for( Int_t k = 1; k <= ncalled->GetNbinsX(); k++ ) {
+      const char* name = ncalled->GetXaxis()->GetBinLabel(k);
+      THaCut* cut = gHaCuts->FindCut(name);
+      if( !cut ) {
+	// Holds the counts only; it is never evaluated here
+	gHaCuts->Define(name, "1");
+	cut = gHaCuts->FindCut(name);
+      }
+      if( cut )
+	CutCounts::SetCounts(cut, ncalled->GetBinContent(k),
+			     npassed->GetBinContent(k));
+    }
+  }
+  delete f;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::WriteCheckpoint()
+{
+  // Save the output file and the state of the replay after the current
+  // event.  The checkpoint file is replaced only once complete.
+
+  if( !fFile || !fEventIndex ) return kFALSE;
+  TDirectory* dir = gDirectory;
+  Checkpoint ckpt;
+  ckpt.rawfile = fEventIndex->GetFileName();
+  ckpt.entry = fEntry+1;
+  ckpt.offset = (ckpt.entry < fEventIndex->GetNEntries()) ?
+    fEventIndex->GetEntry(ckpt.entry).offset : -1;
+
+  // The trees up to the current event, and the histograms as they are
+  TIter next(fFile->GetList());
+  while( TObject* obj = next() ) {
+    if( TTree* tree = dynamic_cast<TTree*>(obj) ) {
+      tree->AutoSave("SaveSelf");
+      ckpt.trees[tree->GetName()] = tree->GetEntries();
+    } else if( obj->InheritsFrom("TH1") ) {
+      fFile->cd();
+      obj->Write(0, TObject::kOverwrite);
+    }
+  }
+  fFile->SaveSelf();
+
+  TString tmp = fCheckpointFile + ".tmp";
+  gSystem->Unlink(tmp);
+  Bool_t ok = WriteTotals(tmp, kTRUE);
+  if( ok ) {
+    TFile* f = TFile::Open(tmp, "UPDATE");
+    ok = f && !f->IsZombie();
+    if( ok ) {
+      ckpt.Write(f);
+      f->Close();
+    }
+    delete f;
+  }
+  ok = ok && gSystem->Rename(tmp, fCheckpointFile) == 0;
+  if( !ok )
+    Error("THcAnalyzer::WriteCheckpoint", "Cannot write checkpoint %s",
+	  fCheckpointFile.Data());
+  if( dir ) dir->cd();
+  return ok;
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::PrepareResume()
+{
+  // Before a resumed replay, move the output written up to the checkpoint
+  // (with that of any earlier resumed replays) to <output>.part.  The
+  // output of this replay is appended to it by FinishResume.
+
+  Checkpoint ckpt;
+  if( !ckpt.Read(fCheckpointFile) ) {
+    Warning("THcAnalyzer::PrepareResume", "No checkpoint %s. Replaying "
+	    "the whole run.", fCheckpointFile.Data());
+    gSystem->Unlink(fOutFileName + ".part");
+    return kTRUE;
+  }
+  TString part = fOutFileName + ".part";
+  THcOutputMerger merger(part + ".new");
+  merger.SetConcatenate();
+  if( !gSystem->AccessPathName(part) )
+    merger.AddInput(part);
+  Int_t last = merger.AddInput(fOutFileName);
+  merger.SetPrimary(last);
+  // Drop what was written after the checkpoint
+  merger.LimitEntries(last, ckpt.trees);
+  if( merger.Merge() < 0 ||
+      gSystem->Rename(part + ".new", part) != 0 ) {
+    Error("THcAnalyzer::PrepareResume", "Cannot keep the output of %s",
+	  fOutFileName.Data());
+    return kFALSE;
+  }
+
+  // The output file now starts empty
+  for( map<string,Long64_t>::iterator it = ckpt.trees.begin();
+       it != ckpt.trees.end(); ++it )
+    it->second = 0;
+  TFile* f = TFile::Open(fCheckpointFile, "UPDATE");
+  if( !f || f->IsZombie() ) {
+    delete f;
+    return kFALSE;
+  }
+  ckpt.Write(f);
+  f->Close();
+  delete f;
+
+  if( !fSkimFile.IsNull() || !fColumnFile.IsNull() )
+    Warning("THcAnalyzer::PrepareResume", "The skim and columnar output "
+	    "hold the events after the checkpoint only");
+  fResumed = kTRUE;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcAnalyzer::FinishResume()
+{
+  // Append the output of this replay to the output up to the checkpoint
+
+  Close();
+  TString part = fOutFileName + ".part";
+  THcOutputMerger merger(fOutFileName + ".new");
+  merger.SetConcatenate();
+  merger.AddInput(part);
+  merger.SetPrimary(merger.AddInput(fOutFileName));
+  if( merger.Merge() < 0 ||
+      gSystem->Rename(fOutFileName + ".new", fOutFileName) != 0 ) {
+    Error("THcAnalyzer::FinishResume", "Cannot append the output to %s. "
+	  "The output up to the checkpoint is in %s", fOutFileName.Data(),
+	  part.Data());
+    return kFALSE;
+  }
+  gSystem->Unlink(part);
+  return kTRUE;
 }
 
 //_____________________________________________________________________________
@@ -71,6 +1306,11 @@ void THcAnalyzer::PrintReport(const char* templatefile, const char* ofile)
     return;
   }
 
+  if(!fRun) {
+    cout << "Error: no run analyzed for report " << ofile << endl;
+    return;
+  }
+
   ofstream ostr(ofile);
 
   if(!ostr.is_open()) {
@@ -108,7 +1348,9 @@ void THcAnalyzer::PrintReport(const char* templatefile, const char* ofile)
 	if(format.empty()) format = "%s";
 	replacement=Form(format.c_str(),textstring);
       } else {
-	THcFormula* formula = new THcFormula("temp",expression.c_str(),gHcParms,gHaVars,gHaCuts);
+	// Compiled formulas are cached, so repeated expressions and
+	// reports are parsed only once
+	THcFormula* formula = THcFormula::Get(expression.c_str(),gHcParms,gHaVars,gHaCuts);
 	Double_t value=formula->Eval();
 	// If the value is close to integer and no format is defined
 	// use "%.0f" to print out integer
@@ -8,6 +8,20 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include "THaAnalyzer.h"
+#include "TString.h"
+#include <vector>
+#include <utility>
+#include <map>
+#include <set>
+#include <string>
+
+class THcEventPipeline;
+class THcEventIndex;
+class THcColumnWriter;
+class THcRawSkim;
+class THcTaskPool;
+class THaApparatus;
+class THaCut;
 
 class THcAnalyzer : public THaAnalyzer {
 
@@ -20,10 +34,166 @@ public:
 
   void PrintReport( const char* templatefile, const char* ofile);
 
+  // Replay with nworkers processes, each analyzing the physics events of
+  // the blocks of blocksize events it claims
+  void SetEventParallel( Int_t nworkers, Int_t blocksize = 1000 );
+  // Replay with nworkers processes, worker k analyzing the k-th of
+  // nworkers consecutive ranges of the nevents events of the run
+  void SetPartitions( Int_t nworkers, Long64_t nevents );
+  // After a parallel replay, compare the merged output with file, e.g.
+  // the output of a serial replay of the same run
+  void SetMergeReference( const char* file ) { fMergeReference = file; }
+  // Write the run totals (accumulators of gHcParms, cut counts) to file
+  // as histograms, which a merge of partial replays sums.  With state,
+  // also the checkpoint variables of gHcParms.
+  Bool_t WriteTotals( const char* file, Bool_t state = kFALSE ) const;
+
+  // Every interval events, save the output file and the state of the
+  // replay (position in the raw file, run accumulators, cut counts,
+  // scaler baselines) to checkpoint file file.  Reads the raw events
+  // through the event index.  Serial replays only.
+  void SetCheckpoint( const char* file, Long64_t interval = 10000 )
+  { fCheckpointFile = file; fCheckpointInterval = interval; }
+  // Continue a replay that did not end from its last checkpoint,
+  // appending to its output file
+  void SetResume( Bool_t resume = kTRUE ) { fResume = resume; }
+
+  // Read raw events on a separate thread, up to depth events ahead of
+  // the analysis.  0 reads them in the event loop.  Read-ahead only;
+  // decoding is not pipelined.
+  void SetPipelined( Int_t depth = 64 ) { fPipelineDepth = depth; }
+
+  // Read raw events through the event index of the run (see
+  // THcEventIndex), selecting event types and physics events
+  void SetEventIndex( Bool_t use = kTRUE ) { fUseIndex = use; }
+  // Read only events of the selected types (and control events).  No
+  // selection reads all events.
+  void SelectEventType( Int_t evtype ) { fIndexTypes.push_back(evtype); }
+  // Analyze only every n-th physics event
+  void SetPrescale( Int_t n ) { fPrescale = n; }
+  // Read raw events through the event index from a memory mapping of
+  // the run file, without copying them
+  void SetMappedInput( Bool_t map = kTRUE ) { fMapInput = map; }
+  // Read raw events through the event index with a background thread
+  // reading the run file ahead into depth buffers of chunksize bytes.
+  // 0 reads them in the event loop.
+  void SetReadAhead( Int_t depth = 8, Int_t chunksize = 4<<20 )
+  { fReadAheadDepth = depth; fReadAheadChunk = chunksize; }
+  // Build the event index of a raw CODA file and save it next to the file
+  static Bool_t BuildEventIndex( const char* rawfile );
+
+  // Also write the output variables, formulas and cuts of output
+  // definition file odef (by default, that of the tree output) to file
+  // in the columnar format of THcColumnWriter.  Serial replays only.
+  void SetColumnarOutput( const char* file, const char* odef = 0 )
+  { fColumnFile = file; fColumnOdef = odef ? odef : ""; }
+
+  // Write the raw events that pass the cut block block, and all pedestal,
+  // scaler and control events, to the raw file file (see THcRawSkim).
+  // Serial replays only.
+  void SetSkim( const char* file, const char* block )
+  { fSkimFile = file; fSkimBlock = block; }
+  // Also keep all events of type evtype in the skim
+  void SkimEventType( Int_t evtype ) { fSkimTypes.push_back(evtype); }
+
+  // Reconstruct the apparatuses of an event concurrently, with nthreads
+  // threads.  0 reconstructs them one after another.
+  void SetParallelApparatus( Int_t nthreads ) { fNAppThreads = nthreads; }
+  // Apparatus app must be processed after apparatus before, in every stage
+  void AddApparatusDependency( const char* app, const char* before );
+
+  virtual Int_t Process( THaRunBase* run=NULL );
+
 protected:
 
+  virtual Int_t MainAnalysis();
+  virtual Int_t ReadOneEvent( THaRunBase* run, THaEvData* evdata );
+  virtual Int_t PhysicsAnalysis( Int_t code );
+
   Int_t fPedestalEvtype;
 
+  Int_t fPipelineDepth;          // Events read ahead, or 0
+  THcEventPipeline* fPipeline;   //! Raw event input of the current run
+
+  Bool_t  fUseIndex;             // Read events through the event index
+  Bool_t  fMapInput;             // Read them from a mapping of the file
+  Int_t   fReadAheadDepth;       // Buffers read ahead, or 0
+  Int_t   fReadAheadChunk;       // Bytes per read-ahead buffer
+  std::vector<Int_t> fIndexTypes;  // Event types to read, or all if empty
+  Int_t   fPrescale;             // Physics events analyzed 1 in fPrescale
+  THcEventIndex* fEventIndex;    //! Event index of the current run
+  std::vector<UInt_t> fEventBuffer;  //! Raw event read through the index
+
+  TString fColumnFile;           // Columnar output file, or empty
+  TString fColumnOdef;           // Its output definition file
+  THcColumnWriter* fColumnWriter;  //! Writes the columnar output
+
+  TString fSkimFile;             // Raw skim file, or empty
+  TString fSkimBlock;            // Cut block selecting its physics events
+  std::vector<Int_t> fSkimTypes; // Event types kept in full
+  THcRawSkim* fSkim;             //! Writes the skim
+  Bool_t  fSkimPassed;           // Current event passed the skim block
+
+  // Checkpoints
+  TString  fCheckpointFile;      // Checkpoint file, or empty
+  Long64_t fCheckpointInterval;  // Events between checkpoints
+  Long64_t fNSinceCheckpoint;    // Events since the last one
+  Bool_t   fResume;              // Continue from the checkpoint
+  Bool_t   fResumed;             // This replay continues from it
+  Bool_t   fFatal;               // The replay ended on a fatal error
+  Long64_t fEntry;               // Index entry of the current event
+
+  Bool_t  WriteCheckpoint();
+  Bool_t  PrepareResume();
+  Bool_t  FinishResume();
+
+  Int_t   AnalyzePhysics( Int_t code );
+  Int_t   ReadIndexedEvent( THaRunBase* run, THaEvData* evdata );
+  Int_t   LoadRawEvent( THaEvData* evdata, const UInt_t* buffer );
+
+  // Concurrent apparatus reconstruction
+  enum EAppStage { kAppDecode, kAppCoarseTrack, kAppCoarseRecon, kAppTrack,
+		   kAppReconstruct };
+  Int_t        fNAppThreads;     // Threads, or 0
+  std::vector< std::pair<TString,TString> > fAppDeps;  //! (app, before)
+  THcTaskPool* fTaskPool;        //! Runs the apparatus tasks
+  std::vector<THaApparatus*> fAppTasks;  //! Apparatus of each task
+  Int_t        fAppStage;        // Stage being run (EAppStage)
+
+  Bool_t       InitTaskPool();
+  void         RunAppStage( Int_t stage );
+  static void  AppTask( void* analyzer, Int_t task );
+
+  // Event-parallel replay
+  struct Range_t {
+    Long64_t block;          // Block of events
+    Long64_t first, last;    // Entries of the event tree filled for it
+  };
+  Int_t     fNWorkers;       // Number of worker processes, or 0
+  Int_t     fBlockSize;      // Events per block
+  Int_t     fWorker;         // Index of this worker, or -1 in the driver
+  Bool_t    fPartitioned;    // Worker k analyzes block k only
+  TString   fMergeReference; // Output to verify the merged output against
+  typedef std::map< std::string, std::vector<Double_t> > Totals_t;
+  Totals_t  fTotalsBase;     //! Totals when the range of this worker began
+  Long64_t* fNextBlock;      //! Next unclaimed block, shared by the workers
+  Long64_t  fClaimed;        // Block last claimed by this worker
+  Long64_t  fNSeen;          // Physics events before the current one
+  Long64_t  fIndexPos;       // Next index entry counted into fNSeen
+  std::vector<Range_t> fRanges;  //! Blocks analyzed by this worker
+  std::set<std::string> fSharedHists;  //! Histograms and totals filled on
+                                       //! events every worker analyzes
+  std::vector<THaCut*> fWorkerCuts;    //! Cuts whose counts are merged
+
+  Long64_t GetNEntries() const;
+  Int_t    WorkerAnalysis( Bool_t owned = kTRUE );
+  Bool_t   IsPedestalEvent() const;
+  void     CloseRange();
+  Bool_t   WriteRanges( const char* file ) const;
+  void     GetTotals( Totals_t& totals, std::vector<THaCut*>& cuts,
+		      Bool_t state = kFALSE ) const;
+  Bool_t   LoadTotals( const char* file );
+
 private:
   //  THcAnalyzer( const THcAnalyzer& );
   //  THcAnalyzer& operator=( const THcAnalyzer& );
@@ -18,6 +18,7 @@ Class for an Cherenkov detector consisting of two PMT's
 #include "THcParmList.h"
 #include "THcHitList.h"
 #include "THaApparatus.h"
+#include "THcHallCSpectrometer.h"
 #include "VarDef.h"
 #include "VarType.h"
 #include "THaTrack.h"
@@ -143,11 +144,24 @@ THaAnalysisObject::EStatus THcCherenkov::Init( const TDatime& date )
 {
   cout << "THcCherenkov::Init " << GetName() << endl;
 
+  // Pedestals are calculated on the first event that is not a pedestal
+  // event, also from the sums restored by a resumed replay
+  fAnalyzePedestals = 1;
+
+  // Nothing to do if the parameters and the detector map are unchanged
+  // since the last successful Init
+  if( fParmUsage.IsUpToDate() ) {
+    fParmUsage.Reuse();
+    return fStatus = kOK;
+  }
+  fParmUsage.Start();
+
   string EngineDID = string(GetApparatus()->GetName()).substr(0, 1) + GetName();
   std::transform(EngineDID.begin(), EngineDID.end(), EngineDID.begin(), ::toupper);
   if( gHcDetectorMap->FillMap(fDetMap, EngineDID.c_str()) < 0 ) {
     static const char* const here = "Init()";
     Error(Here(here), "Error filling detectormap for %s.", EngineDID.c_str());
+    fParmUsage.Stop(kFALSE);
     return kInitError;
   }
 
@@ -156,9 +170,12 @@ THaAnalysisObject::EStatus THcCherenkov::Init( const TDatime& date )
   InitHitList(fDetMap, "THcCherenkovHit", fDetMap->GetTotNumChan()+1);
 
   EStatus status;
-  if( (status = THaNonTrackingDetector::Init( date )) )
+  if( (status = THaNonTrackingDetector::Init( date )) ) {
+    fParmUsage.Stop(kFALSE);
     return fStatus=status;
+  }
 
+  fParmUsage.Stop(kTRUE);
   return fStatus = kOK;
 }
 
@@ -230,6 +247,10 @@ Int_t THcCherenkov::ReadDatabase( const TDatime& date )
 
   gHcParms->LoadParmValues((DBRequest*)&list,prefix.c_str());
 
+  // Tracks are projected to the mirror by the spectrometer
+  THcHallCSpectrometer *app = static_cast<THcHallCSpectrometer*>(GetApparatus());
+  fCerMirrorProj = app->AddProjectionPlane(fCerMirrorZPos);
+
   fIsInit = true;
 
 
@@ -439,8 +460,12 @@ Int_t THcCherenkov::FineProcess( TClonesArray& tracks )
 	 ( ( theTrack->GetEnergy() / theTrack->GetP() ) < fCerETMax )
 	 ) {
 
-      Double_t cerX = theTrack->GetX() + theTrack->GetTheta() * fCerMirrorZPos;
-      Double_t cerY = theTrack->GetY() + theTrack->GetPhi()   * fCerMirrorZPos;
+      THcHallCSpectrometer *app = static_cast<THcHallCSpectrometer*>(GetApparatus());
+      const THcTrackProjection* proj = app->GetTrackProjection();
+      Int_t itrack = proj->GetTrackIndex( theTrack );
+      if ( itrack < 0 ) return -1;
+      Double_t cerX = proj->GetX( itrack, fCerMirrorProj );
+      Double_t cerY = proj->GetY( itrack, fCerMirrorProj );
 
       for ( Int_t ir = 0; ir < fCerNRegions; ir++ ) {
 
@@ -488,6 +513,17 @@ void THcCherenkov::InitializePedestals( )
     fPedCount[i] = 0;
   }
 
+  // Pedestal sums are run accumulators, saved by replay checkpoints
+  TString base = Form("%c%s_", tolower(GetApparatus()->GetName()[0]), GetName());
+  base.ToLower();
+  gHcParms->DefineAccumulator(base+"ped_events", "Pedestal events",
+			      &fNPedestalEvents, 1);
+  gHcParms->DefineAccumulator(base+"ped_sum", "Pedestal sums",
+			      fPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"ped_sum2", "Pedestal sums of squares",
+			      fPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"ped_count", "Pedestal counts",
+			      fPedCount, fNelem);
 }
 
 //_____________________________________________________________________________
@@ -526,6 +562,8 @@ void THcCherenkov::CalculatePedestals( )
   // Use the accumulated pedestal data to calculate pedestals
   // Later add check to see if pedestals have drifted ("Danger Will Robinson!")
   //  cout << "Plane: " << fPlaneNum << endl;
+  if(fNPedestalEvents == 0) return;	// Keep the pedestals of the parameters
+
   for(Int_t i=0; i<fNelem;i++) {
 
     // PMT tubes
@@ -11,6 +11,7 @@
 #include "THaNonTrackingDetector.h"
 #include "THcHitList.h"
 #include "THcCherenkovHit.h"
+#include "THcParmUsage.h"
 
 class THcCherenkov : public THaNonTrackingDetector, public THcHitList {
 
@@ -65,6 +66,7 @@ class THcCherenkov : public THaNonTrackingDetector, public THcHitList {
   Double_t         fCerETMin;
   Double_t         fCerETMax;
   Double_t         fCerMirrorZPos;
+  Int_t            fCerMirrorProj;       // Spectrometer projection plane of mirror
   Int_t            fCerNRegions;
   Int_t            fCerRegionsValueMax;
   Int_t*           fCerTrackCounter;     // [fCerNRegions] Array of Cher regions
@@ -94,6 +96,8 @@ class THcCherenkov : public THaNonTrackingDetector, public THcHitList {
   TClonesArray* frAdcPulseInt;
   TClonesArray* frAdcPulseAmp;
 
+  THcParmUsage fParmUsage;  //! Parameters read by the last Init
+
   void Setup(const char* name, const char* description);
   virtual void  InitializePedestals( );
 
@@ -0,0 +1,175 @@
+/** \class THcColumnReader
+    \ingroup Base
+
+ Reader of the columnar output of THcColumnWriter.
+
+ Open reads the column directory at the end of the file.  ReadColumn
+ and ReadChunk then read and decompress only the blocks of the
+ requested column.  For a variable size array, the values of an event
+ follow from the running sum of its Ndata.<name> count column:
+~~~
+     THcColumnReader reader;
+     reader.Open("run1234.hcc");
+     std::vector<Double_t> x;
+     reader.ReadColumn(reader.FindColumn("H.gold.dp"), x);
+~~~
+
+*/
+
+#include "THcColumnReader.h"
+#include "TError.h"
+#include "RZip.h"
+
+#include <cstring>
+
+using namespace std;
+
+//_____________________________________________________________________________
+THcColumnReader::THcColumnReader() : fFile(0), fNEvents(0)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+THcColumnReader::~THcColumnReader()
+{
+  // Destructor
+
+  Close();
+}
+
+//_____________________________________________________________________________
+void THcColumnReader::Close()
+{
+  if( fFile ) fclose(fFile);
+  fFile = 0;
+  fNames.clear();
+  fCountCols.clear();
+  fChunkEvents.clear();
+  fBlocks.clear();
+  fNEvents = 0;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnReader::Read( void* data, size_t n )
+{
+  return n == 0 || fread(data, 1, n, fFile) == n;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnReader::Open( const char* file )
+{
+  Close();
+  fFile = fopen(file, "rb");
+  if( !fFile ) {
+    Error("THcColumnReader::Open", "Cannot open %s", file);
+    return kFALSE;
+  }
+  char magic[8], endmagic[8];
+  Long64_t dir = 0;
+  Bool_t ok = Read(magic, 8) &&
+    memcmp(magic, THcColumnWriter::kMagic, 8) == 0 &&
+    fseeko(fFile, -16, SEEK_END) == 0 &&
+    Read(&dir, sizeof(dir)) && Read(endmagic, 8) &&
+    memcmp(endmagic, THcColumnWriter::kEndMagic, 8) == 0 &&
+    fseeko(fFile, dir, SEEK_SET) == 0;
+  UInt_t ncol = 0, nchunks = 0;
+  ok = ok && Read(&ncol, sizeof(ncol));
+  for( UInt_t i = 0; i < ncol && ok; i++ ) {
+    UInt_t len = 0;
+    Int_t countcol = -1;
+    ok = Read(&len, sizeof(len)) && len < 65536;
+    string name(ok ? len : 0, ' ');
+    ok = ok && Read(&name[0], len) && Read(&countcol, sizeof(countcol));
+    fNames.push_back(name);
+    fCountCols.push_back(countcol);
+  }
+  ok = ok && Read(&nchunks, sizeof(nchunks));
+  for( UInt_t k = 0; k < nchunks && ok; k++ ) {
+    Long64_t nevents = 0;
+    ok = Read(&nevents, sizeof(nevents));
+    fChunkEvents.push_back(nevents);
+    fNEvents += nevents;
+    for( UInt_t i = 0; i < ncol && ok; i++ ) {
+      Block_t block;
+      ok = Read(&block.offset, sizeof(block.offset)) &&
+	Read(&block.nbytes, sizeof(block.nbytes)) &&
+	Read(&block.nvalues, sizeof(block.nvalues)) &&
+	Read(&block.codec, sizeof(block.codec));
+      fBlocks.push_back(block);
+    }
+  }
+  if( !ok ) {
+    Error("THcColumnReader::Open", "%s is not a complete columnar file",
+	  file);
+    Close();
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Int_t THcColumnReader::FindColumn( const char* name ) const
+{
+  for( UInt_t i = 0; i < fNames.size(); i++ )
+    if( fNames[i] == name ) return i;
+  return -1;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnReader::ReadChunk( Int_t col, Int_t chunk,
+				   vector<Double_t>& values )
+{
+  values.clear();
+  if( !fFile || col < 0 || col >= GetNColumns() || chunk < 0 ||
+      chunk >= GetNChunks() )
+    return kFALSE;
+  const Block_t& block = fBlocks[chunk*fNames.size()+col];
+  values.resize(block.nvalues);
+  if( block.nvalues == 0 ) return kTRUE;
+  UInt_t nbytes = block.nvalues*sizeof(Double_t);
+  char* out = reinterpret_cast<char*>(&values[0]);
+  if( fseeko(fFile, block.offset, SEEK_SET) != 0 )
+    return kFALSE;
+  if( block.codec == THcColumnWriter::kRaw )
+    return block.nbytes == nbytes && Read(out, nbytes);
+  if( block.codec != THcColumnWriter::kShuffleZip )
+    return kFALSE;
+
+  // Decompress the pieces, then undo the byte grouping
+  fZip.resize(block.nbytes);
+  fWork.resize(nbytes);
+  if( !Read(&fZip[0], block.nbytes) ) return kFALSE;
+  UInt_t pos = 0, nout = 0;
+  while( pos < block.nbytes && nout < nbytes ) {
+    Int_t srcsize = 0, tgtsize = 0, irep = 0;
+    if( block.nbytes-pos < 9 ||
+	R__unzip_header(&srcsize, (UChar_t*)&fZip[pos], &tgtsize) != 0 ||
+	(UInt_t)srcsize > block.nbytes-pos || (UInt_t)tgtsize > nbytes-nout )
+      return kFALSE;
+    R__unzip(&srcsize, (UChar_t*)&fZip[pos], &tgtsize, (UChar_t*)&fWork[nout],
+	     &irep);
+    if( irep != tgtsize ) return kFALSE;
+    pos += srcsize;
+    nout += tgtsize;
+  }
+  if( nout != nbytes ) return kFALSE;
+  for( UInt_t k = 0; k < sizeof(Double_t); k++ ) {
+    const char* plane = &fWork[k*block.nvalues];
+    for( UInt_t i = 0; i < block.nvalues; i++ )
+      out[i*sizeof(Double_t)+k] = plane[i];
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnReader::ReadColumn( Int_t col, vector<Double_t>& values )
+{
+  values.clear();
+  vector<Double_t> chunk;
+  for( Int_t k = 0; k < GetNChunks(); k++ ) {
+    if( !ReadChunk(col, k, chunk) ) return kFALSE;
+    values.insert(values.end(), chunk.begin(), chunk.end());
+  }
+  return kTRUE;
+}
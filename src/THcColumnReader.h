@@ -0,0 +1,60 @@
+#ifndef ROOT_THcColumnReader
+#define ROOT_THcColumnReader
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcColumnReader
+//
+// Reads the columnar files of THcColumnWriter, one column at a time.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "THcColumnWriter.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class THcColumnReader {
+
+public:
+  THcColumnReader();
+  ~THcColumnReader();
+
+  // Read the column directory of file
+  Bool_t   Open( const char* file );
+  void     Close();
+
+  Int_t    GetNColumns() const { return fNames.size(); }
+  const char* GetColumnName( Int_t col ) const { return fNames[col].c_str(); }
+  // Index of the column name, or -1
+  Int_t    FindColumn( const char* name ) const;
+  // Column of the array lengths of col, or -1 for scalars
+  Int_t    GetCountColumn( Int_t col ) const { return fCountCols[col]; }
+  Long64_t GetNEvents() const { return fNEvents; }
+  Int_t    GetNChunks() const { return fChunkEvents.size(); }
+  Long64_t GetChunkEvents( Int_t chunk ) const { return fChunkEvents[chunk]; }
+
+  // Replace values by the values of column col in chunk
+  Bool_t   ReadChunk( Int_t col, Int_t chunk, std::vector<Double_t>& values );
+  // Replace values by all values of column col
+  Bool_t   ReadColumn( Int_t col, std::vector<Double_t>& values );
+
+protected:
+  typedef THcColumnWriter::Block_t Block_t;
+
+  FILE*    fFile;
+  std::vector<std::string> fNames;
+  std::vector<Int_t>       fCountCols;
+  std::vector<Long64_t>    fChunkEvents;
+  std::vector<Block_t>     fBlocks;      // [chunk*ncolumns+col]
+  Long64_t fNEvents;
+  std::vector<char> fWork, fZip;
+
+  Bool_t   Read( void* data, size_t n );
+
+private:
+  THcColumnReader( const THcColumnReader& );
+  THcColumnReader& operator=( const THcColumnReader& );
+};
+
+#endif
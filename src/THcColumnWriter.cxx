@@ -0,0 +1,320 @@
+/** \class THcColumnWriter
+    \ingroup Base
+
+ Columnar output of analysis variables.
+
+ Each output variable becomes a column of Double_t values.  A variable
+ size array is stored as the concatenation of its values over the
+ events, together with a column Ndata.<name> holding the number of
+ values of each event, as in the ROOT tree output.  Every chunksize
+ events, the values of each column are written as one block: the bytes
+ of the doubles are regrouped by significance (all first bytes, then
+ all second bytes, ...), which makes the slowly varying high bytes
+ compress well, and compressed with the ROOT compression routines.  No
+ dictionary is needed to write or read the files.
+
+ At the end of the file a directory lists the columns and the position
+ of every block, so that THcColumnReader can read just the columns it
+ needs.  The file is written in the byte order of the host.
+
+ THcAnalyzer writes this output with SetColumnarOutput, taking the
+ variables from the output definition file:
+~~~
+     analyzer->SetColumnarOutput("run1234.hcc", "output.def");
+~~~
+ examples/columnbench.C, compiled with ACLiC, compares it with the tree
+ output.
+
+*/
+
+#include "THcColumnWriter.h"
+#include "THcFormula.h"
+#include "THcGlobals.h"
+#include "THaGlobals.h"
+#include "THaVar.h"
+#include "THaVarList.h"
+#include "TRegexp.h"
+#include "TString.h"
+#include "TError.h"
+#include "TMath.h"
+#include "RZip.h"
+
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+const char* const THcColumnWriter::kMagic = "HCCOLS01";
+const char* const THcColumnWriter::kEndMagic = "HCCOLEND";
+
+namespace {
+  // Largest piece R__zip compresses at once
+  const Int_t kMaxPiece = 0xff0000;
+}
+
+//_____________________________________________________________________________
+THcColumnWriter::THcColumnWriter( Int_t chunksize, Int_t compress ) :
+  fFile(0), fChunkSize(chunksize > 0 ? chunksize : 1), fCompress(compress),
+  fNInChunk(0), fNEvents(0), fNBytes(0)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+THcColumnWriter::~THcColumnWriter()
+{
+  // Destructor
+
+  Close();
+  for( UInt_t i = 0; i < fSources.size(); i++ )
+    delete fSources[i].formula;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnWriter::Open( const char* file )
+{
+  Close();
+  fFile = fopen(file, "wb");
+  if( !fFile ) {
+    Error("THcColumnWriter::Open", "Cannot create %s", file);
+    return kFALSE;
+  }
+  fNEvents = fNBytes = 0;
+  fNInChunk = 0;
+  fChunkEvents.clear();
+  return Write(kMagic, 8);
+}
+
+//_____________________________________________________________________________
+Int_t THcColumnWriter::AddColumn( const string& name, Int_t countcol )
+{
+  Column_t column;
+  column.name = name;
+  column.countcol = countcol;
+  column.values.reserve(fChunkSize);
+  fColumns.push_back(column);
+  return fColumns.size()-1;
+}
+
+//_____________________________________________________________________________
+Int_t THcColumnWriter::AddVariable( const THaVar* var )
+{
+  // Add var, unless it is there already
+
+  for( UInt_t i = 0; i < fSources.size(); i++ )
+    if( fSources[i].var == var ) return fSources[i].column;
+
+  Source_t source;
+  source.var = var;
+  source.formula = 0;
+  source.countcol = -1;
+  if( var->IsArray() )
+    source.countcol = AddColumn(string("Ndata.") + var->GetName(), -1);
+  source.column = AddColumn(var->GetName(), source.countcol);
+  fSources.push_back(source);
+  return source.column;
+}
+
+//_____________________________________________________________________________
+Int_t THcColumnWriter::AddFormula( const char* name, const char* expression )
+{
+  // Add a formula or cut.  Returns the column, or -1 if expression is
+  // invalid.
+
+  THcFormula* formula = new THcFormula(name, expression, gHcParms, gHaVars,
+				       gHaCuts);
+  if( formula->IsError() ) {
+    Error("THcColumnWriter::AddFormula", "Invalid expression for %s: %s",
+	  name, expression);
+    delete formula;
+    return -1;
+  }
+  Source_t source;
+  source.var = 0;
+  source.formula = formula;
+  source.countcol = -1;
+  source.column = AddColumn(name, -1);
+  fSources.push_back(source);
+  return source.column;
+}
+
+//_____________________________________________________________________________
+Int_t THcColumnWriter::Define( const char* odeffile, const THaVarList* vars )
+{
+  // Add the columns of output definition file odeffile
+
+  ifstream ifile(odeffile);
+  if( !ifile.is_open() ) {
+    Error("THcColumnWriter::Define", "Cannot open output definition "
+	  "file %s", odeffile);
+    return -1;
+  }
+  string line;
+  while( getline(ifile, line) ) {
+    string::size_type pos = line.find('#');
+    if( pos != string::npos ) line.erase(pos);
+    istringstream is(line);
+    string key, name;
+    if( !(is >> key >> name) ) continue;
+    TString keyword(key.c_str());
+    keyword.ToLower();
+    if( keyword == "variable" ) {
+      const THaVar* var = vars->Find(name.c_str());
+      if( var )
+	AddVariable(var);
+      else
+	Warning("THcColumnWriter::Define", "No such variable %s",
+		name.c_str());
+    } else if( keyword == "block" ) {
+      TRegexp re(name.c_str(), kTRUE);
+      TIter next(vars);
+      while( const THaVar* var = static_cast<const THaVar*>(next()) ) {
+	TString varname(var->GetName());
+	Ssiz_t len = 0;
+	if( varname.Index(re, &len) == 0 && len == varname.Length() )
+	  AddVariable(var);
+      }
+    } else if( keyword == "formula" || keyword == "cut" ) {
+      string expression;
+      getline(is >> ws, expression);
+      if( !expression.empty() )
+	AddFormula(name.c_str(), expression.c_str());
+    }
+  }
+  return fColumns.size();
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnWriter::Fill()
+{
+  // Append the values of the current event
+
+  if( !fFile ) return kFALSE;
+  for( UInt_t i = 0; i < fSources.size(); i++ ) {
+    const Source_t& source = fSources[i];
+    vector<Double_t>& values = fColumns[source.column].values;
+    if( source.formula ) {
+      values.push_back(source.formula->Eval());
+    } else if( source.countcol >= 0 ) {
+      Int_t n = source.var->GetLen();
+      fColumns[source.countcol].values.push_back(n);
+      for( Int_t k = 0; k < n; k++ )
+	values.push_back(source.var->GetValue(k));
+    } else {
+      values.push_back(source.var->GetValue());
+    }
+  }
+  fNEvents++;
+  if( ++fNInChunk >= fChunkSize )
+    return WriteChunk();
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnWriter::Write( const void* data, size_t n )
+{
+  if( n > 0 && fwrite(data, 1, n, fFile) != n ) {
+    Error("THcColumnWriter::Write", "Write error");
+    return kFALSE;
+  }
+  fNBytes += n;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnWriter::WriteBlock( Column_t& column )
+{
+  // Write the values of column in the current chunk
+
+  Block_t block;
+  block.offset = fNBytes;
+  block.nvalues = column.values.size();
+  block.codec = kRaw;
+  Int_t nbytes = block.nvalues*sizeof(Double_t);
+  const char* data = 0;
+  if( nbytes > 0 )
+    data = reinterpret_cast<const char*>(&column.values[0]);
+  if( fCompress > 0 && nbytes > 0 ) {
+    // Group the bytes by significance
+    fWork.resize(nbytes);
+    for( UInt_t k = 0; k < sizeof(Double_t); k++ ) {
+      char* plane = &fWork[k*block.nvalues];
+      for( UInt_t i = 0; i < block.nvalues; i++ )
+	plane[i] = data[i*sizeof(Double_t)+k];
+    }
+    fZip.resize(nbytes);
+    Int_t nzip = 0;
+    for( Int_t pos = 0; pos < nbytes; ) {
+      Int_t srcsize = TMath::Min(nbytes-pos, kMaxPiece);
+      Int_t tgtsize = nbytes-nzip, irep = 0;
+      if( tgtsize > 0 )
+	R__zip(fCompress, &srcsize, &fWork[pos], &tgtsize, &fZip[nzip], &irep);
+      if( irep <= 0 ) {    // Does not compress
+	nzip = -1;
+	break;
+      }
+      nzip += irep;
+      pos += srcsize;
+    }
+    if( nzip > 0 ) {
+      block.codec = kShuffleZip;
+      data = &fZip[0];
+      nbytes = nzip;
+    }
+  }
+  block.nbytes = nbytes;
+  column.blocks.push_back(block);
+  column.values.clear();
+  return Write(data, nbytes);
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnWriter::WriteChunk()
+{
+  // Write the blocks of the current chunk
+
+  if( fNInChunk == 0 ) return kTRUE;
+  Bool_t ok = kTRUE;
+  for( UInt_t i = 0; i < fColumns.size() && ok; i++ )
+    ok = WriteBlock(fColumns[i]);
+  fChunkEvents.push_back(fNInChunk);
+  fNInChunk = 0;
+  return ok;
+}
+
+//_____________________________________________________________________________
+Bool_t THcColumnWriter::Close()
+{
+  // Write the remaining events and the directory:
+  //   ncolumns, per column (name length, name, count column),
+  //   nchunks, per chunk (events, per column Block_t),
+  //   directory offset, kEndMagic
+
+  if( !fFile ) return kFALSE;
+  Bool_t ok = WriteChunk();
+  Long64_t dir = fNBytes;
+  UInt_t ncol = fColumns.size(), nchunks = fChunkEvents.size();
+  ok = ok && Write(&ncol, sizeof(ncol));
+  for( UInt_t i = 0; i < ncol && ok; i++ ) {
+    UInt_t len = fColumns[i].name.size();
+    ok = Write(&len, sizeof(len)) && Write(fColumns[i].name.data(), len) &&
+      Write(&fColumns[i].countcol, sizeof(Int_t));
+  }
+  ok = ok && Write(&nchunks, sizeof(nchunks));
+  for( UInt_t k = 0; k < nchunks && ok; k++ ) {
+    ok = Write(&fChunkEvents[k], sizeof(Long64_t));
+    for( UInt_t i = 0; i < ncol && ok; i++ ) {
+      const Block_t& block = fColumns[i].blocks[k];
+      ok = Write(&block.offset, sizeof(block.offset)) &&
+	Write(&block.nbytes, sizeof(block.nbytes)) &&
+	Write(&block.nvalues, sizeof(block.nvalues)) &&
+	Write(&block.codec, sizeof(block.codec));
+    }
+  }
+  ok = ok && Write(&dir, sizeof(dir)) && Write(kEndMagic, 8);
+  if( fclose(fFile) != 0 ) ok = kFALSE;
+  fFile = 0;
+  for( UInt_t i = 0; i < fColumns.size(); i++ )
+    fColumns[i].blocks.clear();
+  return ok;
+}
@@ -0,0 +1,97 @@
+#ifndef ROOT_THcColumnWriter
+#define ROOT_THcColumnWriter
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcColumnWriter
+//
+// Writes analysis output variables in a chunked, compressed columnar
+// file, as a lightweight alternative to the ROOT tree output.  Read the
+// files with THcColumnReader.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class THaVar;
+class THaVarList;
+class THcFormula;
+
+class THcColumnWriter {
+
+public:
+  // Location of the data of one column in one chunk
+  struct Block_t {
+    Long64_t offset;    // In the file
+    UInt_t   nbytes;    // Stored size
+    UInt_t   nvalues;   // Number of values
+    UInt_t   codec;     // kRaw or kShuffleZip
+  };
+  enum { kRaw = 0, kShuffleZip = 1 };
+  static const char* const kMagic;      // Start of the file
+  static const char* const kEndMagic;   // End of the file
+
+  // chunksize events per chunk, compression level 0 (none) to 9
+  THcColumnWriter( Int_t chunksize = 4096, Int_t compress = 1 );
+  ~THcColumnWriter();
+
+  Bool_t   Open( const char* file );
+  // Add the variables (variable, block) and the formulas and cuts
+  // (formula, cut) of an output definition file.  Other entries, e.g.
+  // histograms, are ignored.  Returns the number of columns, or -1 if
+  // the file cannot be read.
+  Int_t    Define( const char* odeffile, const THaVarList* vars );
+  // Add a column for var, and for arrays the column Ndata.<name> of
+  // their lengths.  Returns the index of the value column.
+  Int_t    AddVariable( const THaVar* var );
+  // Add a column of the values of a formula (THcFormula)
+  Int_t    AddFormula( const char* name, const char* expression );
+
+  // Record the current values of all columns
+  Bool_t   Fill();
+  // Write the last chunk and the column directory
+  Bool_t   Close();
+
+  Int_t    GetNColumns() const { return fColumns.size(); }
+  Long64_t GetNEvents() const  { return fNEvents; }
+  Long64_t GetNBytes() const   { return fNBytes; }
+
+protected:
+  struct Column_t {
+    std::string name;
+    Int_t       countcol;     // Column of the array lengths, or -1
+    std::vector<Double_t> values;   // Of the current chunk
+    std::vector<Block_t>  blocks;   // One per chunk written
+  };
+  struct Source_t {
+    const THaVar* var;
+    THcFormula*   formula;
+    Int_t         column;
+    Int_t         countcol;   // For arrays, or -1
+  };
+
+  FILE*    fFile;
+  Int_t    fChunkSize;
+  Int_t    fCompress;
+  std::vector<Column_t> fColumns;
+  std::vector<Source_t> fSources;
+  std::vector<Long64_t> fChunkEvents;   // Events of each chunk written
+  Int_t    fNInChunk;
+  Long64_t fNEvents;
+  Long64_t fNBytes;                     // Written to the file
+  std::vector<char> fWork, fZip;
+
+  Int_t    AddColumn( const std::string& name, Int_t countcol );
+  Bool_t   WriteChunk();
+  Bool_t   WriteBlock( Column_t& column );
+  Bool_t   Write( const void* data, size_t n );
+
+private:
+  THcColumnWriter( const THcColumnWriter& );
+  THcColumnWriter& operator=( const THcColumnWriter& );
+};
+
+#endif
@@ -0,0 +1,343 @@
+/** \class THcCutBatch
+    \ingroup Base
+
+ Batch evaluation of cuts, for skims and other jobs that need the pass
+ masks of many events rather than the cut results event by event.
+
+ Cuts are added with Define, or from a cut definition file with Load.
+ For every event, Fill records the values the cuts depend on in
+ columnar buffers.  When a block of events is complete, each cut
+ compiled by THcFormula is evaluated for the whole block by
+ THcFormula::EvalBatch.  This requires the cut to depend only on the
+ current event's values of global variables, parameters and other cuts.
+ Other cuts (e.g. using cut scalers or functions of whole arrays) are
+ evaluated event by event in Fill instead.  Either way the results are
+ pass masks for the block, with a pass count and a call count per cut:
+ ~~~
+   THcCutBatch batch(4096);
+   batch.Load("hodtest_cuts.def");
+   Int_t icut = batch.GetIndex("hmsHitsLt");
+   // for each event, after the analysis:
+   if( batch.Fill() ) {
+     const vector<UChar_t>& mask = batch.GetMask(icut);
+     for( Int_t i = 0; i < batch.GetNEvents(); i++ )
+       if( mask[i] ) ...
+   }
+   // at the end
+   batch.Flush();
+ ~~~
+ Names in the expressions are resolved as in THcFormula: parameters
+ (gHcParms), global variables (gHaVars) and the analyzer's cuts (gHaCuts).
+ A name of a cut defined before in the same batch (e.g. earlier in the
+ same cut file, as the block master cuts usually do) refers to that cut
+ instead.  Its value is its pass mask, which is computed first: the
+ cuts are evaluated in the order they were defined.  The block of each
+ cut in a cut file is kept (GetBlock).  An event that lacks an element
+ of a variable-size array used by a cut, or for which the cut is invalid
+ (modulo by zero), fails that cut, as it does when the cut is evaluated
+ event by event.  A cut using that cut only sees it fail, so e.g.
+ `A || B` passes if B does, even if a variable of A is missing.
+
+*/
+
+#include "THcCutBatch.h"
+#include "THcFormula.h"
+#include "THcGlobals.h"
+#include "THcParmList.h"
+#include "THaGlobals.h"
+#include "THaVarList.h"
+#include "THaCutList.h"
+#include "THaCut.h"
+#include "THaVar.h"
+#include "TError.h"
+
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <algorithm>
+
+using namespace std;
+
+//_____________________________________________________________________________
+THcCutBatch::THcCutBatch( Int_t blocksize ) :
+  fBlockSize(blocksize > 0 ? blocksize : 1), fN(0), fNEvents(0),
+  fCutVars(new THaVarList)
+{
+  // Constructor
+
+  fFail.resize(fBlockSize);
+  fResult.resize(fBlockSize);
+}
+
+//_____________________________________________________________________________
+THcCutBatch::~THcCutBatch()
+{
+  // Destructor
+
+  for( UInt_t i = 0; i < fCuts.size(); i++ ) {
+    delete fCuts[i].formula;
+    delete fCuts[i].current;
+  }
+  fCutVars->Delete();
+  delete fCutVars;
+}
+
+//_____________________________________________________________________________
+Int_t THcCutBatch::Define( const char* name, const char* expression,
+			   const char* block )
+{
+  // Add cut name with the given expression.  Returns the index of the cut,
+  // or -1 if the expression cannot be compiled.
+
+  if( GetIndex(name) >= 0 ) {
+    Error("THcCutBatch::Define", "Cut %s already defined", name);
+    return -1;
+  }
+  THcFormula* formula = new THcFormula("batchcut", expression, gHcParms,
+				       gHaVars, gHaCuts, fCutVars);
+  if( formula->IsError() ) {
+    Error("THcCutBatch::Define", "Invalid expression for cut %s: %s",
+	  name, expression);
+    delete formula;
+    return -1;
+  }
+
+  Cut_t cut;
+  cut.name = name;
+  cut.block = block ? block : "";
+  cut.expression = expression;
+  cut.formula = formula;
+  cut.batched = formula->IsBatchable();
+  cut.perevent = kFALSE;
+  cut.current = new Double_t(0.0);
+  cut.var = fCutVars->Define(name, "Batch cut", *cut.current);
+  cut.column = -1;
+  FindReferences(cut.expression, cut.refs);
+  cut.npassed = cut.ncalled = 0;
+  cut.mask.resize(fBlockSize);
+  if( cut.batched ) {
+    // Share the input columns among the cuts.  The cuts of the batch are
+    // columns of their own, filled from their masks.
+    vector<const void*> obj;
+    vector<Int_t> index;
+    formula->GetBatchColumns(obj, index);
+    for( UInt_t k = 0; k < obj.size(); k++ ) {
+      UInt_t c = 0;
+      while( c < fColumns.size() &&
+	     (fColumns[c].obj != obj[k] || fColumns[c].index != index[k]) )
+	c++;
+      if( c == fColumns.size() ) {
+	Column_t column;
+	column.obj = obj[k];
+	column.index = index[k];
+	column.cut = -1;
+	for( UInt_t j = 0; j < fCuts.size(); j++ ) {
+	  if( fCuts[j].var == obj[k] ) {
+	    column.cut = j;
+	    fCuts[j].column = c;
+	  }
+	}
+	column.data.resize(fBlockSize);
+	column.missing.resize(fBlockSize);
+	fColumns.push_back(column);
+      }
+      cut.columns.push_back(c);
+    }
+  } else {
+    // Evaluated event by event, so the cuts it uses must be, too
+    cut.value.resize(fBlockSize);
+    for( UInt_t k = 0; k < cut.refs.size(); k++ )
+      NeedPerEvent(cut.refs[k]);
+  }
+  fCuts.push_back(cut);
+  return fCuts.size()-1;
+}
+
+//_____________________________________________________________________________
+Int_t THcCutBatch::Load( const char* filename )
+{
+  // Add the cuts of a cut definition file, with the block each is in.
+  // Returns the number of cuts added, or -1 if the file cannot be opened.
+
+  ifstream ifile(filename);
+  if( !ifile.is_open() ) {
+    Error("THcCutBatch::Load", "Cannot open cut definition file %s",
+	  filename);
+    return -1;
+  }
+  Int_t ncuts = 0;
+  string line, block;
+  while( getline(ifile, line) ) {
+    string::size_type pos = line.find('#');
+    if( pos != string::npos ) line.erase(pos);
+    istringstream is(line);
+    string name, expression;
+    if( !(is >> name) ) continue;
+    if( name.compare(0,6,"Block:") == 0 ) {
+      // "Block: name" or "Block:name"
+      block = name.substr(6);
+      if( block.empty() ) is >> block;
+      continue;
+    }
+    getline(is >> ws, expression);
+    pos = expression.find_last_not_of(" \t\r");
+    if( pos == string::npos ) continue;
+    expression.erase(pos+1);
+    if( Define(name.c_str(), expression.c_str(), block.c_str()) >= 0 )
+      ncuts++;
+  }
+  return ncuts;
+}
+
+//_____________________________________________________________________________
+void THcCutBatch::FindReferences( const string& expression,
+				  vector<Int_t>& refs ) const
+{
+  // Find the cuts of the batch used in expression
+
+  refs.clear();
+  string::size_type pos = 0, len = expression.length();
+  while( pos < len ) {
+    char c = expression[pos];
+    if( isalpha(c) || c == '_' ) {
+      string::size_type end = pos;
+      while( end < len && (isalnum(expression[end]) || expression[end] == '_' ||
+			   expression[end] == '.' || expression[end] == '$') )
+	end++;
+      Int_t i = GetIndex(expression.substr(pos, end-pos).c_str());
+      if( i >= 0 && find(refs.begin(), refs.end(), i) == refs.end() )
+	refs.push_back(i);
+      pos = end;
+    } else if( isdigit(c) || c == '.' ) {
+      // Number, including an exponent such as 1e5
+      while( pos < len && (isalnum(expression[pos]) || expression[pos] == '.') )
+	pos++;
+    } else {
+      pos++;
+    }
+  }
+}
+
+//_____________________________________________________________________________
+void THcCutBatch::NeedPerEvent( Int_t i )
+{
+  // Have cut i, and the cuts it uses, evaluated in Fill as well
+
+  Cut_t& cut = fCuts[i];
+  if( !cut.batched || cut.perevent ) return;
+  cut.perevent = kTRUE;
+  for( UInt_t k = 0; k < cut.refs.size(); k++ )
+    NeedPerEvent(cut.refs[k]);
+}
+
+//_____________________________________________________________________________
+Int_t THcCutBatch::GetIndex( const char* name ) const
+{
+  // Index of cut name, or -1 if there is no such cut
+
+  for( UInt_t i = 0; i < fCuts.size(); i++ ) {
+    if( fCuts[i].name == name ) return i;
+  }
+  return -1;
+}
+
+//_____________________________________________________________________________
+Bool_t THcCutBatch::Fill()
+{
+  // Record the values of the current event
+
+  for( UInt_t c = 0; c < fColumns.size(); c++ ) {
+    Column_t& column = fColumns[c];
+    if( column.cut >= 0 ) continue;
+    column.missing[fN] = 0;
+    if( column.index < 0 ) {
+      column.data[fN] = static_cast<const THaCut*>(column.obj)->GetResult();
+    } else {
+      const THaVar* var = static_cast<const THaVar*>(column.obj);
+      if( column.index < var->GetLen() ) {
+	column.data[fN] = var->GetValue(column.index);
+      } else {
+	column.data[fN] = 1.0;
+	column.missing[fN] = 1;
+      }
+    }
+  }
+  for( UInt_t i = 0; i < fCuts.size(); i++ ) {
+    Cut_t& cut = fCuts[i];
+    if( cut.batched && !cut.perevent ) continue;
+    Double_t value = cut.formula->Eval();
+    if( cut.formula->IsInvalid() ) value = 0.0;
+    *cut.current = (value != 0.0);
+    if( !cut.batched )
+      cut.value[fN] = value;
+  }
+  if( ++fN < fBlockSize ) return kFALSE;
+  Evaluate();
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Int_t THcCutBatch::Flush()
+{
+  // Evaluate the events filled since the last complete block
+
+  if( fN == 0 ) return 0;
+  Evaluate();
+  return fNEvents;
+}
+
+//_____________________________________________________________________________
+void THcCutBatch::Reset()
+{
+  // Drop pending events and clear the counts
+
+  fN = fNEvents = 0;
+  for( UInt_t i = 0; i < fCuts.size(); i++ )
+    fCuts[i].npassed = fCuts[i].ncalled = 0;
+}
+
+//_____________________________________________________________________________
+void THcCutBatch::Evaluate()
+{
+  // Evaluate all cuts for the fN pending events
+
+  Int_t n = fN;
+  for( UInt_t i = 0; i < fCuts.size(); i++ ) {
+    Cut_t& cut = fCuts[i];
+    const Double_t* result;
+    UChar_t* fail = &fFail[0];
+    for( Int_t j = 0; j < n; j++ ) fail[j] = 0;
+    if( cut.batched ) {
+      fColumnPtr.resize(cut.columns.size());
+      for( UInt_t k = 0; k < cut.columns.size(); k++ ) {
+	const Column_t& column = fColumns[cut.columns[k]];
+	fColumnPtr[k] = &column.data[0];
+	const UChar_t* missing = &column.missing[0];
+	for( Int_t j = 0; j < n; j++ ) fail[j] |= missing[j];
+      }
+      cut.formula->EvalBatch(fColumnPtr.empty() ? 0 : &fColumnPtr[0], n,
+			     &fResult[0], fail);
+      result = &fResult[0];
+    } else {
+      result = &cut.value[0];
+    }
+    UChar_t* mask = &cut.mask[0];
+    Int_t npassed = 0;
+    for( Int_t j = 0; j < n; j++ ) {
+      mask[j] = (result[j] != 0.0) & !fail[j];
+      npassed += mask[j];
+    }
+    cut.npassed += npassed;
+    cut.ncalled += n;
+    if( cut.column >= 0 ) {
+      // Input of the later cuts using this one
+      Column_t& column = fColumns[cut.column];
+      for( Int_t j = 0; j < n; j++ ) {
+	column.data[j] = mask[j];
+	column.missing[j] = 0;
+      }
+    }
+  }
+  fNEvents = n;
+  fN = 0;
+}
@@ -0,0 +1,108 @@
+#ifndef ROOT_THcCutBatch
+#define ROOT_THcCutBatch
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcCutBatch
+//
+// Evaluation of a set of cuts over blocks of events.  The values the cuts
+// depend on are collected event by event into columns, and each cut is
+// then evaluated for the whole block at once.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+
+class THcFormula;
+class THaVar;
+class THaVarList;
+
+class THcCutBatch {
+
+public:
+  THcCutBatch( Int_t blocksize = 1024 );
+  ~THcCutBatch();
+
+  // Add a cut.  Returns its index, or -1 if expression is invalid.
+  // expression may refer to the cuts defined before.  Cuts must be
+  // defined before the first Fill.
+  Int_t  Define( const char* name, const char* expression,
+		 const char* block = "" );
+  // Add all cuts of a cut definition file (*_cuts.def)
+  Int_t  Load( const char* filename );
+
+  // Record the current event.  Returns kTRUE when this completes a block,
+  // whose results are then available from GetMask and GetNEvents.
+  Bool_t Fill();
+  // Evaluate a partially filled block, e.g. at the end of a run.
+  // Returns the number of events evaluated.
+  Int_t  Flush();
+  void   Reset();
+
+  Int_t  GetNCuts() const { return fCuts.size(); }
+  Int_t  GetIndex( const char* name ) const;
+  const char* GetName( Int_t i ) const { return fCuts[i].name.c_str(); }
+  const char* GetBlock( Int_t i ) const { return fCuts[i].block.c_str(); }
+  Bool_t IsBatched( Int_t i ) const { return fCuts[i].batched; }
+
+  // Results of the last evaluated block
+  Int_t  GetNEvents() const { return fNEvents; }
+  const std::vector<UChar_t>& GetMask( Int_t i ) const { return fCuts[i].mask; }
+
+  // Totals since the last Reset
+  Long64_t GetNPassed( Int_t i ) const { return fCuts[i].npassed; }
+  Long64_t GetNCalled( Int_t i ) const { return fCuts[i].ncalled; }
+
+protected:
+
+  struct Cut_t {
+    std::string name;
+    std::string block;
+    std::string expression;
+    THcFormula* formula;
+    Bool_t      batched;        // Evaluated by THcFormula::EvalBatch
+    Bool_t      perevent;       // Also evaluated in Fill, for later cuts
+                                // that are not batched
+    const THaVar* var;          // Name of the cut for later cuts (fCutVars)
+    Double_t*   current;        // Its value in the current event
+    Int_t       column;         // Column holding the pass mask, or -1
+    std::vector<Int_t>    refs;     // Cuts of the batch used
+    std::vector<Int_t>    columns;  // Input columns, for EvalBatch
+    std::vector<Double_t> value;    // Per event values, if not batched
+    std::vector<UChar_t>  mask;     // Pass mask of the last block
+    Long64_t    npassed;
+    Long64_t    ncalled;
+  };
+  // Per event input value shared by the cuts
+  struct Column_t {
+    const void* obj;            // THaVar, or THaCut if index is -1
+    Int_t       index;
+    Int_t       cut;            // Cut of the batch whose mask this is,
+                                // or -1
+    std::vector<Double_t> data;
+    std::vector<UChar_t>  missing;  // Array element absent in event
+  };
+
+  Int_t                 fBlockSize;
+  Int_t                 fN;         // Events filled into the current block
+  Int_t                 fNEvents;   // Events in the last evaluated block
+  std::vector<Cut_t>    fCuts;
+  std::vector<Column_t> fColumns;
+  THaVarList*           fCutVars;   // The cuts, as seen by the formulas
+  std::vector<UChar_t>  fFail;      // Event fails the cut regardless
+  std::vector<const Double_t*> fColumnPtr;
+  std::vector<Double_t> fResult;
+
+  void   Evaluate();
+  void   FindReferences( const std::string& expression,
+			 std::vector<Int_t>& refs ) const;
+  void   NeedPerEvent( Int_t i );
+
+private:
+  THcCutBatch( const THcCutBatch& );
+  THcCutBatch& operator=( const THcCutBatch& );
+};
+
+#endif
@@ -173,6 +173,15 @@ THcDC::THcDC( ) :
 //_____________________________________________________________________________
 THaAnalysisObject::EStatus THcDC::Init( const TDatime& date )
 {
+  // Nothing to do if the parameters and the detector map are unchanged
+  // since the last successful Init.  Reuse resets the efficiency
+  // counters of EffInit, which count per run.
+  if( fParmUsage.IsUpToDate() ) {
+    fParmUsage.Reuse();
+    return fStatus = kOK;
+  }
+  fParmUsage.Start();
+
   // Register the plane objects with the appropriate chambers.
   // Trigger ReadDatabase to load the remaining parameters
   Setup(GetName(), GetTitle());	// Create the subdetectors here
@@ -183,6 +192,7 @@ THaAnalysisObject::EStatus THcDC::Init( const TDatime& date )
   if( gHcDetectorMap->FillMap(fDetMap, EngineDID) < 0 ) {
     static const char* const here = "Init()";
     Error( Here(here), "Error filling detectormap for %s.", EngineDID );
+    fParmUsage.Stop(kFALSE);
     return kInitError;
   }
 
@@ -192,12 +202,15 @@ THaAnalysisObject::EStatus THcDC::Init( const TDatime& date )
 
   EStatus status;
   // This triggers call of ReadDatabase and DefineVariables
-  if( (status = THaTrackingDetector::Init( date )) )
+  if( (status = THaTrackingDetector::Init( date )) ) {
+    fParmUsage.Stop(kFALSE);
     return fStatus=status;
+  }
 
   // Initialize planes and add them to chambers
   for(Int_t ip=0;ip<fNPlanes;ip++) {
     if((status = fPlanes[ip]->Init( date ))) {
+      fParmUsage.Stop(kFALSE);
       return fStatus=status;
     } else {
       Int_t chamber=fNChamber[ip];
@@ -207,6 +220,7 @@ THaAnalysisObject::EStatus THcDC::Init( const TDatime& date )
   // Initialize chambers
   for(UInt_t ic=0;ic<fNChambers;ic++) {
     if((status = fChambers[ic]->Init ( date ))) {
+      fParmUsage.Stop(kFALSE);
       return fStatus=status;
     }
   }
@@ -225,6 +239,7 @@ THaAnalysisObject::EStatus THcDC::Init( const TDatime& date )
   //  };
   //  memcpy( fDataDest, tmp, NDEST*sizeof(DataDest) );
 
+  fParmUsage.Stop(kTRUE);
   return fStatus = kOK;
 }
 
@@ -1096,9 +1111,13 @@ void THcDC::EffInit()
   for(Int_t i=0;i<fNPlanes;i++) {
     fPlaneEvents[i] = 0;
   }
-  gHcParms->Define(Form("%sdc_tot_events",fPrefix),"Total DC Events",fTotEvents);
-  gHcParms->Define(Form("%sdc_cham_hits[%d]",fPrefix,fNChambers),"N events with hits per chamber",*fNChamHits);
-  gHcParms->Define(Form("%sdc_events[%d]",fPrefix,fNPlanes),"N events with hits per plane",*fPlaneEvents);
+  // Replaces the definitions of an earlier Init, whose arrays are gone
+  gHcParms->DefineAccumulator(Form("%sdc_tot_events",fPrefix),"Total DC Events",
+			      &fTotEvents,1);
+  gHcParms->DefineAccumulator(Form("%sdc_cham_hits",fPrefix),"N events with hits per chamber",
+			      fNChamHits,fNChambers);
+  gHcParms->DefineAccumulator(Form("%sdc_events",fPrefix),"N events with hits per plane",
+			      fPlaneEvents,fNPlanes);
 }
 
 //_____________________________________________________________________________
@@ -13,6 +13,7 @@
 #include "THcSpacePoint.h"
 #include "THcDriftChamberPlane.h"
 #include "THcDriftChamber.h"
+#include "THcParmUsage.h"
 #include "TMath.h"
 
 #define NUM_FPRAY 4
@@ -171,6 +172,8 @@ protected:
   void           LinkStubs();
   void           TrackFit();
   Double_t       DpsiFun(Double_t ray[4], Int_t plane);
+  THcParmUsage fParmUsage;  //! Parameters read by the last Init
+
   Int_t          End(THaRunBase* run);
   void           EffInit();
   void           Eff();
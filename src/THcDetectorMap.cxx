@@ -29,7 +29,8 @@ inline static bool IsComment( const string& s, string::size_type pos )
 }
 
 //_____________________________________________________________________________
-THcDetectorMap::THcDetectorMap() : fNchans(0), fNIDs(0)
+THcDetectorMap::THcDetectorMap() : fNchans(0), fNIDs(0), fGeneration(0),
+  fChecksum(0)
 {
 }
 
@@ -413,4 +414,20 @@ void THcDetectorMap::Load(const char *fname)
   }
   cout << endl;
 
+  // Detectors only need to refill their maps if the map has changed
+  ULong64_t checksum = 14695981039346656037ULL;
+  const UChar_t* p = (const UChar_t*) fTable;
+  for(size_t i=0; i < fNchans*sizeof(Channel); i++) {
+    checksum = (checksum ^ p[i]) * 1099511628211ULL;
+  }
+  for(Int_t i=0; i < fNIDs; i++) {
+    for(const char* c = fIDMap[i].name; *c; c++) {
+      checksum = (checksum ^ (UChar_t) *c) * 1099511628211ULL;
+    }
+    checksum = (checksum ^ fIDMap[i].id) * 1099511628211ULL;
+  }
+  if(fGeneration == 0 || checksum != fChecksum) {
+    fChecksum = checksum;
+    fGeneration++;
+  }
 }
@@ -20,6 +20,9 @@ class THcDetectorMap : public TObject {
   virtual void Load(const char *fname);
   virtual Int_t FillMap(THaDetMap* detmap, const char* detectorname);
 
+  // Incremented when Load reads a map that differs from the previous one
+  UInt_t GetGeneration() const { return fGeneration; }
+
   Int_t fNchans;  // Number of hardware channels
 
   struct Channel { // Mapping for one hardware channel
@@ -64,6 +67,9 @@ class THcDetectorMap : public TObject {
 
  protected:
 
+  UInt_t    fGeneration;		// Number of distinct maps loaded
+  ULong64_t fChecksum;		// Checksum of the current map
+
   ClassDef(THcDetectorMap,0); // Map electronics channels to Detector, Plane, Counter, Signal
 };
 #endif
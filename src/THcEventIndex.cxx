@@ -0,0 +1,481 @@
+/** \class THcEventIndex
+    \ingroup Base
+
+ Event index of a raw CODA file.
+
+ The index holds, for every event of the file, its byte offset, length,
+ event type and physics event number.  It is built by scanning the
+ EVIO block structure of the file once (without decoding any event) and
+ saved next to the raw file as `<file>.evidx`, together with the size
+ and modification time of the raw file, so that later replays of the
+ run load it instead.  A missing or stale sidecar file is rebuilt by
+ Open.  The sidecar file is in the byte order of the machine that wrote
+ it; one that does not match is rebuilt as well.
+
+ With the index, any event is read directly with ReadEvent.  Next
+ returns the entries to read in sequence, restricted to the event types
+ selected with SelectEventType, with only every n-th physics event for
+ SetPrescale(n), and without the physics events before SetStart.
+ THcAnalyzer uses this for SetEventIndex:
+~~~
+     analyzer->SetEventIndex();
+     analyzer->SelectEventType(1);     // physics events of type 1 ...
+     analyzer->SelectEventType(129);   // ... and scaler events
+     analyzer->SetPrescale(100);       // every 100th physics event
+~~~
+ The index of a run can also be built beforehand, from the hcana
+ prompt, with THcAnalyzer::BuildEventIndex("run.dat").
+
+ After Map, the file is read through a read-only memory mapping, with
+ the kernel told to expect sequential access.  GetEvent then returns a
+ pointer into the mapping for every event stored in one piece, so the
+ decoder and the event type handlers read the event where the page
+ cache holds it, without a read call or copy.  Only events continuing
+ across EVIO blocks (or files of the other byte order) are copied.
+ Where mapping does not pay off (network file systems, disk staging
+ areas), SetReadAhead instead has the file read ahead on a background
+ thread by a THcReadAhead.
+
+ Both EVIO block formats are understood: fixed size blocks with events
+ continuing across blocks (versions 1-3, CODA 2) and variable size
+ blocks (version 4).  Event types and numbers follow the CODA 2 event
+ layout.  Files of the other byte order are swapped word by word, which
+ is correct for the 32-bit data of the Hall C crates.
+
+*/
+
+#include "THcEventIndex.h"
+#include "THcReadAhead.h"
+#include "THaCodaData.h"
+#include "TError.h"
+#include "TMath.h"
+#include "TString.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+using namespace std;
+
+namespace {
+  const UInt_t kBlockMagic = 0xc0da0100;
+  const UInt_t kIndexVersion = 1;
+
+  inline UInt_t Swap( UInt_t w )
+  {
+    return (w>>24) | ((w>>8)&0xff00) | ((w<<8)&0xff0000) | (w<<24);
+  }
+
+  // Sidecar file header
+  struct IndexHeader {
+    char     magic[4];        // "HCEI"
+    UInt_t   version;
+    UInt_t   entrysize;       // sizeof(Entry_t)
+    UInt_t   evioversion;
+    UInt_t   blocksize;
+    UInt_t   headersize;
+    UInt_t   swap;
+    UInt_t   unused;
+    Long64_t filesize, mtime; // Of the raw file
+    Long64_t nentries;
+  };
+
+  // Sequential reader of the data words of the EVIO blocks of a file
+  class BlockReader {
+  public:
+    BlockReader( FILE* file, Bool_t swap, UInt_t version ) :
+      fFile(file), fSwap(swap), fVersion(version), fBlockStart(0),
+      fPos(0), fEnd(0) {}
+
+    // Next data word and its byte offset in the file
+    Bool_t Get( UInt_t& word, Long64_t* offset = 0 )
+    {
+      while( fPos >= fEnd )
+	if( !NextBlock() ) return kFALSE;
+      if( offset ) *offset = fBlockStart + 4*(Long64_t)fPos;
+      word = fBlock[fPos++];
+      return kTRUE;
+    }
+    Bool_t Skip( UInt_t nwords )
+    {
+      while( nwords > 0 ) {
+	while( fPos >= fEnd )
+	  if( !NextBlock() ) return kFALSE;
+	UInt_t n = min(nwords, fEnd-fPos);
+	fPos += n;
+	nwords -= n;
+      }
+      return kTRUE;
+    }
+
+  private:
+    Bool_t NextBlock()
+    {
+      fBlockStart = ftello(fFile);
+      UInt_t header[8];
+      if( fread(header, sizeof(UInt_t), 8, fFile) != 8 ) return kFALSE;
+      if( fSwap )
+	for( Int_t i = 0; i < 8; i++ ) header[i] = Swap(header[i]);
+      UInt_t size = header[0];
+      if( header[7] != kBlockMagic || size < 8 || header[2] < 8 ||
+	  header[2] > size ) {
+	Error("THcEventIndex::Build", "Bad EVIO block header at byte %lld",
+	      fBlockStart);
+	return kFALSE;
+      }
+      fBlock.resize(size);
+      copy(header, header+8, fBlock.begin());
+      size_t nread = fread(&fBlock[8], sizeof(UInt_t), size-8, fFile);
+      if( fSwap )
+	for( size_t i = 8; i < 8+nread; i++ ) fBlock[i] = Swap(fBlock[i]);
+      fPos = header[2];
+      // Versions 1-3: words after "used" are unused
+      fEnd = (fVersion < 4) ? min(header[4], size) : size;
+      fEnd = min<UInt_t>(fEnd, 8+nread);
+      return kTRUE;
+    }
+
+    FILE*    fFile;
+    Bool_t   fSwap;
+    UInt_t   fVersion;
+    vector<UInt_t> fBlock;
+    Long64_t fBlockStart;
+    UInt_t   fPos, fEnd;
+  };
+
+  // Physics event number for FindEvent
+  struct EvnumLess {
+    bool operator()( const THcEventIndex::Entry_t& e, UInt_t evnum ) const
+    { return e.evnum < evnum; }
+  };
+}
+
+//_____________________________________________________________________________
+THcEventIndex::THcEventIndex() :
+  fFile(0), fVersion(0), fBlockSize(0), fHeaderSize(8), fSwap(kFALSE),
+  fSize(0), fMTime(0), fMap(0), fReadAhead(0),
+  fSelect(kFALSE), fPrescale(1), fStart(0),
+  fNext(0), fNPhysics(0)
+{
+  // Constructor
+
+  memset(fTypeMask, 0, sizeof(fTypeMask));
+}
+
+//_____________________________________________________________________________
+THcEventIndex::~THcEventIndex()
+{
+  // Destructor
+
+  Close();
+  delete fReadAhead;
+}
+
+//_____________________________________________________________________________
+string THcEventIndex::GetIndexName( const char* filename )
+{
+  return string(filename) + ".evidx";
+}
+
+//_____________________________________________________________________________
+Bool_t THcEventIndex::Open( const char* filename, Bool_t save )
+{
+  // Open filename and get its index
+
+  Close();
+  struct stat st;
+  if( stat(filename, &st) != 0 || !(fFile = fopen(filename, "rb")) ) {
+    Error("THcEventIndex::Open", "Cannot open %s", filename);
+    return kFALSE;
+  }
+  fFileName = filename;
+  fSize = st.st_size;
+  fMTime = st.st_mtime;
+
+  string indexname = GetIndexName(filename);
+  if( Load(indexname.c_str()) ) {
+    if( fReadAhead ) fReadAhead->SetFile(fileno(fFile));
+    return kTRUE;
+  }
+  if( !Build() ) {
+    Close();
+    return kFALSE;
+  }
+  if( save && !Save(indexname.c_str()) )
+    Warning("THcEventIndex::Open", "Cannot write event index %s",
+	    indexname.c_str());
+  if( fReadAhead ) fReadAhead->SetFile(fileno(fFile));
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcEventIndex::Close()
+{
+  if( fMap ) munmap(const_cast<char*>(fMap), fSize);
+  fMap = 0;
+  if( fReadAhead ) fReadAhead->SetFile(-1);
+  if( fFile ) fclose(fFile);
+  fFile = 0;
+  fEntries.clear();
+  fNext = fNPhysics = 0;
+}
+
+//_____________________________________________________________________________
+Bool_t THcEventIndex::Build()
+{
+  // Scan the open file for its events
+
+  fEntries.clear();
+  if( !fFile ) return kFALSE;
+
+  UInt_t header[8];
+  rewind(fFile);
+  if( fread(header, sizeof(UInt_t), 8, fFile) != 8 ) {
+    Error("THcEventIndex::Build", "%s is empty", fFileName.c_str());
+    return kFALSE;
+  }
+  if( header[7] == kBlockMagic )
+    fSwap = kFALSE;
+  else if( header[7] == Swap(kBlockMagic) )
+    fSwap = kTRUE;
+  else {
+    Error("THcEventIndex::Build", "%s is not an EVIO file", fFileName.c_str());
+    return kFALSE;
+  }
+  if( fSwap )
+    for( Int_t i = 0; i < 8; i++ ) header[i] = Swap(header[i]);
+  fVersion = header[5] & 0xff;
+  fBlockSize = header[0];
+  fHeaderSize = header[2];
+  rewind(fFile);
+
+  BlockReader reader(fFile, fSwap, fVersion);
+  Entry_t entry;
+  entry.evnum = 0;
+  UInt_t len, word;
+  while( reader.Get(len, &entry.offset) ) {
+    if( len == 0 || !reader.Get(word) ) continue;
+    entry.length = len+1;
+    entry.evtype = word >> 16;
+    UInt_t nread = 1;
+    if( IsPhysics(entry.evtype) && len >= 4 ) {
+      // Event ID bank: length, header, event number
+      for( ; nread < 4; nread++ )
+	reader.Get(word);
+      entry.evnum = word;
+    }
+    fEntries.push_back(entry);
+    if( !reader.Skip(len-nread) ) {
+      Warning("THcEventIndex::Build", "Last event of %s is truncated",
+	      fFileName.c_str());
+      fEntries.pop_back();
+      break;
+    }
+  }
+  rewind(fFile);
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcEventIndex::Save( const char* file ) const
+{
+  // Write the index to file.  The file is written under a temporary name
+  // and renamed when complete, so that workers saving the index of the
+  // same run at the same time never leave a partly written one.
+
+  TString tmpfile = Form("%s.tmp%d", file, static_cast<Int_t>(getpid()));
+  FILE* f = fopen(tmpfile.Data(), "wb");
+  if( !f ) return kFALSE;
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "HCEI", 4);
+  header.version = kIndexVersion;
+  header.entrysize = sizeof(Entry_t);
+  header.evioversion = fVersion;
+  header.blocksize = fBlockSize;
+  header.headersize = fHeaderSize;
+  header.swap = fSwap;
+  header.filesize = fSize;
+  header.mtime = fMTime;
+  header.nentries = fEntries.size();
+  Bool_t ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+  // Entries are copied field by field into zeroed ones, so that their
+  // padding is written as zeros
+  const size_t kChunk = 4096;
+  vector<Entry_t> chunk(kChunk);
+  for( size_t i = 0; ok && i < fEntries.size(); i += kChunk ) {
+    size_t n = TMath::Min(kChunk, fEntries.size()-i);
+    memset(&chunk[0], 0, n*sizeof(Entry_t));
+    for( size_t k = 0; k < n; k++ ) {
+      const Entry_t& entry = fEntries[i+k];
+      chunk[k].offset = entry.offset;
+      chunk[k].length = entry.length;
+      chunk[k].evtype = entry.evtype;
+      chunk[k].evnum = entry.evnum;
+    }
+    ok = (fwrite(&chunk[0], sizeof(Entry_t), n, f) == n);
+  }
+  if( fclose(f) != 0 ) ok = kFALSE;
+  if( ok && rename(tmpfile.Data(), file) != 0 ) ok = kFALSE;
+  if( !ok ) remove(tmpfile.Data());
+  return ok;
+}
+
+//_____________________________________________________________________________
+Bool_t THcEventIndex::Load( const char* file )
+{
+  // Read the index from file, if it was made for the open raw file as it
+  // is now
+
+  FILE* f = fopen(file, "rb");
+  if( !f ) return kFALSE;
+  IndexHeader header;
+  Bool_t ok = (fread(&header, sizeof(header), 1, f) == 1 &&
+	       memcmp(header.magic, "HCEI", 4) == 0 &&
+	       header.version == kIndexVersion &&
+	       header.entrysize == sizeof(Entry_t) &&
+	       header.filesize == fSize && header.mtime == fMTime);
+  if( ok ) {
+    fEntries.resize(header.nentries);
+    if( header.nentries > 0 )
+      ok = (fread(&fEntries[0], sizeof(Entry_t), header.nentries, f) ==
+	    (size_t)header.nentries);
+  }
+  fclose(f);
+  if( !ok ) {
+    fEntries.clear();
+    return kFALSE;
+  }
+  fVersion = header.evioversion;
+  fBlockSize = header.blocksize;
+  fHeaderSize = header.headersize;
+  fSwap = header.swap;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Long64_t THcEventIndex::FindEvent( UInt_t evnum ) const
+{
+  // Event numbers do not decrease along the file
+
+  return lower_bound(fEntries.begin(), fEntries.end(), evnum, EvnumLess()) -
+    fEntries.begin();
+}
+
+//_____________________________________________________________________________
+Bool_t THcEventIndex::Map()
+{
+  // Map the open file read-only
+
+  if( fMap ) return kTRUE;
+  if( !fFile || fSize <= 0 ) return kFALSE;
+  void* map = mmap(0, fSize, PROT_READ, MAP_SHARED, fileno(fFile), 0);
+  if( map == MAP_FAILED ) {
+    Warning("THcEventIndex::Map", "Cannot map %s. Reading it instead.",
+	    fFileName.c_str());
+    return kFALSE;
+  }
+  madvise(map, fSize, MADV_SEQUENTIAL);
+  fMap = static_cast<const char*>(map);
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcEventIndex::SetReadAhead( Int_t depth, Int_t chunksize )
+{
+  delete fReadAhead;
+  fReadAhead = new THcReadAhead(depth, chunksize);
+  if( fFile ) fReadAhead->SetFile(fileno(fFile));
+}
+
+//_____________________________________________________________________________
+Bool_t THcEventIndex::ReadWords( Long64_t pos, UInt_t n, UInt_t* words )
+{
+  // Copy n words from word position pos of the file
+
+  if( fMap ) {
+    if( 4*(pos+n) > fSize ) return kFALSE;
+    memcpy(words, fMap+4*pos, 4*n);
+    return kTRUE;
+  }
+  if( fReadAhead )
+    return fReadAhead->Read(4*pos, 4*(Long64_t)n, words);
+  return fseeko(fFile, 4*pos, SEEK_SET) == 0 &&
+    fread(words, sizeof(UInt_t), n, fFile) == n;
+}
+
+//_____________________________________________________________________________
+Int_t THcEventIndex::ReadEvent( Long64_t i, vector<UInt_t>& buffer )
+{
+  // Read the event of entry i
+
+  if( !fFile || i < 0 || i >= (Long64_t)fEntries.size() ) return CODA_ERROR;
+  const Entry_t& entry = fEntries[i];
+  buffer.resize(entry.length);
+  Long64_t pos = entry.offset/4;
+  UInt_t done = 0;
+  while( done < entry.length ) {
+    UInt_t n = entry.length-done;
+    Long64_t end = pos+n;
+    if( fVersion < 4 && fBlockSize > 0 ) {
+      // The event may continue in the next block, after its header
+      end = (pos/fBlockSize+1)*fBlockSize;
+      if( pos+n > end ) n = end-pos;
+    }
+    if( !ReadWords(pos, n, &buffer[done]) )
+      return CODA_ERROR;
+    done += n;
+    pos = end + fHeaderSize;
+  }
+  if( fSwap )
+    for( UInt_t k = 0; k < entry.length; k++ ) buffer[k] = Swap(buffer[k]);
+  return CODA_OK;
+}
+
+//_____________________________________________________________________________
+const UInt_t* THcEventIndex::GetEvent( Long64_t i, vector<UInt_t>& buffer )
+{
+  // The event of entry i, in the mapping where possible
+
+  if( fMap && !fSwap && i >= 0 && i < (Long64_t)fEntries.size() ) {
+    const Entry_t& entry = fEntries[i];
+    Long64_t pos = entry.offset/4;
+    Bool_t contiguous = (fVersion >= 4 || fBlockSize == 0 ||
+			 pos/fBlockSize == (pos+entry.length-1)/fBlockSize);
+    if( contiguous && 4*(pos+entry.length) <= fSize )
+      return reinterpret_cast<const UInt_t*>(fMap) + pos;
+  }
+  if( ReadEvent(i, buffer) != CODA_OK ) return 0;
+  return &buffer[0];
+}
+
+//_____________________________________________________________________________
+void THcEventIndex::SelectEventType( UInt_t evtype )
+{
+  if( evtype >= 256 ) return;
+  fTypeMask[evtype/32] |= 1U << (evtype%32);
+  fSelect = kTRUE;
+}
+
+//_____________________________________________________________________________
+Long64_t THcEventIndex::Next()
+{
+  // Next entry to read
+
+  while( fNext < (Long64_t)fEntries.size() ) {
+    Long64_t i = fNext++;
+    UInt_t evtype = fEntries[i].evtype;
+    if( IsControl(evtype) ) return i;
+    if( fSelect && (evtype >= 256 || !(fTypeMask[evtype/32] & (1U << (evtype%32)))) )
+      continue;
+    if( IsPhysics(evtype) ) {
+      if( i < fStart ) continue;
+      if( fNPhysics++ % fPrescale != 0 ) continue;
+    }
+    return i;
+  }
+  return -1;
+}
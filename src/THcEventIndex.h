@@ -0,0 +1,108 @@
+#ifndef ROOT_THcEventIndex
+#define ROOT_THcEventIndex
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcEventIndex
+//
+// Offsets, types and numbers of the events of a raw CODA file, kept in
+// a sidecar file, for reading selected events without scanning the file.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class THcReadAhead;
+
+class THcEventIndex {
+
+public:
+  struct Entry_t {
+    Long64_t offset;    // Byte offset of the event in the file
+    UInt_t   length;    // Event length in words, including the length word
+    UInt_t   evtype;    // CODA event type
+    UInt_t   evnum;     // Physics event number (for other events, that
+                        //  of the last physics event before them)
+  };
+
+  THcEventIndex();
+  ~THcEventIndex();
+
+  // Open raw CODA file filename.  The index is loaded from the sidecar
+  // file if that is up to date, otherwise the file is scanned and, if
+  // save is set, the sidecar file written.
+  Bool_t   Open( const char* filename, Bool_t save = kTRUE );
+  void     Close();
+  Bool_t   Build();
+  Bool_t   Save( const char* file ) const;
+  Bool_t   Load( const char* file );
+
+  const char* GetFileName() const { return fFileName.c_str(); }
+  Long64_t GetNEntries() const { return fEntries.size(); }
+  const Entry_t& GetEntry( Long64_t i ) const { return fEntries[i]; }
+  // First entry with physics event number >= evnum, or GetNEntries()
+  Long64_t FindEvent( UInt_t evnum ) const;
+  // Read the event of entry i.  Returns CODA_OK or CODA_ERROR.
+  Int_t    ReadEvent( Long64_t i, std::vector<UInt_t>& buffer );
+
+  // Map the open file into memory, for GetEvent
+  Bool_t   Map();
+  Bool_t   IsMapped() const { return fMap != 0; }
+  // The event of entry i: a pointer into the mapping if the file is
+  // mapped and the event is stored contiguously in native byte order,
+  // otherwise read into buffer.  Valid until the file is closed or
+  // buffer changes.  Returns 0 on error.
+  const UInt_t* GetEvent( Long64_t i, std::vector<UInt_t>& buffer );
+
+  // Read the file through a THcReadAhead of depth buffers of chunksize
+  // bytes, when it is not mapped
+  void     SetReadAhead( Int_t depth, Int_t chunksize );
+  const THcReadAhead* GetReadAhead() const { return fReadAhead; }
+
+  // Sequential reading of selected events.  Without selected types, all
+  // events are read.  Control events are always read.
+  void     SelectEventType( UInt_t evtype );
+  // Read only every n-th of the physics events
+  void     SetPrescale( UInt_t n ) { fPrescale = n > 0 ? n : 1; }
+  // Skip the physics events before entry.  The other selected events
+  // before it are still read, to keep scaler and run information.
+  void     SetStart( Long64_t entry ) { fStart = entry; }
+  void     Seek( Long64_t entry ) { fNext = entry; fNPhysics = 0; }
+  // Next entry to read, or -1 at the end of the file
+  Long64_t Next();
+
+  static Bool_t IsPhysics( UInt_t evtype ) { return evtype >= 1 && evtype <= 14; }
+  static Bool_t IsControl( UInt_t evtype ) { return evtype >= 16 && evtype <= 31; }
+  static std::string GetIndexName( const char* filename );
+
+protected:
+  FILE*    fFile;
+  std::string fFileName;
+  std::vector<Entry_t> fEntries;
+  UInt_t   fVersion;          // EVIO format version of the file
+  UInt_t   fBlockSize;        // Block size in words (versions 1-3)
+  UInt_t   fHeaderSize;       // Block header size in words
+  Bool_t   fSwap;             // File has the other byte order
+  Long64_t fSize;             // File size and modification time
+  Long64_t fMTime;
+  const char* fMap;           // Mapping of the file, or 0
+  THcReadAhead* fReadAhead;   // Read-ahead of the file, or 0
+
+  UInt_t   fTypeMask[8];      // Selected event types
+  Bool_t   fSelect;           // Any types selected
+  UInt_t   fPrescale;
+  Long64_t fStart;
+  Long64_t fNext;             // Next entry to consider
+  Long64_t fNPhysics;         // Physics events considered since Seek
+
+  Bool_t   ReadWords( Long64_t pos, UInt_t n, UInt_t* words );
+
+private:
+  THcEventIndex( const THcEventIndex& );
+  THcEventIndex& operator=( const THcEventIndex& );
+};
+
+#endif
@@ -0,0 +1,214 @@
+/** \class THcEventPipeline
+    \ingroup Base
+
+ Pipelined raw event input for THcAnalyzer.
+
+ A reader thread reads the events of a CODA file with its own
+ THaCodaFile and copies them into the slots of a THcPipeQueue, up to
+ depth events ahead of the analysis.  The event loop takes the events
+ with Next, so that file reads overlap with the decoding and
+ reconstruction of earlier events.
+
+ This is read-ahead only: the pipeline has two stages, reading and
+ everything else.  Decoding is not pipelined; the event loop still
+ decodes each event into the one THaEvData of the analyzer before it
+ reconstructs it, so only the file input runs in parallel.
+
+ Neither side takes a lock; a stage
+ that finds the queue full (reader) or empty (analysis) yields and
+ retries.  The time each stage spends working and waiting is recorded,
+ and Print shows it at the end of the run:
+ a reader that stalls often means the analysis is the bottleneck, an
+ analysis that stalls means the input is.
+
+*/
+
+#include "THcEventPipeline.h"
+#include "THaCodaFile.h"
+#include "THaCodaData.h"
+#include "TError.h"
+
+#include <cstdio>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+using namespace std;
+
+//_____________________________________________________________________________
+THcEventPipeline::THcEventPipeline( Int_t depth ) :
+  fQueue(depth), fFile(0), fRunning(kFALSE), fStop(0), fHolding(kFALSE),
+  fLastTime(0)
+{
+  // Constructor.  depth is the number of events the reader may be ahead.
+
+  Stats_t zero = { 0, 0, 0.0, 0.0 };
+  fReadStats = fAnalyzeStats = zero;
+}
+
+//_____________________________________________________________________________
+THcEventPipeline::~THcEventPipeline()
+{
+  // Destructor
+
+  Stop();
+}
+
+//_____________________________________________________________________________
+Double_t THcEventPipeline::Now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+//_____________________________________________________________________________
+void THcEventPipeline::Wait( Int_t& spins )
+{
+  // Back off while the other stage catches up
+
+  if( ++spins < 64 )
+    sched_yield();
+  else
+    usleep(50);
+}
+
+//_____________________________________________________________________________
+Bool_t THcEventPipeline::Start( const char* filename )
+{
+  // Open filename and start the reader thread
+
+  Stop();
+  fFile = new Decoder::THaCodaFile;
+  if( fFile->codaOpen(filename) != CODA_OK ) {
+    Error("THcEventPipeline::Start", "Cannot open %s", filename);
+    delete fFile;
+    fFile = 0;
+    return kFALSE;
+  }
+  Stats_t zero = { 0, 0, 0.0, 0.0 };
+  fReadStats = fAnalyzeStats = zero;
+  fStop = 0;
+  fLastTime = 0;
+  if( pthread_create(&fThread, 0, ReaderMain, this) != 0 ) {
+    Error("THcEventPipeline::Start", "Cannot start reader thread");
+    fFile->codaClose();
+    delete fFile;
+    fFile = 0;
+    return kFALSE;
+  }
+  fRunning = kTRUE;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcEventPipeline::Stop()
+{
+  // Stop the reader thread and close the file
+
+  if( !fRunning ) return;
+  __atomic_store_n(&fStop, 1, __ATOMIC_RELEASE);
+  pthread_join(fThread, 0);
+  fRunning = kFALSE;
+  fFile->codaClose();
+  delete fFile;
+  fFile = 0;
+  while( fQueue.Front() )
+    fQueue.Pop();
+  fHolding = kFALSE;
+}
+
+//_____________________________________________________________________________
+void* THcEventPipeline::ReaderMain( void* pipeline )
+{
+  static_cast<THcEventPipeline*>(pipeline)->ReadLoop();
+  return 0;
+}
+
+//_____________________________________________________________________________
+void THcEventPipeline::ReadLoop()
+{
+  // Reader thread: read events until the end of the file, a fatal error
+  // or Stop
+
+  for(;;) {
+    Double_t t0 = Now();
+    Int_t status = fFile->codaRead();
+    Double_t t1 = Now();
+    fReadStats.busy += t1-t0;
+
+    Slot_t* slot;
+    Int_t spins = 0;
+    while( !(slot = fQueue.BeginPush()) ) {
+      if( __atomic_load_n(&fStop, __ATOMIC_ACQUIRE) ) return;
+      if( spins == 0 ) fReadStats.nstalls++;
+      Wait(spins);
+    }
+    Double_t t2 = Now();
+    fReadStats.stall += t2-t1;
+
+    slot->status = status;
+    if( status == CODA_OK ) {
+      const UInt_t* buf = fFile->getEvBuffer();
+      slot->buffer.assign(buf, buf+buf[0]+1);
+    } else {
+      slot->buffer.clear();
+    }
+    fQueue.EndPush();
+    fReadStats.nitems++;
+    fReadStats.busy += Now()-t2;
+    if( status == CODA_EOF || status == CODA_FATAL ||
+	__atomic_load_n(&fStop, __ATOMIC_ACQUIRE) )
+      return;
+  }
+}
+
+//_____________________________________________________________________________
+const UInt_t* THcEventPipeline::Next( Int_t& status )
+{
+  // Release the previous event and wait for the next one
+
+  if( fHolding ) {
+    Slot_t* held = fQueue.Front();
+    if( held->status == CODA_EOF || held->status == CODA_FATAL ) {
+      // The reader has stopped; keep reporting how
+      status = held->status;
+      return 0;
+    }
+    fQueue.Pop();
+    fHolding = kFALSE;
+  }
+
+  Double_t t0 = Now();
+  if( fLastTime > 0 )
+    fAnalyzeStats.busy += t0-fLastTime;
+  Slot_t* slot;
+  Int_t spins = 0;
+  while( !(slot = fQueue.Front()) ) {
+    if( spins == 0 ) fAnalyzeStats.nstalls++;
+    Wait(spins);
+  }
+  fLastTime = Now();
+  fAnalyzeStats.stall += fLastTime-t0;
+  fHolding = kTRUE;
+
+  status = slot->status;
+  if( status != CODA_OK || slot->buffer.empty() )
+    return 0;
+  fAnalyzeStats.nitems++;
+  return &slot->buffer[0];
+}
+
+//_____________________________________________________________________________
+void THcEventPipeline::Print() const
+{
+  // Show the work and wait times of the stages
+
+  const Stats_t* stats[2] = { &fReadStats, &fAnalyzeStats };
+  const char* names[2] = { "read", "analyze" };
+  printf("Pipeline (depth %u)   events   stalls   busy (s)  stalled (s)\n",
+	 fQueue.GetCapacity());
+  for( Int_t i = 0; i < 2; i++ )
+    printf("  %-18s %8lld %8lld %10.2f %12.2f\n", names[i],
+	   stats[i]->nitems, stats[i]->nstalls, stats[i]->busy, stats[i]->stall);
+}
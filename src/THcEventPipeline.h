@@ -0,0 +1,75 @@
+#ifndef ROOT_THcEventPipeline
+#define ROOT_THcEventPipeline
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcEventPipeline
+//
+// Reads the raw events of a CODA file on a separate thread, ahead of
+// the analysis, and hands them over through a bounded lock-free queue.
+// Read-ahead only: decoding stays in the event loop.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include "THcPipeQueue.h"
+#include <pthread.h>
+#include <vector>
+
+namespace Decoder {
+  class THaCodaFile;
+}
+
+class THcEventPipeline {
+
+public:
+  // Time and counts of one pipeline stage
+  struct Stats_t {
+    Long64_t nitems;    // Items handled
+    Long64_t nstalls;   // Times the stage had to wait for the other one
+    Double_t busy;      // Seconds spent working
+    Double_t stall;     // Seconds spent waiting
+  };
+
+  THcEventPipeline( Int_t depth = 64 );
+  ~THcEventPipeline();
+
+  Bool_t  Start( const char* filename );
+  void    Stop();
+  Bool_t  IsRunning() const { return fRunning; }
+
+  // Next raw event, valid until the next call.  Returns 0 at the end of
+  // the file or on a read error.  status is the CODA read status.
+  const UInt_t* Next( Int_t& status );
+
+  const Stats_t& GetReadStats() const    { return fReadStats; }
+  const Stats_t& GetAnalyzeStats() const { return fAnalyzeStats; }
+  void    Print() const;
+
+protected:
+  struct Slot_t {
+    Int_t status;
+    std::vector<UInt_t> buffer;
+  };
+
+  THcPipeQueue<Slot_t>  fQueue;
+  Decoder::THaCodaFile* fFile;
+  pthread_t fThread;
+  Bool_t    fRunning;
+  Int_t     fStop;          // Set by the consumer to end the reader
+  Bool_t    fHolding;       // Consumer holds the front slot
+  Double_t  fLastTime;      // Consumer: time of the last Next
+  Stats_t   fReadStats;
+  Stats_t   fAnalyzeStats;
+
+  void         ReadLoop();
+  static void* ReaderMain( void* pipeline );
+  static Double_t Now();
+  static void  Wait( Int_t& spins );
+
+private:
+  THcEventPipeline( const THcEventPipeline& );
+  THcEventPipeline& operator=( const THcEventPipeline& );
+};
+
+#endif
@@ -10,6 +10,19 @@ The number of times a cut has been try, as well as the number of times
 that the cut has been tested can be accessed with cutname.`scaler` (or
 .`npassed`) and cutname.`ncalled`.
 
+Besides the usual compilation by TFormula, expressions that use only
+numbers, variables, parameters, cuts, arithmetic, comparison and logical
+operators, common math functions and the array functions (`Sum$(x)`,
+`Length$(x)`, ...) applied to a variable are compiled into a short list
+of instructions with the variables resolved to pointers.  Eval runs these
+directly.  Anything else is evaluated by THaFormula as before.
+
+THcFormula::Get returns a compiled formula for an expression from a
+process-wide cache, so that expressions that are evaluated repeatedly,
+e.g. in reports, are parsed only once.  A cached formula is compiled
+again if any of the names it uses now refers to a different variable or
+cut.
+
 \author S. A. Wood
 
 */
@@ -23,6 +36,11 @@ that the cut has been tested can be accessed with cutname.`scaler` (or
 
 #include <iostream>
 #include <numeric>
+#include <algorithm>
+#include <map>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
@@ -33,6 +51,48 @@ enum EFuncCode { kLength, kSum, kMean, kStdDev, kMax, kMin,
 
 #define ALL(c) (c).begin(), (c).end()
 
+// Instructions of compiled expressions
+enum EOpCode { kOpConst, kOpVar, kOpCut, kOpCutNPassed, kOpCutNCalled,
+	       kOpArrayFunc, kOpNeg, kOpNot, kOpAdd, kOpSub, kOpMul, kOpDiv,
+	       kOpMod, kOpPow, kOpEq, kOpNe, kOpLt, kOpLe, kOpGt, kOpGe,
+	       kOpAnd, kOpOr, kOpMath1, kOpMath2 };
+
+enum EMathCode { kSqrt, kAbs, kExp, kLog, kLog10, kSin, kCos, kTan,
+		 kASin, kACos, kATan, kATan2, kPow };
+
+static const struct {
+  const char* name;
+  Int_t       npar;
+  Int_t       code;
+} gMathFuncs[] = {
+  { "sqrt", 1, kSqrt }, { "abs", 1, kAbs }, { "fabs", 1, kAbs },
+  { "exp", 1, kExp }, { "log", 1, kLog }, { "log10", 1, kLog10 },
+  { "sin", 1, kSin }, { "cos", 1, kCos }, { "tan", 1, kTan },
+  { "asin", 1, kASin }, { "acos", 1, kACos }, { "atan", 1, kATan },
+  { "atan2", 2, kATan2 }, { "pow", 2, kPow },
+  { 0, 0, 0 }
+};
+
+static const struct {
+  const char* name;
+  Int_t       code;
+} gArrayFuncs[] = {
+  { "Length$", kLength }, { "Sum$", kSum }, { "Mean$", kMean },
+  { "StdDev$", kStdDev }, { "Max$", kMax }, { "Min$", kMin },
+  { "GeoMean$", kGeoMean }, { "Median$", kMedian },
+  { "NumSetBits$", kNumSetBits },
+  { 0, 0 }
+};
+
+typedef map<string, THcFormula*> FormulaCache_t;
+
+static FormulaCache_t& FormulaCache()
+{
+  // Cached formulas live until ClearCache or the end of the process
+  static FormulaCache_t cache;
+  return cache;
+}
+
 //_____________________________________________________________________________
 static inline Int_t NumberOfSetBits( UInt_t v )
 {
@@ -54,11 +114,235 @@ static inline Int_t NumberOfSetBits( ULong64_t v )
     NumberOfSetBits( static_cast<UInt_t>(mask32 & (v>>32)) );
 }
 
+//_____________________________________________________________________________
+// Recursive descent compiler of THcFormula expressions into a list of
+// stack machine instructions.  Compile() fails on any syntax it does not
+// handle, leaving the evaluation to THaFormula.
+class THcFormulaCompiler {
+public:
+  THcFormulaCompiler( THcFormula* formula, const char* expr )
+    : fFormula(formula), fPos(expr), fOK(true), fDepth(0), fMaxDepth(0) {}
+  Bool_t Compile() {
+    Or();
+    SkipSpace();
+    if( !fOK || *fPos != '\0' || fDepth != 1 ) return kFALSE;
+    fFormula->fCode.swap(fCode);
+    fFormula->fStack.resize(fMaxDepth);
+    return kTRUE;
+  }
+private:
+  typedef THcFormula::Instr_t Instr_t;
+
+  THcFormula* fFormula;
+  const char* fPos;
+  bool        fOK;
+  Int_t       fDepth;
+  Int_t       fMaxDepth;
+  vector<Instr_t> fCode;
+
+  void Fail() { fOK = false; }
+  void SkipSpace() { while( isspace(*fPos) ) fPos++; }
+  // Consume operator op, unless it is the start of a longer operator
+  bool Accept( const char* op, const char* notfollowedby = "" ) {
+    SkipSpace();
+    size_t n = strlen(op);
+    if( strncmp(fPos, op, n) != 0 ) return false;
+    if( fPos[n] && strchr(notfollowedby, fPos[n]) ) return false;
+    fPos += n;
+    return true;
+  }
+  void Emit( Int_t op, Int_t index = 0, const void* obj = 0,
+	     Double_t value = 0.0 ) {
+    Instr_t instr = { op, index, obj, value };
+    fCode.push_back(instr);
+    switch( op ) {
+    case kOpConst: case kOpVar: case kOpCut: case kOpCutNPassed:
+    case kOpCutNCalled: case kOpArrayFunc:
+      fDepth++;
+      break;
+    case kOpNeg: case kOpNot: case kOpMath1:
+      break;
+    default:			// Binary operators
+      fDepth--;
+      break;
+    }
+    if( fDepth > fMaxDepth ) fMaxDepth = fDepth;
+  }
+
+  void Or() {
+    And();
+    while( fOK && Accept("||") ) { And(); Emit(kOpOr); }
+  }
+  void And() {
+    Equality();
+    while( fOK && Accept("&&") ) { Equality(); Emit(kOpAnd); }
+  }
+  void Equality() {
+    Relational();
+    while( fOK ) {
+      if( Accept("==") )      { Relational(); Emit(kOpEq); }
+      else if( Accept("!=") ) { Relational(); Emit(kOpNe); }
+      else break;
+    }
+  }
+  void Relational() {
+    Additive();
+    while( fOK ) {
+      if( Accept("<=") )          { Additive(); Emit(kOpLe); }
+      else if( Accept(">=") )     { Additive(); Emit(kOpGe); }
+      else if( Accept("<", "<") ) { Additive(); Emit(kOpLt); }
+      else if( Accept(">", ">") ) { Additive(); Emit(kOpGt); }
+      else break;
+    }
+  }
+  void Additive() {
+    Term();
+    while( fOK ) {
+      if( Accept("+") )      { Term(); Emit(kOpAdd); }
+      else if( Accept("-") ) { Term(); Emit(kOpSub); }
+      else break;
+    }
+  }
+  void Term() {
+    Unary();
+    while( fOK ) {
+      if( Accept("*", "*") ) { Unary(); Emit(kOpMul); }
+      else if( Accept("/") ) { Unary(); Emit(kOpDiv); }
+      else if( Accept("%") ) { Unary(); Emit(kOpMod); }
+      else break;
+    }
+  }
+  void Unary() {
+    if( Accept("+") )           { Unary(); }
+    else if( Accept("-") )      { Unary(); Emit(kOpNeg); }
+    else if( Accept("!", "=") ) { Unary(); Emit(kOpNot); }
+    else Power();
+  }
+  void Power() {
+    Primary();
+    if( fOK && (Accept("^") || Accept("**")) ) {
+      Unary();
+      Emit(kOpPow);
+    }
+  }
+  void Primary() {
+    SkipSpace();
+    if( *fPos == '(' ) {
+      fPos++;
+      Or();
+      if( !Accept(")") ) Fail();
+      return;
+    }
+    if( isdigit(*fPos) || (*fPos == '.' && isdigit(fPos[1])) ) {
+      char* end;
+      Double_t val = strtod(fPos, &end);
+      if( end == fPos ) { Fail(); return; }
+      fPos = end;
+      Emit(kOpConst, 0, 0, val);
+      return;
+    }
+    string name;
+    if( !Name(name) ) { Fail(); return; }
+    SkipSpace();
+    if( *fPos == '(' ) {
+      fPos++;
+      Function(name);
+    } else {
+      Variable(name);
+    }
+  }
+  // Identifier, with array subscripts if any
+  bool Name( string& name ) {
+    const char* start = fPos;
+    if( !isalpha(*fPos) && *fPos != '_' ) return false;
+    while( isalnum(*fPos) || *fPos == '_' || *fPos == '.' || *fPos == '$' )
+      fPos++;
+    while( *fPos == '[' ) {
+      const char* close = strchr(fPos, ']');
+      if( !close ) return false;
+      fPos = close+1;
+    }
+    name.assign(start, fPos-start);
+    return true;
+  }
+  void Function( const string& name ) {
+    for( Int_t i = 0; gArrayFuncs[i].name; i++ ) {
+      if( name != gArrayFuncs[i].name ) continue;
+      // Only a plain variable as argument
+      string arg;
+      SkipSpace();
+      if( !Name(arg) || !Accept(")") ) { Fail(); return; }
+      THaVar* var = fFormula->FindVar(arg.c_str());
+      if( !var || arg.find('[') != string::npos ) { Fail(); return; }
+      fFormula->AddResolved(arg.c_str(), kFALSE, var);
+      Emit(kOpArrayFunc, gArrayFuncs[i].code, var);
+      return;
+    }
+    for( Int_t i = 0; gMathFuncs[i].name; i++ ) {
+      if( name != gMathFuncs[i].name ) continue;
+      Or();
+      if( gMathFuncs[i].npar == 2 ) {
+	if( !fOK || !Accept(",") ) { Fail(); return; }
+	Or();
+      }
+      if( !fOK || !Accept(")") ) { Fail(); return; }
+      Emit(gMathFuncs[i].npar == 2 ? kOpMath2 : kOpMath1, gMathFuncs[i].code);
+      return;
+    }
+    Fail();
+  }
+  void Variable( const string& name ) {
+    // Same lookup order and array semantics as DefinedGlobalVariable
+    // and DefinedCut
+    THaArrayString parsed_name(name.c_str());
+    THaVar* var = parsed_name.IsError() ? 0 :
+      fFormula->FindVar(parsed_name.GetName());
+    if( var ) {
+      Int_t index = 0;
+      if( parsed_name.IsArray() ) {
+	if( !var->IsArray() ) { Fail(); return; }
+	if( var->IsVarArray() ) {
+	  if( parsed_name.GetNdim() != 1 ) { Fail(); return; }
+	  index = parsed_name[0];
+	} else {
+	  index = var->Index(parsed_name);
+	}
+	if( index < 0 ) { Fail(); return; }
+      } else if( var->IsArray() ) {
+	Fail();			// Whole arrays are left to THaFormula
+	return;
+      }
+      fFormula->AddResolved(parsed_name.GetName(), kFALSE, var);
+      Emit(kOpVar, index, var);
+      return;
+    }
+    if( !fFormula->fCutList || name.find('[') != string::npos ) {
+      Fail();
+      return;
+    }
+    Int_t op = kOpCut;
+    string realname = name;
+    string::size_type period = name.find('.');
+    if( period != string::npos ) {
+      realname = name.substr(0, period);
+      string attribute = name.substr(period+1);
+      if( attribute == "scaler" || attribute == "npassed" )
+	op = kOpCutNPassed;
+      else if( attribute == "ncalled" )
+	op = kOpCutNCalled;
+    }
+    const THaCut* cut = fFormula->fCutList->FindCut(realname.c_str());
+    if( !cut ) { Fail(); return; }
+    fFormula->AddResolved(realname.c_str(), kTRUE, cut);
+    Emit(op, 0, cut);
+  }
+};
+
 //_____________________________________________________________________________
 THcFormula::THcFormula(const char* name, const char* expression,
 		       const THcParmList* plst, const THaVarList* vlst,
-		       const THaCutList* clst ) :
-  THaFormula()
+		       const THaCutList* clst, const THaVarList* local ) :
+  THaFormula(), fLocalVars(local), fCacheable(kTRUE)
 {
   Bool_t do_register=0;
 
@@ -75,6 +359,20 @@ THcFormula::THcFormula(const char* name, const char* expression,
 
   Compile();   // This calls our own Compile()
 
+  if( IsError() ) {
+    fCacheable = kFALSE;
+  } else {
+    // Sums etc. are evaluated by formulas of their own, whose variables
+    // are not known here
+    for( vector<FVarDef_t>::size_type i=0; i<fVarDef.size(); ++i ) {
+      if( fVarDef[i].type == kFormula || fVarDef[i].type == kVarFormula )
+	fCacheable = kFALSE;
+    }
+    THcFormulaCompiler compiler(this, expression);
+    if( compiler.Compile() )
+      fCacheable = kTRUE;
+  }
+
   if( do_register )
     RegisterFormula();
 }
@@ -86,8 +384,13 @@ THcFormula& THcFormula::operator=( const THcFormula& rhs )
     TFormula::operator=(rhs);
     fParmList = rhs.fParmList;
     fVarList = rhs.fVarList;
+    fLocalVars = rhs.fLocalVars;
     fCutList = rhs.fCutList;
     fInstance = 0;
+    fCode = rhs.fCode;
+    fStack = rhs.fStack;
+    fResolved = rhs.fResolved;
+    fCacheable = rhs.fCacheable;
   }
   return *this;
 }
@@ -98,6 +401,433 @@ THcFormula::~THcFormula()
   // Destructor
 }
 
+//_____________________________________________________________________________
+THcFormula* THcFormula::Get( const char* expression, const THcParmList* plst,
+			     const THaVarList* vlst, const THaCutList* clst )
+{
+  // Return a formula for expression from the process-wide cache, creating
+  // it if needed.  The formula belongs to the cache.  Formulas that cannot
+  // be cached are replaced by the next Get of the same expression.
+
+  string key = Form("%p %p %p ", (const void*)plst, (const void*)vlst,
+		    (const void*)clst);
+  key += expression;
+
+  FormulaCache_t& cache = FormulaCache();
+  FormulaCache_t::iterator it = cache.find(key);
+  if( it != cache.end() ) {
+    if( it->second->IsCacheable() && !it->second->IsStale() )
+      return it->second;
+    delete it->second;
+    cache.erase(it);
+  }
+  THcFormula* formula = new THcFormula("temp", expression, plst, vlst, clst);
+  cache[key] = formula;
+  return formula;
+}
+
+//_____________________________________________________________________________
+void THcFormula::ClearCache()
+{
+  // Delete all cached formulas
+
+  FormulaCache_t& cache = FormulaCache();
+  for( FormulaCache_t::iterator it = cache.begin(); it != cache.end(); ++it )
+    delete it->second;
+  cache.clear();
+}
+
+//_____________________________________________________________________________
+THaVar* THcFormula::FindVar( const char* name ) const
+{
+  // Find name among the local variables (if any), the parameters, then
+  // among the global variables
+
+  THaVar* var = fLocalVars ? fLocalVars->Find(name) : 0;
+  if( !var && fParmList )
+    var = fParmList->Find(name);
+  if( !var && fVarList )
+    var = fVarList->Find(name);
+  return var;
+}
+
+//_____________________________________________________________________________
+void THcFormula::AddResolved( const char* name, Bool_t cut, const void* obj )
+{
+  // Remember what name referred to when the formula was compiled
+
+  for( vector<Resolved_t>::size_type i=0; i<fResolved.size(); ++i ) {
+    if( fResolved[i].obj == obj && fResolved[i].name == name )
+      return;
+  }
+  Resolved_t res;
+  res.name = name;
+  res.cut = cut;
+  res.obj = obj;
+  fResolved.push_back(res);
+}
+
+//_____________________________________________________________________________
+Bool_t THcFormula::IsStale() const
+{
+  // Check whether any name used by the formula now refers to a different
+  // variable or cut, e.g. because the parameters were reloaded
+
+  for( vector<Resolved_t>::size_type i=0; i<fResolved.size(); ++i ) {
+    const Resolved_t& res = fResolved[i];
+    const void* obj;
+    if( res.cut )
+      obj = fCutList ? fCutList->FindCut(res.name.c_str()) : 0;
+    else
+      obj = FindVar(res.name.c_str());
+    if( obj != res.obj )
+      return kTRUE;
+  }
+  return kFALSE;
+}
+
+//_____________________________________________________________________________
+void THcFormula::GetNames( vector<string>& names ) const
+{
+  // Fill names with the variables, parameters and cuts used
+
+  names.clear();
+  for( vector<Resolved_t>::size_type i=0; i<fResolved.size(); ++i )
+    names.push_back(fResolved[i].name);
+}
+
+//_____________________________________________________________________________
+Double_t THcFormula::Eval()
+{
+  // Evaluate the formula.  Uses the compiled instructions if there are
+  // any, with the same results as DefinedValue and TFormula would give.
+
+  if( fCode.empty() )
+    return THaFormula::Eval();
+
+  ResetBit(kInvalid);
+  Double_t* stack = &fStack[0];
+  Int_t top = -1;
+  for( vector<Instr_t>::const_iterator it = fCode.begin();
+       it != fCode.end(); ++it ) {
+    const Instr_t& instr = *it;
+    switch( instr.op ) {
+    case kOpConst:
+      stack[++top] = instr.value;
+      break;
+    case kOpVar:
+      {
+	const THaVar* var = static_cast<const THaVar*>(instr.obj);
+	if( IsInvalid() || instr.index >= var->GetLen() ) {
+	  SetBit(kInvalid);
+	  stack[++top] = 1.0;
+	} else {
+	  stack[++top] = var->GetValue(instr.index);
+	}
+      }
+      break;
+    case kOpCut:
+      stack[++top] = static_cast<const THaCut*>(instr.obj)->GetResult();
+      break;
+    case kOpCutNPassed:
+      stack[++top] = static_cast<const THaCut*>(instr.obj)->GetNPassed();
+      break;
+    case kOpCutNCalled:
+      stack[++top] = static_cast<const THaCut*>(instr.obj)->GetNCalled();
+      break;
+    case kOpArrayFunc:
+      stack[++top] = ArrayFunction(instr.index,
+				   static_cast<const THaVar*>(instr.obj));
+      break;
+    case kOpNeg:
+      stack[top] = -stack[top];
+      break;
+    case kOpNot:
+      stack[top] = (stack[top] == 0.0) ? 1.0 : 0.0;
+      break;
+    case kOpMath1:
+      stack[top] = MathFunction(instr.index, stack[top], 0.0);
+      break;
+    default:
+      {
+	// Binary operators
+	Double_t b = stack[top--];
+	Double_t& a = stack[top];
+	switch( instr.op ) {
+	case kOpAdd: a += b; break;
+	case kOpSub: a -= b; break;
+	case kOpMul: a *= b; break;
+	case kOpDiv: a = (b == 0.0) ? 0.0 : a/b; break;
+	case kOpMod:
+	  {
+	    Int_t ia = static_cast<Int_t>(a), ib = static_cast<Int_t>(b);
+	    if( ib == 0 ) {
+	      SetBit(kInvalid);
+	      a = 1.0;
+	    } else {
+	      a = ia % ib;
+	    }
+	  }
+	  break;
+	case kOpPow: a = TMath::Power(a, b); break;
+	case kOpEq:  a = (a == b); break;
+	case kOpNe:  a = (a != b); break;
+	case kOpLt:  a = (a < b); break;
+	case kOpLe:  a = (a <= b); break;
+	case kOpGt:  a = (a > b); break;
+	case kOpGe:  a = (a >= b); break;
+	case kOpAnd: a = (a != 0.0 && b != 0.0); break;
+	case kOpOr:  a = (a != 0.0 || b != 0.0); break;
+	case kOpMath2: a = MathFunction(instr.index, a, b); break;
+	default:
+	  assert(false); // not reached
+	  break;
+	}
+      }
+      break;
+    }
+  }
+  return stack[0];
+}
+
+//_____________________________________________________________________________
+Bool_t THcFormula::IsBatchable() const
+{
+  // Check whether the formula can be evaluated by EvalBatch: it must be
+  // compiled and depend only on the current event's values of variables
+  // and results of cuts.
+
+  if( fCode.empty() ) return kFALSE;
+  for( vector<Instr_t>::size_type i=0; i<fCode.size(); ++i ) {
+    switch( fCode[i].op ) {
+    case kOpCutNPassed:
+    case kOpCutNCalled:
+    case kOpArrayFunc:
+      return kFALSE;
+    default:
+      break;
+    }
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Int_t THcFormula::GetBatchColumns( vector<const void*>& obj,
+				   vector<Int_t>& index ) const
+{
+  // Fill obj and index with the per-event inputs of EvalBatch, in the
+  // order it expects them: element index of variable (THaVar*) obj, or
+  // the result of cut (THaCut*) obj if index is -1.  Returns their number.
+
+  obj.clear();
+  index.clear();
+  for( vector<Instr_t>::size_type i=0; i<fCode.size(); ++i ) {
+    const Instr_t& instr = fCode[i];
+    if( instr.op != kOpVar && instr.op != kOpCut ) continue;
+    Int_t idx = (instr.op == kOpCut) ? -1 : instr.index;
+    vector<const void*>::size_type k = 0;
+    while( k < obj.size() && (obj[k] != instr.obj || index[k] != idx) ) k++;
+    if( k == obj.size() ) {
+      obj.push_back(instr.obj);
+      index.push_back(idx);
+    }
+  }
+  return obj.size();
+}
+
+//_____________________________________________________________________________
+Int_t THcFormula::EvalBatch( const Double_t* const* columns, Int_t n,
+			     Double_t* result, UChar_t* invalid )
+{
+  // Evaluate the formula for n events.  columns[k][i] is the value of the
+  // k-th input listed by GetBatchColumns in event i.  The values are
+  // written to result[0..n).  If given, invalid[i] is set to 1 for the
+  // events for which Eval would mark the formula invalid (modulo by
+  // zero); the other elements are left as they are.  Each instruction is
+  // applied to the whole block in a simple loop, which the compiler can
+  // vectorize.  Returns n, or -1 if the formula is not batchable.
+
+  if( !IsBatchable() ) return -1;
+  if( n <= 0 ) return 0;
+
+  fBatch.resize(fStack.size()*n);
+  Double_t* base = &fBatch[0];
+  Int_t top = -1;
+  vector<const void*> cobj;
+  vector<Int_t> cindex;
+  for( vector<Instr_t>::const_iterator it = fCode.begin();
+       it != fCode.end(); ++it ) {
+    const Instr_t& instr = *it;
+    switch( instr.op ) {
+    case kOpConst:
+      {
+	Double_t* s = base + (++top)*n;
+	for( Int_t i=0; i<n; i++ ) s[i] = instr.value;
+      }
+      break;
+    case kOpVar:
+    case kOpCut:
+      {
+	// Column numbers are assigned in order of first use, as in
+	// GetBatchColumns
+	Int_t idx = (instr.op == kOpCut) ? -1 : instr.index;
+	vector<const void*>::size_type k = 0;
+	while( k < cobj.size() && (cobj[k] != instr.obj || cindex[k] != idx) )
+	  k++;
+	if( k == cobj.size() ) {
+	  cobj.push_back(instr.obj);
+	  cindex.push_back(idx);
+	}
+	memcpy(base + (++top)*n, columns[k], n*sizeof(Double_t));
+      }
+      break;
+    case kOpNeg:
+      {
+	Double_t* s = base + top*n;
+	for( Int_t i=0; i<n; i++ ) s[i] = -s[i];
+      }
+      break;
+    case kOpNot:
+      {
+	Double_t* s = base + top*n;
+	for( Int_t i=0; i<n; i++ ) s[i] = (s[i] == 0.0);
+      }
+      break;
+    case kOpMath1:
+      {
+	Double_t* s = base + top*n;
+	for( Int_t i=0; i<n; i++ ) s[i] = MathFunction(instr.index, s[i], 0.0);
+      }
+      break;
+    default:
+      {
+	// Binary operators
+	const Double_t* b = base + top*n;
+	Double_t* a = base + (--top)*n;
+	switch( instr.op ) {
+	case kOpAdd: for( Int_t i=0; i<n; i++ ) a[i] += b[i]; break;
+	case kOpSub: for( Int_t i=0; i<n; i++ ) a[i] -= b[i]; break;
+	case kOpMul: for( Int_t i=0; i<n; i++ ) a[i] *= b[i]; break;
+	case kOpDiv:
+	  for( Int_t i=0; i<n; i++ ) a[i] = (b[i] == 0.0) ? 0.0 : a[i]/b[i];
+	  break;
+	case kOpMod:
+	  for( Int_t i=0; i<n; i++ ) {
+	    Int_t ia = static_cast<Int_t>(a[i]), ib = static_cast<Int_t>(b[i]);
+	    if( ib == 0 ) {
+	      a[i] = 1.0;
+	      if( invalid ) invalid[i] = 1;
+	    } else {
+	      a[i] = ia % ib;
+	    }
+	  }
+	  break;
+	case kOpPow:
+	  for( Int_t i=0; i<n; i++ ) a[i] = TMath::Power(a[i], b[i]);
+	  break;
+	case kOpEq:  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] == b[i]); break;
+	case kOpNe:  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] != b[i]); break;
+	case kOpLt:  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] < b[i]); break;
+	case kOpLe:  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] <= b[i]); break;
+	case kOpGt:  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] > b[i]); break;
+	case kOpGe:  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] >= b[i]); break;
+	case kOpAnd:
+	  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] != 0.0) & (b[i] != 0.0);
+	  break;
+	case kOpOr:
+	  for( Int_t i=0; i<n; i++ ) a[i] = (a[i] != 0.0) | (b[i] != 0.0);
+	  break;
+	case kOpMath2:
+	  for( Int_t i=0; i<n; i++ )
+	    a[i] = MathFunction(instr.index, a[i], b[i]);
+	  break;
+	default:
+	  assert(false); // not reached
+	  break;
+	}
+      }
+      break;
+    }
+  }
+  memcpy(result, base, n*sizeof(Double_t));
+  return n;
+}
+
+//_____________________________________________________________________________
+Double_t THcFormula::MathFunction( Int_t code, Double_t x, Double_t y )
+{
+  // Math function of the compiled form.  log and log10 of non-positive
+  // numbers give 0, as in TFormula.
+
+  switch( code ) {
+  case kSqrt:  return TMath::Sqrt(x);
+  case kAbs:   return TMath::Abs(x);
+  case kExp:   return TMath::Exp(x);
+  case kLog:   return (x > 0) ? TMath::Log(x) : 0.0;
+  case kLog10: return (x > 0) ? TMath::Log10(x) : 0.0;
+  case kSin:   return TMath::Sin(x);
+  case kCos:   return TMath::Cos(x);
+  case kTan:   return TMath::Tan(x);
+  case kASin:  return TMath::ASin(x);
+  case kACos:  return TMath::ACos(x);
+  case kATan:  return TMath::ATan(x);
+  case kATan2: return TMath::ATan2(x, y);
+  case kPow:   return TMath::Power(x, y);
+  }
+  assert(false); // not reached
+  return kBig;
+}
+
+//_____________________________________________________________________________
+Double_t THcFormula::ArrayFunction( Int_t code, const THaVar* var )
+{
+  // Array function of the compiled form, applied to all elements of var.
+  // Same results as the kFormula case of DefinedValue.
+
+  typedef vector<Double_t>::size_type vsiz_t;
+
+  vsiz_t ndata = var->GetLen();
+  if( code == kLength )
+    return ndata;
+  if( ndata == 0 ) {
+    SetBit(kInvalid);
+    return 1.0;
+  }
+  if( code == kNumSetBits ) {
+    Double_t y = var->GetValue(0);
+    if( y > kMaxULong64 || y < kMinLong64 ) {
+      return 0;
+    }
+    return NumberOfSetBits( static_cast<ULong64_t>(y) );
+  }
+
+  vector<Double_t> values;
+  values.reserve(ndata);
+  for( vsiz_t i = 0; i < ndata; ++i ) {
+    values.push_back( var->GetValue(i) );
+  }
+  switch( code ) {
+  case kSum:
+    return accumulate( ALL(values), static_cast<Double_t>(0.0) );
+  case kMean:
+    return TMath::Mean( ndata, &values[0] );
+  case kStdDev:
+    return TMath::RMS( ndata, &values[0] );
+  case kMax:
+    return *max_element( ALL(values) );
+  case kMin:
+    return *min_element( ALL(values) );
+  case kGeoMean:
+    return TMath::GeomMean( ndata, &values[0] );
+  case kMedian:
+    return TMath::Median( ndata, &values[0] );
+  default:
+    assert(false); // not reached
+    break;
+  }
+  return kBig;
+}
+
 //_____________________________________________________________________________
 Int_t THcFormula::DefinedCut( TString& name )
 {
@@ -126,6 +856,7 @@ Int_t THcFormula::DefinedCut( TString& name )
   if( fCutList ) {
     THaCut* pcut = fCutList->FindCut( realname );
     if( pcut ) {
+      AddResolved( realname.Data(), kTRUE, pcut );
       // See if this cut already used earlier in the expression
       for( vector<FVarDef_t>::size_type i=0; i<fVarDef.size(); ++i ) {
 	FVarDef_t& def = fVarDef[i];
@@ -282,20 +1013,19 @@ Int_t THcFormula::DefinedGlobalVariable( TString& name )
   // local list of variables used in this formula.
 
   // No list of variables or too many variables in this formula?
-  if( !fVarList && !fParmList )
+  if( !fVarList && !fParmList && !fLocalVars )
     return -1;
 
   // Parse name for array syntax
   THaArrayString parsed_name(name);
   if( parsed_name.IsError() ) return -1;
 
-  // First check if this name is a Parameter
-  THaVar* var = fParmList->Find( parsed_name.GetName() );
-  if ( !var) {  // If not, find a global variable with this name
-    var = fVarList->Find( parsed_name.GetName() );
-    if( !var )
-      return -1;
-  }
+  // First check if this name is a Parameter, if not, find a global
+  // variable with this name
+  THaVar* var = FindVar( parsed_name.GetName() );
+  if( !var )
+    return -1;
+  AddResolved( parsed_name.GetName(), kFALSE, var );
 
   EVariableType type = kVariable;
   Int_t index = 0;
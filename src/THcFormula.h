@@ -9,8 +9,11 @@
 
 #include "THcGlobals.h"
 #include "THaFormula.h"
+#include <string>
+#include <vector>
 
 class THaParmList;
+class THcFormulaCompiler;
 
 class THcFormula : public THaFormula {
 
@@ -18,19 +21,66 @@ public:
 
   THcFormula( const char* name, const char* formula,
 	      const THcParmList*, const THaVarList*,
-	      const THaCutList* clst);
+	      const THaCutList* clst, const THaVarList* local = 0 );
   THcFormula& operator=( const THcFormula& rhs );
   virtual ~THcFormula();
 
   virtual Double_t DefinedValue( Int_t i);
   virtual Int_t    DefinedCut( TString& variable);
   virtual Int_t    DefinedGlobalVariable( TString& variable);
+  virtual Double_t Eval();
+
+  // Shared, compiled formula for expression.  Owned by the cache.
+  static THcFormula* Get( const char* expression, const THcParmList*,
+			  const THaVarList*, const THaCutList* clst );
+  static void        ClearCache();
+
+  Bool_t IsCompiled() const { return !fCode.empty(); }
+  Bool_t IsCacheable() const { return fCacheable; }
+  Bool_t IsStale() const;
+  // Names of the variables, parameters and cuts used
+  void   GetNames( std::vector<std::string>& names ) const;
+
+  // Evaluation for a block of events at a time, see THcCutBatch
+  Bool_t IsBatchable() const;
+  Int_t  GetBatchColumns( std::vector<const void*>& obj,
+			  std::vector<Int_t>& index ) const;
+  Int_t  EvalBatch( const Double_t* const* columns, Int_t n,
+		    Double_t* result, UChar_t* invalid = 0 );
 
 protected:
 
   enum {kCutScaler = kVarFormula+1};
   enum {kCutNCalled = kCutScaler+1};
   const THcParmList* fParmList; // Pointer to list of parameters
+  const THaVarList*  fLocalVars; //! Variables searched first, if any
+
+  // Instruction of the compiled form of the expression
+  struct Instr_t {
+    Int_t       op;
+    Int_t       index;   // Array element, or function code
+    const void* obj;     // THaVar or THaCut
+    Double_t    value;   // Constant
+  };
+  // Name resolved while compiling, and what it referred to
+  struct Resolved_t {
+    std::string name;
+    Bool_t      cut;
+    const void* obj;
+  };
+  std::vector<Instr_t>    fCode;     //! Compiled expression, if possible
+  std::vector<Double_t>   fStack;    //! Evaluation stack for fCode
+  std::vector<Resolved_t> fResolved; //! Names used
+  std::vector<Double_t>   fBatch;    //! Evaluation stack for EvalBatch
+  Bool_t                  fCacheable; //! All names used are known
+
+  THaVar*  FindVar( const char* name ) const;
+  void     AddResolved( const char* name, Bool_t cut, const void* obj );
+  static Double_t MathFunction( Int_t code, Double_t x, Double_t y );
+  Double_t ArrayFunction( Int_t code, const THaVar* var );
+
+  friend class THcFormulaCompiler;
+
   ClassDef(THcFormula,0) // Formula with cut scalers
 };
 
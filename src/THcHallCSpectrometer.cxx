@@ -49,6 +49,8 @@ THcHallCSpectrometer::THcHallCSpectrometer( const char* name, const char* descri
 
   //sc_ref = static_cast<THaScintillator*>(GetDetector("s1"));
 
+  fReconMatrix = NULL;
+
   SetTrSorting(kTRUE);
 }
 
@@ -60,6 +62,27 @@ THcHallCSpectrometer::~THcHallCSpectrometer()
   DefineVariables( kDelete );
 }
 
+//_____________________________________________________________________________
+void THcHallCSpectrometer::Clear( Option_t* opt )
+{
+  // Clear event-by-event data
+
+  THaSpectrometer::Clear(opt);
+  fTrackProj.Invalidate();
+}
+
+//_____________________________________________________________________________
+const THcTrackProjection* THcHallCSpectrometer::GetTrackProjection()
+{
+  // Return the projections of the tracks of this event to all registered
+  // detector planes. They are computed on the first call after tracking
+  // and shared by all detectors for the rest of the event.
+
+  if( !fTrackProj.IsValid() )
+    fTrackProj.Compute( *fTracks );
+  return &fTrackProj;
+}
+
 //_____________________________________________________________________________
 Int_t THcHallCSpectrometer::DefineVariables( EMode mode )
 {
@@ -98,7 +121,7 @@ Bool_t THcHallCSpectrometer::GetTrSorting() const
 void THcHallCSpectrometer::InitializeReconstruction()
 {
   fNReconTerms = 0;
-  fReconTerms.clear();
+  fReconMatrix = NULL;
   fAngSlope_x = 0.0;
   fAngSlope_y = 0.0;
   fAngOffset_x = 0.0;
@@ -151,8 +174,10 @@ Int_t THcHallCSpectrometer::ReadDatabase( const TDatime& date )
   prefix[1]='\0';
 
   string reconCoeffFilename;
+  string reconCoeffCache;
   DBRequest list[]={
     {"_recon_coeff_filename", &reconCoeffFilename,     kString               },
+    {"_recon_coeff_cache",    &reconCoeffCache,        kString,         0,  1},
     {"theta_offset",          &fThetaOffset,           kDouble               },
     {"phi_offset",            &fPhiOffset,             kDouble               },
     {"delta_offset",          &fDeltaOffset,           kDouble               },
@@ -196,6 +221,14 @@ Int_t THcHallCSpectrometer::ReadDatabase( const TDatime& date )
 
   EnforcePruneLimits();
 
+  // Prune statistics, available to end of run reports
+  fPruneEvents = 0;
+  for(Int_t i=0;i<kNPruneCuts;i++) {
+    fPruneRejected[i] = 0;
+  }
+  gHcParms->Define(Form("%sprune_events",prefix),"Events with tracks to select from by pruning",fPruneEvents);
+  gHcParms->Define(Form("%sprune_rejected[%d]",prefix,kNPruneCuts),"Tracks removed per prune cut",*fPruneRejected);
+
   cout <<  "\n\n\nhodo planes = " << fNPlanes << endl;
   cout <<  "sel using scin = "    << fSelUsingScin << endl;
   cout <<  "fPruneXp = "          <<  fPruneXp << endl;
@@ -220,56 +253,20 @@ Int_t THcHallCSpectrometer::ReadDatabase( const TDatime& date )
   Double_t off_x = 0.0, off_y = 0.0, off_z = 0.0;
   fPointingOffset.SetXYZ( off_x, off_y, off_z );
 
-  //
-  ifstream ifile;
-  ifile.open(reconCoeffFilename.c_str());
-  if(!ifile.is_open()) {
+  // Get the matrix from the shared registry. The coefficient file is only
+  // parsed if no other spectrometer or earlier run has loaded it already
+  // and there is no valid binary cache.
+  Int_t status;
+  fReconMatrix = THcReconMatrix::Get(reconCoeffFilename.c_str(),
+				     reconCoeffCache.c_str(), status);
+  if(!fReconMatrix) {
     Error(here, "error opening reconstruction coefficient file %s",reconCoeffFilename.c_str());
     //    return kInitError; // Is this the right return code?
     return kOK;
   }
-
-  string line="!";
-  int good=1;
-  while(good && line[0]=='!') {
-    good = getline(ifile,line).good();
-    //    cout << line << endl;
-  }
-  // Read in focal plane rotation coefficients
-  // Probably not used, so for now, just paste in fortran code as a comment
-  while(good && line.compare(0,4," ---")!=0) {
-    //  if(line(1:13).eq.'h_ang_slope_x')read(line,1201,err=94)h_ang_slope_x
-    //  if(line(1:13).eq.'h_ang_slope_y')read(line,1201,err=94)h_ang_slope_y
-    //  if(line(1:14).eq.'h_ang_offset_x')read(line,1201,err=94)h_ang_offset_x
-    //  if(line(1:14).eq.'h_ang_offset_y')read(line,1201,err=94)h_ang_offset_y
-    //  if(line(1:14).eq.'h_det_offset_x')read(line,1201,err=94)h_det_offset_x
-    //  if(line(1:14).eq.'h_det_offset_y')read(line,1201,err=94)h_det_offset_y
-    //  if(line(1:14).eq.'h_z_true_focus')read(line,1201,err=94)h_z_true_focus
-    good = getline(ifile,line).good();
-  }
-  // Read in reconstruction coefficients and exponents
-  line=" ";
-  good = getline(ifile,line).good();
-  //  cout << line << endl;
-  fNReconTerms = 0;
-  fReconTerms.clear();
-  fReconTerms.reserve(500);
-  //cout << "Reading matrix elements" << endl;
-  while(good && line.compare(0,4," ---")!=0) {
-    fReconTerms.push_back(reconTerm());
-    sscanf(line.c_str()," %le %le %le %le %1d%1d%1d%1d%1d"
-	   ,&fReconTerms[fNReconTerms].Coeff[0],&fReconTerms[fNReconTerms].Coeff[1]
-	   ,&fReconTerms[fNReconTerms].Coeff[2],&fReconTerms[fNReconTerms].Coeff[3]
-	   ,&fReconTerms[fNReconTerms].Exp[0]
-	   ,&fReconTerms[fNReconTerms].Exp[1]
-	   ,&fReconTerms[fNReconTerms].Exp[2]
-	   ,&fReconTerms[fNReconTerms].Exp[3]
-	   ,&fReconTerms[fNReconTerms].Exp[4]);
-    fNReconTerms++;
-    good = getline(ifile,line).good();
-  }
+  fNReconTerms = fReconMatrix->GetNTerms();
   cout << "Read " << fNReconTerms << " matrix element terms"  << endl;
-  if(!good) {
+  if(status != THcReconMatrix::kReadOK) {
     Error(here, "Error processing reconstruction coefficient file %s",reconCoeffFilename.c_str());
     return kInitError; // Is this the right return code?
   }
@@ -303,11 +300,16 @@ Int_t THcHallCSpectrometer::FindVertices( TClonesArray& tracks )
 
   fNtracks = tracks.GetLast()+1;
 
-  for (Int_t it=0;it<tracks.GetLast()+1;it++) {
+  if( fNtracks <= 0 ) return 0;
+
+  fReconHut.resize(5*fNtracks);
+  fReconSum.resize(4*fNtracks);
+
+  for (Int_t it=0;it<fNtracks;it++) {
     THaTrack* track = static_cast<THaTrack*>( tracks[it] );
 
     Double_t hut[5];
-    Double_t hut_rot[5];
+    Double_t* hut_rot = &fReconHut[5*it];
 
     hut[0] = track->GetX()/100.0 + fZTrueFocus*track->GetTheta() + fDetOffset_x;//m
     hut[1] = track->GetTheta() + fAngOffset_x;//radians
@@ -320,29 +322,24 @@ Int_t THcHallCSpectrometer::FindVertices( TClonesArray& tracks )
 
     // Retrieve the focal plane coordnates
     // Do the transpormation
-    // Stuff results into track
     hut_rot[0] = hut[0];
     hut_rot[1] = hut[1] + hut[0]*fAngSlope_x;
     hut_rot[2] = hut[2];
     hut_rot[3] = hut[3] + hut[2]*fAngSlope_y;
     hut_rot[4] = hut[4];
+  }
+
+  // Compute COSY sums for all tracks of the event at once
+  if(fReconMatrix) {
+    fReconMatrix->Eval(fNtracks, &fReconHut[0], &fReconSum[0], fReconWork);
+  } else {
+    fReconSum.assign(4*fNtracks, 0.0);
+  }
+
+  for (Int_t it=0;it<fNtracks;it++) {
+    THaTrack* track = static_cast<THaTrack*>( tracks[it] );
+    const Double_t* sum = &fReconSum[4*it];
 
-    // Compute COSY sums
-    Double_t sum[4];
-    for(Int_t k=0;k<4;k++) {
-      sum[k] = 0.0;
-    }
-    for(Int_t iterm=0;iterm<fNReconTerms;iterm++) {
-      Double_t term=1.0;
-      for(Int_t j=0;j<5;j++) {
-	if(fReconTerms[iterm].Exp[j]!=0) {
-	  term *= pow(hut_rot[j],fReconTerms[iterm].Exp[j]);
-	}
-      }
-      for(Int_t k=0;k<4;k++) {
-	sum[k] += term*fReconTerms[iterm].Coeff[k];
-      }
-    }
     // Transfer results to track
     // No beam raster yet
     //; In transport coordinates phi = hyptar = dy/dz and theta = hxptar = dx/dz
@@ -587,208 +584,87 @@ Int_t THcHallCSpectrometer::BestTrackUsingScin()
   return(0);
 }
 
+//_____________________________________________________________________________
+void THcHallCSpectrometer::ComputePruneMasks()
+{
+  // Evaluate all prune criteria for all tracks in one pass. Bit i of
+  // fPruneFail[track] is set if the track fails criterion i (EPruneCut).
+  // Without a hodoscope there is no start time, and the focal plane time
+  // criterion is not applied.
+
+  for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
+    THaTrack* track = static_cast<THaTrack*>( fTracks->At(ptrack) );
+
+    Double_t p = track->GetP();
+    Double_t betaP = p / TMath::Sqrt( p * p + fPartMass * fPartMass );
+    Double_t chi2beta = track->GetBetaChi2();
+
+    UInt_t fail = 0;
+    if ( TMath::Abs( track->GetTTheta() ) >= fPruneXp )    fail |= 1<<kPruneXp;
+    if ( TMath::Abs( track->GetTPhi() ) >= fPruneYp )      fail |= 1<<kPruneYp;
+    if ( TMath::Abs( track->GetTY() ) >= fPruneYtar )      fail |= 1<<kPruneYtar;
+    if ( TMath::Abs( track->GetDp() ) >= fPruneDelta )     fail |= 1<<kPruneDelta;
+    if ( TMath::Abs( track->GetBeta() - betaP ) >= fPruneBeta )
+                                                           fail |= 1<<kPruneBeta;
+    if ( track->GetNDoF() < fPruneDf )                     fail |= 1<<kPruneDf;
+    if ( track->GetNPMT() < fPruneNPMT )                   fail |= 1<<kPruneNPMT;
+    if ( ( chi2beta >= fPruneChiBeta ) || ( chi2beta <= 0.01 ) )
+                                                           fail |= 1<<kPruneChiBeta;
+    if ( fHodo &&
+	 TMath::Abs( track->GetFPTime() - fHodo->GetStartTimeCenter() ) >= fPruneFpTime )
+                                                           fail |= 1<<kPruneFpTime;
+    if ( track->GetGoodPlane4() != 1 )                     fail |= 1<<kPruneY2;
+    if ( track->GetGoodPlane3() != 1 )                     fail |= 1<<kPruneX2;
+    fPruneFail[ptrack] = fail;
+  }
+}
+
 //_____________________________________________________________________________
 Int_t THcHallCSpectrometer::BestTrackUsingPrune()
 {
-  Int_t nGood;
+  // Select the golden track by successively pruning the tracks on the
+  // criteria in EPruneCut. A criterion is only applied if at least one of
+  // the remaining tracks passes it. Among the surviving tracks, the one
+  // with the smallest chi2 per degree of freedom is chosen.
+
+  // ENGINE reject codes of the prune criteria, in EPruneCut order
+  static const Int_t kRejectCode[kNPruneCuts] =
+    { 1, 2, 10, 20, 100, 200, 100000, 1000, 2000, 10000, 20000 };
+
   Double_t chi2Min;
 
   if ( fNtracks > 0 ) {
     chi2Min   = 10000000000.0;
     fGoodTrack = 0;
-    Bool_t* keep      = new Bool_t [fNtracks];
-    Int_t* reject    = new Int_t  [fNtracks];
 
     THaTrack *testTracks[fNtracks];
 
-    // ! Initialize all tracks to be good
     for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      keep[ptrack] = kTRUE;
-      reject[ptrack] = 0;
       testTracks[ptrack] = static_cast<THaTrack*>( fTracks->At(ptrack) );
       if (!testTracks[ptrack]) return -1;
     }
 
-    // ! Prune on xptar
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( TMath::Abs( testTracks[ptrack]->GetTTheta() ) < fPruneXp ) && ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if ( nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( TMath::Abs( testTracks[ptrack]->GetTTheta() ) >= fPruneXp ){
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 1;
-	}
-      }
-    }
-
-    // ! Prune on yptar
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( TMath::Abs( testTracks[ptrack]->GetTPhi() ) < fPruneYp ) && ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( TMath::Abs( testTracks[ptrack]->GetTPhi() ) >= fPruneYp ){
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 2;
-
-	}
-      }
-    }
-
-    // !     Prune on ytar
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( TMath::Abs( testTracks[ptrack]->GetTY() ) < fPruneYtar ) && ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( TMath::Abs( testTracks[ptrack]->GetTY() ) >= fPruneYtar ){
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 10;
-	}
-      }
-    }
-
-    // !     Prune on delta
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( TMath::Abs( testTracks[ptrack]->GetDp() ) < fPruneDelta ) && ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( TMath::Abs( testTracks[ptrack]->GetDp() ) >= fPruneDelta ){
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 20;
-	}
-      }
-    }
-
-    // !     Prune on beta
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      Double_t p = testTracks[ptrack]->GetP();
-      Double_t betaP = p / TMath::Sqrt( p * p + fPartMass * fPartMass );
-      if ( ( TMath::Abs( testTracks[ptrack]->GetBeta() - betaP ) < fPruneBeta ) && ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	Double_t p = testTracks[ptrack]->GetP();
-	Double_t betaP = p / TMath::Sqrt( p * p + fPartMass * fPartMass );
-	if ( TMath::Abs( testTracks[ptrack]->GetBeta() - betaP ) >= fPruneBeta ) {
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 100;
-	}
-      }
-    }
-
-    // !     Prune on deg. freedom for track chisq
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( testTracks[ptrack]->GetNDoF() >= fPruneDf ) && ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( testTracks[ptrack]->GetNDoF() < fPruneDf ){
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 200;
-	}
-      }
-    }
-
-    //!     Prune on num pmt hits
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( testTracks[ptrack]->GetNPMT() >= fPruneNPMT ) && ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( testTracks[ptrack]->GetNPMT() < fPruneNPMT ){
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 100000;
-	}
-      }
-    }
-
-    // !     Prune on beta chisqr
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( testTracks[ptrack]->GetBetaChi2() < fPruneChiBeta ) &&
-	   ( testTracks[ptrack]->GetBetaChi2() > 0.01 )          &&   ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( ( testTracks[ptrack]->GetBetaChi2() >= fPruneChiBeta ) ||
-	     ( testTracks[ptrack]->GetBetaChi2() <= 0.01          ) ){
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 1000;
-	}
-      }
-    }
+    // ! Initialize all tracks to be good
+    fPruneFail.resize(fNtracks);
+    fKeep.assign(fNtracks, 1);
+    fReject.assign(fNtracks, 0);
+    fPruneEvents++;
 
-    // !     Prune on fptime
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( TMath::Abs( testTracks[ptrack]->GetFPTime() - fHodo->GetStartTimeCenter() ) < fPruneFpTime )  &&
-	   ( keep[ptrack] ) ){
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( TMath::Abs( testTracks[ptrack]->GetFPTime() - fHodo->GetStartTimeCenter() ) >= fPruneFpTime ) {
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 2000;
-	}
-      }
-    }
+    ComputePruneMasks();
 
-    // !     Prune on Y2 being hit
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( testTracks[ptrack]->GetGoodPlane4() == 1 )  &&  keep[ptrack] ) {
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
+    for (Int_t icut = 0; icut < kNPruneCuts; icut++ ){
+      const UInt_t bit = 1<<icut;
+      Int_t nGood = 0;
       for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( testTracks[ptrack]->GetGoodPlane4() != 1 ) {
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 10000;
-	}
+	if ( fKeep[ptrack] && !(fPruneFail[ptrack] & bit) ) nGood++;
       }
-    }
-
-    // !     Prune on X2 being hit
-    nGood = 0;
-    for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-      if ( ( testTracks[ptrack]->GetGoodPlane3() == 1 )  &&  keep[ptrack] ) {
-	nGood ++;
-      }
-    }
-    if (nGood > 0 ) {
-      for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
-	if ( testTracks[ptrack]->GetGoodPlane3() != 1 ) {
-	  keep[ptrack] = kFALSE;
-	  reject[ptrack] = reject[ptrack] + 20000;
+      if ( nGood > 0 ) {
+	for (Int_t ptrack = 0; ptrack < fNtracks; ptrack++ ){
+	  if ( fPruneFail[ptrack] & bit ) {
+	    if ( fKeep[ptrack] ) fPruneRejected[icut]++;
+	    fKeep[ptrack] = 0;
+	    fReject[ptrack] += kRejectCode[icut];
+	  }
 	}
       }
     }
@@ -799,7 +675,7 @@ Int_t THcHallCSpectrometer::BestTrackUsingPrune()
 
       chi2PerDeg =  testTracks[ptrack]->GetChi2() / testTracks[ptrack]->GetNDoF();
 
-      if ( ( chi2PerDeg < chi2Min ) && ( keep[ptrack] ) ){
+      if ( ( chi2PerDeg < chi2Min ) && ( fKeep[ptrack] ) ){
 	fGoodTrack = ptrack;
 	chi2Min = chi2PerDeg;
       }
@@ -23,6 +23,8 @@
 #include "THcSpacePoint.h"
 #include "THcDriftChamberPlane.h"
 #include "THcDriftChamber.h"
+#include "THcReconMatrix.h"
+#include "THcTrackProjection.h"
 #include "TMath.h"
 
 #include "THaSubDetector.h"
@@ -39,6 +41,7 @@ public:
   THcHallCSpectrometer( const char* name, const char* description );
   virtual ~THcHallCSpectrometer();
 
+  virtual void    Clear( Option_t* opt="" );
   virtual Int_t   ReadDatabase( const TDatime& date );
   virtual void    EnforcePruneLimits();
   virtual Int_t   FindVertices( TClonesArray& tracks );
@@ -59,11 +62,30 @@ public:
   Double_t GetBetaAtPcentral() const { return
       fPcentral/TMath::Sqrt(fPcentral*fPcentral+fPartMass*fPartMass);}
 
+  // Shared projection of the tracks to the detector planes. Planes are
+  // registered at initialization, projections are valid after tracking.
+  Int_t AddProjectionPlane( Double_t z ) { return fTrackProj.AddPlane(z); }
+  const THcTrackProjection* GetTrackProjection();
+
+  // Track prune criteria, in the order they are applied
+  enum EPruneCut { kPruneXp, kPruneYp, kPruneYtar, kPruneDelta, kPruneBeta,
+		   kPruneDf, kPruneNPMT, kPruneChiBeta, kPruneFpTime,
+		   kPruneY2, kPruneX2, kNPruneCuts };
+
+  // Number of tracks removed by each prune criterion so far
+  Int_t GetPruneRejected( Int_t icut ) const
+  { return (icut>=0 && icut<kNPruneCuts) ? fPruneRejected[icut] : 0; }
+
 protected:
   void InitializeReconstruction();
+  void ComputePruneMasks();
 
-  //  Bool_t*      fKeep;
-  //  Int_t*       fReject;
+  // Per-track prune state, reused from event to event
+  std::vector<UInt_t> fPruneFail;  // [fNtracks] bit i set if cut i fails
+  std::vector<UChar_t> fKeep;      // [fNtracks] track survives pruning
+  std::vector<Int_t>  fReject;     // [fNtracks] ENGINE-style reject code
+  Int_t        fPruneEvents;                 // Events with tracks to select from
+  Int_t        fPruneRejected[kNPruneCuts];  // Tracks removed per cut
 
   Double_t     fPartMass;
   Double_t     fPruneXp;
@@ -102,20 +124,14 @@ protected:
   THcShower* fShower;
   THcHodoscope* fHodo;
 
+  THcTrackProjection fTrackProj;   // Tracks projected to detector planes
+
   Int_t fNReconTerms;
-  struct reconTerm {
-    Double_t Coeff[4];
-    Int_t Exp[5];
-    reconTerm() {
-      for(Int_t i=0;i<4;i++) {
-	Coeff[i] = 0.0;
-      }
-      for(Int_t i=0;i<5;i++) {
-	Exp[i] = 0;
-      }
-    }
-  };
-  std::vector<reconTerm> fReconTerms;
+  const THcReconMatrix* fReconMatrix; // Compiled reconstruction matrix
+                                      // (shared, not owned)
+  std::vector<Double_t> fReconHut;    // [fNtracks][5] focal plane coords
+  std::vector<Double_t> fReconSum;    // [fNtracks][4] COSY sums
+  std::vector<Double_t> fReconWork;   // Scratch space for fReconMatrix
   //  Double_t fReconCoeff[fMaxReconElements][4];
   //  Int_t fReconExponents[fMaxReconElements][5];
   Double_t fAngSlope_x;
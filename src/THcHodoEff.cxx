@@ -18,6 +18,7 @@
 
 #include "THcHodoEff.h"
 #include "THaApparatus.h"
+#include "THcHallCSpectrometer.h"
 #include "THcHodoHit.h"
 #include "THcGlobals.h"
 #include "THcParmList.h"
@@ -128,10 +129,14 @@ Int_t THcHodoEff::ReadDatabase( const TDatime& date )
   fNCounters = new Int_t[fNPlanes];
   fHodoSlop = new Double_t[fNPlanes];
 
+  THcHallCSpectrometer* app = static_cast<THcHallCSpectrometer*>(fSpectro);
+  fProjPlane.resize(fNPlanes);
+
   Int_t maxcountersperplane=0;
   for(Int_t ip=0;ip<fNPlanes;ip++) {
     fPlanes[ip] = fHod->GetPlane(ip);
     fPosZ[ip] = fPlanes[ip]->GetZpos() + 0.5*fPlanes[ip]->GetDzpos();
+    fProjPlane[ip] = app->AddProjectionPlane(fPosZ[ip]);
     fSpacing[ip] = fPlanes[ip]->GetSpacing();
     fCenterFirst[ip] = fPlanes[ip]->GetPosCenter(0) + fPlanes[ip]->GetPosOffset();
     fNCounters[ip] = fPlanes[ip]->GetNelem();
@@ -206,6 +211,10 @@ Int_t THcHodoEff::ReadDatabase( const TDatime& date )
   gHcParms->Define(Form("%shodo_or_eff[%d]",   prefix,totalpaddles), "Hodo or effi",      *fHodoOrEffi);
   gHcParms->Define(Form("%shodo_and_eff[%d]",  prefix,totalpaddles), "Hodo and effi",     *fHodoAndEffi);
   gHcParms->Define(Form("%shodo_gold_hits[%d]",prefix,totalpaddles), "Hodo golden hits",  *fStatTrk);
+  const char* const accumulators[] = { "hodo_pos_eff", "hodo_neg_eff",
+    "hodo_or_eff", "hodo_and_eff", "hodo_gold_hits", 0 };
+  for( const char* const* acc = accumulators; *acc; acc++ )
+    gHcParms->AddAccumulator(Form("%s%s",prefix,*acc));
 
   return kOK;
 }
@@ -252,6 +261,12 @@ Int_t THcHodoEff::Process( const THaEvData& evdata )
   if(!theTrack) return 0;
   Int_t trackIndex = theTrack->GetTrkNum()-1;
 
+  // Track coordinates at the planes from the spectrometer's projections
+  const THcTrackProjection* proj =
+    static_cast<THcHallCSpectrometer*>(fSpectro)->GetTrackProjection();
+  Int_t iproj = proj->GetTrackIndex(theTrack);
+  if(iproj < 0) return 0;
+
   // May make these member variables
   Double_t hitPos[fNPlanes];
   Double_t hitDistance[fNPlanes];
@@ -263,7 +278,7 @@ Int_t THcHodoEff::Process( const THaEvData& evdata )
   for(Int_t ip=0;ip<fNPlanes;ip++) {
     // Should really have plane object self identify as X or Y
     if(ip%2 == 0) {		// X Plane
-      hitPos[ip] = theTrack->GetX() + theTrack->GetTheta()*fPosZ[ip];
+      hitPos[ip] = proj->GetX(iproj, fProjPlane[ip]);
       hitCounter[ip] = TMath::Max(
 		       TMath::Min(
 		       TMath::Nint((hitPos[ip]-fCenterFirst[ip])/
@@ -271,7 +286,7 @@ Int_t THcHodoEff::Process( const THaEvData& evdata )
       hitDistance[ip] =  hitPos[ip] - (fSpacing[ip]*(hitCounter[ip]-1) +
 				       fCenterFirst[ip]);
     } else {			// Y Plane
-      hitPos[ip] = theTrack->GetY() + theTrack->GetPhi()*fPosZ[ip];
+      hitPos[ip] = proj->GetY(iproj, fProjPlane[ip]);
       hitCounter[ip] = TMath::Max(
 		       TMath::Min(
 		       TMath::Nint((fCenterFirst[ip]-hitPos[ip])/
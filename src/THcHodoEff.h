@@ -58,6 +58,7 @@ protected:
   Int_t fNPlanes;
   THcScintillatorPlane** fPlanes;
   Double_t* fPosZ;
+  vector<Int_t> fProjPlane;	// [fNPlanes] spectrometer projection plane
   Double_t* fSpacing;
   Double_t* fCenterFirst;
   Int_t* fNCounters;
@@ -171,6 +171,18 @@ void THcHodoscope::Setup(const char* name, const char* description)
 THaAnalysisObject::EStatus THcHodoscope::Init( const TDatime& date )
 {
   cout << "In THcHodoscope::Init()" << endl;
+  // Pedestals are calculated on the first event that is not a pedestal
+  // event, also from the sums restored by a resumed replay
+  fAnalyzePedestals = 1;
+
+  // Nothing to do if the parameters and the detector map are unchanged
+  // since the last successful Init
+  if( fParmUsage.IsUpToDate() ) {
+    fParmUsage.Reuse();
+    return fStatus = kOK;
+  }
+  fParmUsage.Start();
+
   Setup(GetName(), GetTitle());
 
   char EngineDID[] = "xSCIN";
@@ -178,6 +190,7 @@ THaAnalysisObject::EStatus THcHodoscope::Init( const TDatime& date )
   if( gHcDetectorMap->FillMap(fDetMap, EngineDID) < 0 ) {
     static const char* const here = "Init()";
     Error( Here(here), "Error filling detectormap for %s.", EngineDID );
+    fParmUsage.Stop(kFALSE);
     return kInitError;
   }
 
@@ -190,15 +203,28 @@ THaAnalysisObject::EStatus THcHodoscope::Init( const TDatime& date )
 
   EStatus status;
   // This triggers call of ReadDatabase and DefineVariables
-  if( (status = THaNonTrackingDetector::Init( date )) )
+  if( (status = THaNonTrackingDetector::Init( date )) ) {
+    fParmUsage.Stop(kFALSE);
     return fStatus=status;
+  }
 
   for(Int_t ip=0;ip<fNPlanes;ip++) {
     if((status = fPlanes[ip]->Init( date ))) {
+      fParmUsage.Stop(kFALSE);
       return fStatus=status;
     }
   }
 
+  // Register the z positions of the even and odd paddles of each plane
+  // for the spectrometer's shared track projection.
+  THcHallCSpectrometer *app = static_cast<THcHallCSpectrometer*>(GetApparatus());
+  fProjPlane.resize(2*fNPlanes);
+  for(Int_t ip=0;ip<fNPlanes;ip++) {
+    Double_t zPos = fPlanes[ip]->GetZpos();
+    fProjPlane[2*ip]   = app->AddProjectionPlane(zPos);
+    fProjPlane[2*ip+1] = app->AddProjectionPlane(zPos + fPlanes[ip]->GetDzpos());
+  }
+
   // Replace with what we need for Hall C
   //  const DataDest tmp[NDEST] = {
   //    { &fRTNhit, &fRANhit, fRT, fRT_c, fRA, fRA_p, fRA_c, fROff, fRPed, fRGain },
@@ -220,6 +246,9 @@ THaAnalysisObject::EStatus THcHodoscope::Init( const TDatime& date )
   // }
 
 
+  fParmUsage.Stop(kTRUE);
+
+
   return fStatus = kOK;
 }
 //_____________________________________________________________________________
@@ -859,6 +888,9 @@ Int_t THcHodoscope::FineProcess( TClonesArray& tracks )
 
   if (tracks.GetLast()+1 > 0 ) {
 
+    THcHallCSpectrometer *app = static_cast<THcHallCSpectrometer*>(GetApparatus());
+    const THcTrackProjection* proj = app->GetTrackProjection();
+
     // **MAIN LOOP: Loop over all tracks and get corrected time, tof, beta...
     Double_t* nPmtHit = new Double_t [ntracks];
     Double_t* timeAtFP = new Double_t [ntracks];
@@ -868,6 +900,8 @@ Int_t THcHodoscope::FineProcess( TClonesArray& tracks )
 
       THaTrack* theTrack = dynamic_cast<THaTrack*>( tracks.At(itrack) );
       if (!theTrack) return -1;
+      Int_t iproj = proj->GetTrackIndex( theTrack );
+      if (iproj < 0) return -1;
 
       for (Int_t ip = 0; ip < fNPlanes; ip++ ){
 	fGoodPlaneTime[ip] = kFALSE;
@@ -942,11 +976,9 @@ Int_t THcHodoscope::FineProcess( TClonesArray& tracks )
 	  Int_t paddle = hit->GetPaddleNumber()-1;
 	  Double_t zposition = zPos + (paddle%2)*dzPos;
 
-	  Double_t xHitCoord = theTrack->GetX() + theTrack->GetTheta() *
-	    ( zposition ); // Line 183
+	  Double_t xHitCoord = proj->GetX( iproj, fProjPlane[2*ip+paddle%2] ); // Line 183
 
-	  Double_t yHitCoord = theTrack->GetY() + theTrack->GetPhi() *
-	    ( zposition ); // Line 184
+	  Double_t yHitCoord = proj->GetY( iproj, fProjPlane[2*ip+paddle%2] ); // Line 184
 
 	  Double_t scinTrnsCoord, scinLongCoord;
 	  if ( ( ip == 0 ) || ( ip == 2 ) ){ // !x plane. Line 185
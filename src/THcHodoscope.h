@@ -17,6 +17,7 @@
 #include "THcScintillatorPlane.h"
 #include "THcShower.h"
 #include "THcCherenkov.h"
+#include "THcParmUsage.h"
 
 #include "THaTrackingDetector.h"
 #include "THcHitList.h"
@@ -175,6 +176,10 @@ protected:
   TClonesArray*  fTrackProj;  // projection of track onto scintillator plane
                               // and estimated match to TOF paddle
 
+  std::vector<Int_t> fProjPlane; // [2*fNPlanes] spectrometer projection
+                                 // planes for even and odd paddles
+  THcParmUsage fParmUsage;  //! Parameters read by the last Init
+
   //--------------------------   Ahmed   -----------------------------
 
   THcShower* fShower;
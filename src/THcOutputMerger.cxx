@@ -0,0 +1,325 @@
+/** \class THcOutputMerger
+    \ingroup Base
+
+ Merge the ROOT output files of several replay workers.
+
+ The entries of the event tree ("T") are copied range by range, in the
+ order the ranges were added, so that the merged tree has the order of
+ a serial replay.  Histograms, including the run totals written by
+ THcAnalyzer::WriteTotals, are summed over all inputs, except those
+ declared with SetUnsummed, e.g. histograms filled on scaler or control
+ events that every worker analyzes.  These and the other objects, e.g.
+ the scaler trees of THcScalerEvtHandler, are copied from the primary
+ input, which must be one that saw all scaler events.
+
+ With SetConcatenate, all trees are concatenated over the inputs, and
+ LimitEntries drops the tree entries an input has beyond given numbers.
+ THcAnalyzer uses this to append the output of a resumed replay to the
+ output written up to the checkpoint it resumed from.
+
+ Verify compares the merged file with the output of a serial replay.
+
+*/
+
+#include "THcOutputMerger.h"
+#include "TFile.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TKey.h"
+#include "TH1.h"
+#include "TLeaf.h"
+#include "TBranch.h"
+#include "TObjArray.h"
+#include "TList.h"
+#include "TError.h"
+#include "TMath.h"
+
+#include <set>
+#include <string>
+
+using namespace std;
+
+//_____________________________________________________________________________
+THcOutputMerger::THcOutputMerger( const char* outfile, const char* treename ) :
+  fOutFile(outfile), fTreeName(treename), fPrimary(0), fConcatenate(kFALSE)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+Int_t THcOutputMerger::AddInput( const char* file )
+{
+  fInputs.push_back(file);
+  return fInputs.size()-1;
+}
+
+//_____________________________________________________________________________
+void THcOutputMerger::AddRange( Int_t input, Long64_t first, Long64_t last )
+{
+  Range_t range;
+  range.input = input;
+  range.first = first;
+  range.last = last;
+  fRanges.push_back(range);
+}
+
+//_____________________________________________________________________________
+void THcOutputMerger::LimitEntries( Int_t input,
+				    const map<string,Long64_t>& entries )
+{
+  fLimits[input] = entries;
+}
+
+//_____________________________________________________________________________
+Long64_t THcOutputMerger::GetLimit( Int_t input, const char* tree,
+				    Long64_t n ) const
+{
+  // Entries of tree of input to take, of the n it has
+
+  map< Int_t, map<string,Long64_t> >::const_iterator it = fLimits.find(input);
+  if( it == fLimits.end() ) return n;
+  map<string,Long64_t>::const_iterator lim = it->second.find(tree);
+  if( lim == it->second.end() ) return 0;
+  return TMath::Min(n, lim->second);
+}
+
+//_____________________________________________________________________________
+Long64_t THcOutputMerger::Merge()
+{
+  // Write the merged output file
+
+  if( fInputs.empty() ) return -1;
+
+  vector<TFile*> in;
+  vector<Long64_t> offset, nentries;
+  TChain chain(fTreeName);
+  Long64_t total = 0, inchain = 0;
+  Bool_t ok = kTRUE;
+  for( UInt_t i = 0; i < fInputs.size(); i++ ) {
+    TFile* f = TFile::Open(fInputs[i]);
+    if( !f || f->IsZombie() ) {
+      Error("THcOutputMerger::Merge", "Cannot open worker output %s",
+	    fInputs[i].Data());
+      delete f;
+      ok = kFALSE;
+      break;
+    }
+    in.push_back(f);
+    TTree* tree = dynamic_cast<TTree*>(f->Get(fTreeName));
+    Long64_t n = tree ? tree->GetEntries() : 0;
+    offset.push_back(inchain);
+    nentries.push_back(GetLimit(i, fTreeName, n));
+    inchain += n;
+    total += nentries.back();
+    if( tree ) chain.Add(fInputs[i]);
+  }
+
+  Long64_t nwritten = -1;
+  TFile* out = 0;
+  if( ok ) {
+    out = new TFile(fOutFile, "RECREATE");
+    if( out->IsZombie() ) {
+      Error("THcOutputMerger::Merge", "Cannot create %s", fOutFile.Data());
+      ok = kFALSE;
+    }
+  }
+  if( ok ) {
+    nwritten = 0;
+    if( total > 0 ) {
+      vector<Range_t> ranges = fRanges;
+      if( ranges.empty() ) {
+	for( UInt_t i = 0; i < in.size(); i++ ) {
+	  Range_t range = { static_cast<Int_t>(i), 0, -1 };
+	  ranges.push_back(range);
+	}
+      }
+      out->cd();
+      TTree* tree = chain.CloneTree(0);
+      for( UInt_t k = 0; k < ranges.size(); k++ ) {
+	const Range_t& range = ranges[k];
+	Long64_t last = range.last;
+	if( last < 0 || last > nentries[range.input] )
+	  last = nentries[range.input];
+	for( Long64_t e = range.first; e < last; e++ ) {
+	  chain.GetEntry(offset[range.input]+e);
+	  tree->Fill();
+	  nwritten++;
+	}
+      }
+      out->cd();
+      tree->Write();
+    }
+    MergeOther(out, in);
+    out->Close();
+  }
+  delete out;
+  for( UInt_t i = 0; i < in.size(); i++ )
+    delete in[i];
+  return nwritten;
+}
+
+//_____________________________________________________________________________
+void THcOutputMerger::MergeOther( TFile* out, vector<TFile*>& in )
+{
+  // Copy the objects other than the event tree from the primary input,
+  // summing histograms over all inputs unless declared unsummed
+
+  Int_t primary = (fPrimary >= 0 && fPrimary < (Int_t)in.size()) ? fPrimary : 0;
+  set<string> done;
+  TIter next(in[primary]->GetListOfKeys());
+  while( TKey* key = static_cast<TKey*>(next()) ) {
+    string name = key->GetName();
+    if( name == fTreeName.Data() || !done.insert(name).second ) continue;
+    TObject* obj = key->ReadObj();
+    if( !obj ) continue;
+    out->cd();
+    if( fConcatenate && obj->InheritsFrom("TTree") ) {
+      ConcatTree(out, in, name.c_str());
+    } else if( TTree* tree = dynamic_cast<TTree*>(obj) ) {
+      TTree* copy = tree->CloneTree(-1, "fast");
+      copy->Write();
+      delete copy;
+    } else if( TH1* hist = dynamic_cast<TH1*>(obj) ) {
+      hist->SetDirectory(0);
+      Bool_t sum = (fUnsummed.find(name) == fUnsummed.end());
+      for( Int_t i = 0; sum && i < (Int_t)in.size(); i++ ) {
+	if( i == primary ) continue;
+	TH1* other = dynamic_cast<TH1*>(in[i]->Get(name.c_str()));
+	if( other ) hist->Add(other);
+      }
+      out->cd();
+      hist->Write(name.c_str());
+    } else if( !obj->InheritsFrom("TDirectory") ) {
+      obj->Write(name.c_str());
+    }
+    delete obj;
+  }
+}
+
+//_____________________________________________________________________________
+void THcOutputMerger::ConcatTree( TFile* out, vector<TFile*>& in,
+				  const char* name )
+{
+  // Write the entries of tree name of all inputs, in input order
+
+  TChain chain(name);
+  vector<Long64_t> offset, nentries;
+  Long64_t inchain = 0;
+  for( UInt_t i = 0; i < in.size(); i++ ) {
+    TTree* tree = dynamic_cast<TTree*>(in[i]->Get(name));
+    Long64_t n = tree ? tree->GetEntries() : 0;
+    offset.push_back(inchain);
+    nentries.push_back(GetLimit(i, name, n));
+    inchain += n;
+    if( tree ) chain.Add(fInputs[i]);
+  }
+  out->cd();
+  TTree* tree = chain.CloneTree(0);
+  if( !tree ) return;
+  for( UInt_t i = 0; i < in.size(); i++ ) {
+    for( Long64_t e = 0; e < nentries[i]; e++ ) {
+      chain.GetEntry(offset[i]+e);
+      tree->Fill();
+    }
+  }
+  out->cd();
+  tree->Write();
+  delete tree;
+}
+
+//_____________________________________________________________________________
+Int_t THcOutputMerger::Verify( const char* reference ) const
+{
+  // Compare the merged output with reference
+
+  TFile* ref = TFile::Open(reference);
+  TFile* out = TFile::Open(fOutFile);
+  if( !ref || ref->IsZombie() || !out || out->IsZombie() ) {
+    Error("THcOutputMerger::Verify", "Cannot open %s or %s", reference,
+	  fOutFile.Data());
+    delete ref;
+    delete out;
+    return -1;
+  }
+
+  Int_t ndiff = 0, nobj = 0;
+  set<string> done;
+  TIter next(ref->GetListOfKeys());
+  while( TKey* key = static_cast<TKey*>(next()) ) {
+    string name = key->GetName();
+    if( !done.insert(name).second ) continue;
+    TObject* obj = key->ReadObj();
+    TObject* other = out->Get(name.c_str());
+    Bool_t same = kTRUE, compared = kTRUE;
+    if( TTree* tree = dynamic_cast<TTree*>(obj) )
+      same = SameTree(tree, dynamic_cast<TTree*>(other));
+    else if( TH1* hist = dynamic_cast<TH1*>(obj) )
+      same = SameHist(hist, dynamic_cast<TH1*>(other));
+    else
+      compared = kFALSE;
+    delete other;
+    delete obj;
+    if( !compared ) continue;
+    nobj++;
+    if( !same ) {
+      Warning("THcOutputMerger::Verify", "%s differs from the reference",
+	      name.c_str());
+      ndiff++;
+    }
+  }
+  Info("THcOutputMerger::Verify", "%d of %d objects differ from %s", ndiff,
+       nobj, reference);
+  delete ref;
+  delete out;
+  return ndiff;
+}
+
+//_____________________________________________________________________________
+Bool_t THcOutputMerger::SameTree( TTree* ref, TTree* tree )
+{
+  // Whether tree has the same entries as ref for all leaves of ref
+
+  if( !tree || tree->GetEntries() != ref->GetEntries() ) return kFALSE;
+
+  TObjArray* leaves = ref->GetListOfLeaves();
+  vector<TLeaf*> rleaf, tleaf;
+  for( Int_t i = 0; i < leaves->GetEntriesFast(); i++ ) {
+    TLeaf* leaf = static_cast<TLeaf*>(leaves->At(i));
+    TBranch* branch = tree->GetBranch(leaf->GetBranch()->GetName());
+    TLeaf* match = branch ? branch->GetLeaf(leaf->GetName()) : 0;
+    if( !match ) return kFALSE;
+    rleaf.push_back(leaf);
+    tleaf.push_back(match);
+  }
+  for( Long64_t e = 0; e < ref->GetEntries(); e++ ) {
+    ref->GetEntry(e);
+    tree->GetEntry(e);
+    for( UInt_t i = 0; i < rleaf.size(); i++ ) {
+      Int_t len = rleaf[i]->GetLen();
+      if( tleaf[i]->GetLen() != len ) return kFALSE;
+      for( Int_t k = 0; k < len; k++ ) {
+	Double_t a = rleaf[i]->GetValue(k), b = tleaf[i]->GetValue(k);
+	if( a != b && !(TMath::IsNaN(a) && TMath::IsNaN(b)) )
+	  return kFALSE;
+      }
+    }
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcOutputMerger::SameHist( const TH1* ref, const TH1* hist )
+{
+  // Whether hist has the same bin contents as ref
+
+  if( !hist || hist->GetNbinsX() != ref->GetNbinsX() ||
+      hist->GetNbinsY() != ref->GetNbinsY() ||
+      hist->GetNbinsZ() != ref->GetNbinsZ() )
+    return kFALSE;
+  Int_t nbins = (ref->GetNbinsX()+2)*(ref->GetNbinsY()+2)*(ref->GetNbinsZ()+2);
+  for( Int_t bin = 0; bin < nbins; bin++ ) {
+    if( ref->GetBinContent(bin) != hist->GetBinContent(bin) )
+      return kFALSE;
+  }
+  return kTRUE;
+}
@@ -0,0 +1,82 @@
+#ifndef ROOT_THcOutputMerger
+#define ROOT_THcOutputMerger
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcOutputMerger
+//
+// Merge the output files of several replay workers into one file, with
+// the entries of the event tree in a given order.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include "TString.h"
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+
+class TFile;
+class TTree;
+class TH1;
+
+class THcOutputMerger {
+
+public:
+  THcOutputMerger( const char* outfile, const char* treename = "T" );
+
+  // Add a worker output file.  Returns its index.
+  Int_t    AddInput( const char* file );
+  // Entries [first,last) of the event tree of input go next in the
+  // output.  last < 0 means up to the end of the tree.  Without any
+  // ranges, the inputs are concatenated in the order they were added.
+  void     AddRange( Int_t input, Long64_t first, Long64_t last );
+  // Input to take the objects other than the event tree and histograms
+  // from (default: the first)
+  void     SetPrimary( Int_t input ) { fPrimary = input; }
+  // Take histogram name from the primary input instead of summing it,
+  // e.g. one filled on the events that every worker analyzes
+  void     SetUnsummed( const char* name ) { fUnsummed.insert(name); }
+  // Concatenate the other trees over the inputs as well, instead of
+  // copying them from the primary input
+  void     SetConcatenate( Bool_t concat = kTRUE ) { fConcatenate = concat; }
+  // Take only the first entries[name] entries of each tree name of
+  // input, and none of the trees not listed, e.g. to drop what a
+  // replay wrote after its last checkpoint
+  void     LimitEntries( Int_t input,
+			 const std::map<std::string,Long64_t>& entries );
+
+  // Write the merged file.  Returns the number of event tree entries
+  // written, or -1 on error.
+  Long64_t Merge();
+
+  // Compare the merged file with reference, e.g. the output of a serial
+  // replay: every tree entry by entry and every histogram bin by bin.
+  // Objects missing in reference are not compared.  Returns the number
+  // of objects that differ, or -1 if a file cannot be opened.
+  Int_t    Verify( const char* reference ) const;
+
+protected:
+  struct Range_t {
+    Int_t    input;
+    Long64_t first, last;
+  };
+
+  TString fOutFile;
+  TString fTreeName;
+  std::vector<TString> fInputs;
+  std::vector<Range_t> fRanges;
+  Int_t   fPrimary;
+  Bool_t  fConcatenate;
+  std::set<std::string> fUnsummed;
+  std::map< Int_t, std::map<std::string,Long64_t> > fLimits;
+
+  Long64_t GetLimit( Int_t input, const char* tree, Long64_t n ) const;
+  void MergeOther( TFile* out, std::vector<TFile*>& in );
+  void ConcatTree( TFile* out, std::vector<TFile*>& in, const char* name );
+  static Bool_t SameTree( TTree* ref, TTree* tree );
+  static Bool_t SameHist( const TH1* ref, const TH1* hist );
+};
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef ROOT_THcParmHandle
+#define ROOT_THcParmHandle
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcParmHandle
+//
+// Typed handle to one element of a numeric parameter in a THcParmList.
+//
+// The parameter is looked up by name once, when the handle is bound
+// (typically in ReadDatabase).  Get() then costs a comparison of the
+// list's generation counter and a pointer dereference.  The lookup is
+// repeated only when a parameter of the list has been defined, removed
+// or replaced (by Load, DefineAccumulator, ...), since that may move
+// the parameter's storage.
+//
+// Each handle keeps a version number that is incremented whenever the
+// value it returns changes, so that a detector can cache quantities
+// derived from the parameter:
+//
+//   if( fBeamMom.GetVersion() != fBeamMomVersion ) {
+//     fMomRatio = fFrCalMom/fBeamMom.Get();
+//     fBeamMomVersion = fBeamMom.GetVersion();
+//   }
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "THcParmList.h"
+#include "THaVar.h"
+#include "TMath.h"
+#include <string>
+
+template<class T>
+class THcParmHandle {
+
+public:
+  THcParmHandle() : fList(0), fIndex(0), fDefault(T()), fType(-1),
+    fPtr(0), fGeneration(0), fValue(T()), fVersion(0) {}
+
+  // Bind to element index of parameter name in list.  If the parameter
+  // does not exist, Get() returns def until it is defined by a Load.
+  // Returns kFALSE if the parameter does not exist (yet).
+  Bool_t Bind( THcParmList* list, const char* name, T def = T(),
+	       Int_t index = 0 ) {
+    fList = list;
+    fName = name;
+    fIndex = index;
+    fDefault = def;
+    Resolve();
+    // Versions start at 1, so that a cache marked with version 0 is
+    // always out of date
+    UInt_t version = fVersion;
+    Update();
+    if( fVersion == version ) fVersion++;
+    return IsFound();
+  }
+
+  Bool_t IsBound() const { return fList != 0; }
+  Bool_t IsFound() const { Sync(); return fPtr != 0; }
+  const char* GetName() const { return fName.c_str(); }
+
+  // Current value
+  T Get() const { Update(); return fValue; }
+  operator T() const { return Get(); }
+
+  // Incremented every time the value changes
+  UInt_t GetVersion() const { Update(); return fVersion; }
+
+private:
+  THcParmList* fList;
+  std::string  fName;
+  Int_t        fIndex;
+  T            fDefault;
+
+  // Resolved storage, valid while the list generation is unchanged
+  mutable Int_t       fType;
+  mutable const void* fPtr;
+  mutable UInt_t      fGeneration;
+
+  mutable T      fValue;
+  mutable UInt_t fVersion;
+
+  void Resolve() const {
+    fType = -1;
+    fPtr = 0;
+    fGeneration = fList ? fList->GetGeneration() : 0;
+    const THaVar* var = fList ? fList->Find(fName.c_str()) : 0;
+    if( !var || fIndex < 0 || fIndex >= var->GetLen() ) return;
+    if( var->GetType() == kInt ) {
+      fType = kInt;
+      fPtr = static_cast<const Int_t*>(var->GetValuePointer()) + fIndex;
+    } else if( var->GetType() == kDouble ) {
+      fType = kDouble;
+      fPtr = static_cast<const Double_t*>(var->GetValuePointer()) + fIndex;
+    }
+  }
+  void Sync() const {
+    if( fList && fGeneration != fList->GetGeneration() ) Resolve();
+  }
+  void Update() const {
+    Sync();
+    T value = fDefault;
+    if( fType == kInt ) {
+      value = static_cast<T>(*static_cast<const Int_t*>(fPtr));
+    } else if( fType == kDouble ) {
+      value = Convert(*static_cast<const Double_t*>(fPtr), value);
+    }
+    if( value != fValue ) {
+      fValue = value;
+      fVersion++;
+    }
+  }
+  // Round when an integer handle refers to a floating point parameter
+  static Int_t Convert( Double_t x, Int_t ) { return TMath::Nint(x); }
+  static Double_t Convert( Double_t x, Double_t ) { return x; }
+};
+
+#endif
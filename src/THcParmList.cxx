@@ -21,13 +21,14 @@ An instance of THaTextvars is created to hold the string parameters.
 
 #define INCLUDESTR "#include"
 
-#include "TObjArray.h"
-#include "TObjString.h"
 #include "TSystem.h"
 
 #include "THcParmList.h"
+#include "THcParmSnapshot.h"
+#include "THcRunRangeIndex.h"
+#include "THcParmUsage.h"
 #include "THaVar.h"
-#include "THaFormula.h"
+#include "THcFormula.h"
 
 #include "TMath.h"
 
@@ -35,8 +36,10 @@ An instance of THaTextvars is created to hold the string parameters.
 #include <iostream>
 #include <fstream>
 #include <cassert>
+#include <cctype>
 #include <cstdlib>
 #include <stdexcept>
+#include <algorithm>
 
 using namespace std;
 Int_t  fDebug   = 1;  // Keep this at one while we're working on the code
@@ -44,7 +47,8 @@ Int_t  fDebug   = 1;  // Keep this at one while we're working on the code
 ClassImp(THcParmList)
 
 /// Create empty numerical and string parameter lists
-THcParmList::THcParmList() : THaVarList()
+THcParmList::THcParmList() : THaVarList(), fRecorder(0), fGeneration(0),
+  fChangeSerial(0), fUsage(0)
 {
   TextList = new THaTextvars;
 }
@@ -52,7 +56,127 @@ THcParmList::THcParmList() : THaVarList()
 inline static bool IsComment( const string& s, string::size_type pos )
 {
   return ( pos != string::npos && pos < s.length() &&
-	   (s[pos] == '#' || s[pos] == ';' || s.substr(pos,2) == "//") );
+	   (s[pos] == '#' || s[pos] == ';' || s.compare(pos,2,"//") == 0) );
+}
+
+inline static bool IsNumberStart( const char* s )
+{
+  // Could s be a plain number (as opposed to an expression)?
+  if( *s == '+' || *s == '-' ) s++;
+  if( *s == '.' ) s++;
+  return isdigit(*s);
+}
+
+inline static bool IsIntLiteral( const char* s )
+{
+  // Is s an optionally signed string of decimal digits?
+  if( *s == '+' || *s == '-' ) s++;
+  if( !*s ) return false;
+  for( ; *s; s++ )
+    if( !isdigit(*s) ) return false;
+  return true;
+}
+
+//_____________________________________________________________________________
+// Recursive descent evaluator for the arithmetic expressions found in CTP
+// parameter files, e.g. "(90.-0.071)*raddeg" or "hdc_1_zpos-3.6".
+// Supports + - * / ^ ** and parentheses on numbers, parameters and
+// parameter array elements (name[index]).  Parse() fails on anything
+// else, so that the caller can fall back to THcFormula.
+namespace {
+class CTPExprParser {
+public:
+  CTPExprParser( THaVarList* vars, const char* expr )
+    : fVars(vars), fPos(expr), fOK(true) {}
+  bool Parse( Double_t& val ) {
+    val = Expr();
+    return fOK && *fPos == '\0';
+  }
+  // Parameters used by the expression
+  const vector<string>& GetNames() const { return fNames; }
+private:
+  THaVarList* fVars;
+  const char* fPos;
+  bool        fOK;
+  vector<string> fNames;
+
+  Double_t Fail() { fOK = false; return 0; }
+  Double_t Expr() {
+    Double_t val = Term();
+    while( fOK ) {
+      if( *fPos == '+' )      { fPos++; val += Term(); }
+      else if( *fPos == '-' ) { fPos++; val -= Term(); }
+      else break;
+    }
+    return val;
+  }
+  Double_t Term() {
+    Double_t val = Unary();
+    while( fOK ) {
+      if( *fPos == '*' && fPos[1] != '*' ) { fPos++; val *= Unary(); }
+      else if( *fPos == '/' )              { fPos++; val /= Unary(); }
+      else break;
+    }
+    return val;
+  }
+  Double_t Unary() {
+    if( *fPos == '+' ) { fPos++; return Unary(); }
+    if( *fPos == '-' ) { fPos++; return -Unary(); }
+    return Power();
+  }
+  Double_t Power() {
+    Double_t val = Primary();
+    if( !fOK ) return val;
+    if( *fPos == '^' ) {
+      fPos++;
+      return TMath::Power(val, Unary());
+    }
+    if( fPos[0] == '*' && fPos[1] == '*' ) {
+      fPos += 2;
+      return TMath::Power(val, Unary());
+    }
+    return val;
+  }
+  Double_t Primary() {
+    if( *fPos == '(' ) {
+      fPos++;
+      Double_t val = Expr();
+      if( !fOK || *fPos != ')' ) return Fail();
+      fPos++;
+      return val;
+    }
+    if( isdigit(*fPos) || *fPos == '.' ) {
+      if( fPos[0] == '0' && (fPos[1] == 'x' || fPos[1] == 'X') )
+	return Fail();
+      char* end;
+      Double_t val = strtod(fPos, &end);
+      if( end == fPos ) return Fail();
+      fPos = end;
+      return val;
+    }
+    if( isalpha(*fPos) || *fPos == '_' ) {
+      const char* start = fPos;
+      while( isalnum(*fPos) || *fPos == '_' ) fPos++;
+      string name(start, fPos-start);
+      THaVar* var = fVars->Find(name.c_str());
+      if( !var || *fPos == '(' ) return Fail(); // Function or unknown name
+      fNames.push_back(name);
+      if( var->GetType() != kInt && var->GetType() != kDouble )
+	return Fail();
+      Int_t index = 0;
+      if( *fPos == '[' ) {
+	fPos++;
+	Double_t dindex = Expr();
+	if( !fOK || *fPos != ']' ) return Fail();
+	fPos++;
+	index = TMath::Nint(dindex);
+      }
+      if( index < 0 || index >= var->GetLen() ) return Fail();
+      return var->GetValue(index);
+    }
+    return Fail();
+  }
+};
 }
 
 void THcParmList::Load( const char* fname, Int_t RunNumber )
@@ -74,7 +198,9 @@ on a line defining a parameter, then it is saved as the
 title/description for the parameter.
 
 Values may be expressions composed of numbers and previously defined
-parameters.  These expressions are evaluated with THaFormula.
+parameters.  Arithmetic expressions (`+ - * / ^ **`, parentheses,
+parameters and parameter array elements) are evaluated while the file
+is read.  Other expressions are evaluated with THcFormula.
 
 Lines of the form
 ~~~
@@ -94,9 +220,50 @@ A parameter file can load other files with the include statement
 The ENGINE CTP support parameter "blocks" which were marked with
 `begin` and `end` statements.  These statements are ignored.
 
+If RunNumber is given, fname is an ENGINE style database file, in which
+parameters are grouped in blocks headed by a run number or a run range
+`AAAA-BBBB`.  Only the blocks for RunNumber are read.  The blocks are
+found with a THcRunRangeIndex, built once per file, so that loading
+another run seeks straight to its blocks.  GetRunDelta lists the
+parameters that may change between two runs.
+
+If a snapshot directory has been set with SetSnapshotDir, the
+parameters set by the file are saved in a binary snapshot (see
+THcParmSnapshot).  Later loads of the same file for the same run
+apply the snapshot instead of parsing, as long as none of the files
+read has changed and the parameters the file depends on have the same
+values.
+
   */
 
-  static const char* const whtspc = " \t";
+  if(fSnapshotDir.empty()) {
+    ParseFile(fname, RunNumber);
+    return;
+  }
+
+  string snapfile = THcParmSnapshot::FileName(fSnapshotDir.c_str(), fname,
+					      RunNumber);
+  if(THcParmSnapshot::Read(snapfile.c_str(), this)) {
+    cout << "Read parameters for " << fname << " from snapshot "
+	 << snapfile << endl;
+    return;
+  }
+
+  THcParmSnapshot recorder;
+  fRecorder = &recorder;
+  ParseFile(fname, RunNumber);
+  fRecorder = 0;
+  if(recorder.IsComplete() && !recorder.Write(snapfile.c_str(), this)) {
+    Warning("THcParmList::Load", "Cannot write parameter snapshot %s",
+	    snapfile.c_str());
+  }
+}
+//_____________________________________________________________________________
+void THcParmList::ParseFile( const char* fname, Int_t RunNumber )
+{
+  // Read the CTP style parameter file fname.  See Load.
+
+  static const char* const whtspc = " \t\r";
 
   ifstream ifiles[100];		// Should use stack instead
 
@@ -106,6 +273,7 @@ The ENGINE CTP support parameter "blocks" which were marked with
     cout << "Opening parameter file: [" << nfiles << "] " << fname << endl;
     nfiles++;
   }
+  if(fRecorder) fRecorder->AddSource(fname, nfiles > 0);
 
   if(!nfiles) {
     static const char* const here   = "THcParmList::LoadFromFile";
@@ -114,31 +282,63 @@ The ENGINE CTP support parameter "blocks" which were marked with
   }
 
   string line;
-  char varname[100];
+  string stripped;		// Line with unquoted white space removed
+  string token;
+  string current_comment;
+  string varname;
   Int_t InRunRange;
   Int_t currentindex = 0;
 
-  varname[0] = '\0';
+  // Values of the array being assembled.  They are only handed to
+  // THaVarList when the next assignment starts, or when an expression
+  // on a later line may refer to them, so continuation lines of plain
+  // numbers no longer reallocate and re-register the variable.
+  vector<Double_t> pending;
+  string pending_comment;
+  Int_t pending_offset = 0;
+  Bool_t pending_isint = kTRUE;
+
+  // For a database file, read only the blocks for this run.  Files with
+  // includes are read in full.
+  const THcRunRangeIndex* index = 0;
+  vector<Int_t> blocks;
+  UInt_t iblock = 0;
+  Long64_t filepos = 0, blockend = 0;
 
   if(RunNumber > 0) {
     InRunRange = 0;		// Wait until run number range matching RunNumber is found
     cout << "Reading Parameters for run " << RunNumber << endl;
+    index = THcRunRangeIndex::Get(fname);
+    if(index && !index->HasIncludes()) {
+      index->FindBlocks(RunNumber, blocks);
+      InRunRange = 1;
+    } else {
+      index = 0;
+    }
   } else {
     InRunRange = 1;		// Interpret all lines
   }
 
   while(nfiles) {
-    string current_comment("");
-    // EJB_Note:  existing_comment is never used.
-    // string existing_comment("");
-    string::size_type start, pos = 0;
-
+    string::size_type start, pos, end;
+
+    if(index && filepos >= blockend) {
+      if(iblock < blocks.size()) {
+	const THcRunRangeIndex::Block& b = index->GetBlock(blocks[iblock++]);
+	ifiles[0].clear();
+	ifiles[0].seekg(b.begin);
+	filepos = b.begin;
+	blockend = b.end;
+      } else {
+	ifiles[0].setstate(ios::eofbit); // No more blocks for this run
+      }
+    }
     if(!getline(ifiles[nfiles-1],line)) {
       ifiles[nfiles-1].close();
       nfiles--;
-      //      cout << nfiles << ": " << "Closed" << endl;
       continue;
     }
+    filepos += line.length()+1;
     // Look for include statement
     if(line.compare(0,strlen(INCLUDESTR),INCLUDESTR)==0) {
       line.erase(0,strlen(INCLUDESTR));
@@ -154,8 +354,17 @@ The ENGINE CTP support parameter "blocks" which were marked with
       } else {
 	line.erase(line.find_first_of(whtspc));
       }
-      //      cout << line << endl;
+      if(nfiles >= 100) {
+	Error("THcParmList::Load", "parameter files nested too deeply at %s",
+	      line.c_str());
+	continue;
+      }
+      // Values of the current array may be referenced by the included file
+      StoreArray(varname, pending_comment, pending_offset, pending,
+		 pending_isint);
+      pending.clear();
       ifiles[nfiles].open(line.c_str());
+      if(fRecorder) fRecorder->AddSource(line.c_str(), ifiles[nfiles].is_open());
       if(ifiles[nfiles].is_open()) {
 	cout << "Opening parameter file: [" << nfiles << "] " << line << endl;
 	nfiles++;
@@ -169,113 +378,95 @@ The ENGINE CTP support parameter "blocks" which were marked with
 	|| IsComment(line, start) )
       continue;
 
-    // Get rid of trailing comments and leading and trailing whitespace
-    // Need to save the comment and put it in the thVar
-
-    while( (pos = line.find_first_of("#;/", pos+1)) != string::npos ) {
-      if( IsComment(line, pos) ) {
-	current_comment.assign(line,pos+1,line.length());
-	line.erase(pos);	// Strip off comment
-	// Strip leading white space from comment
-	//cout << "CommentA: " << current_comment << endl;
-	pos = current_comment.find_first_not_of(whtspc);
-	if(pos!=string::npos && pos > 0 && pos < current_comment.length()) {
-	  current_comment.erase(0,pos);
-	}
-	//cout << "CommentB: " << current_comment << endl;
-	break;
+    // Split off a trailing comment.  It becomes the title of the parameter.
+    // Comment characters in quoted strings are part of the string.
+    current_comment.clear();
+    end = line.length();
+    pos = THcRunRangeIndex::FindComment(line, start+1);
+    if(pos != string::npos) {
+      string::size_type cstart = line.find_first_not_of(whtspc, pos+1);
+      if(cstart != string::npos) {
+	current_comment.assign(line, cstart, string::npos);
+	string::size_type cend = current_comment.find_last_not_of(whtspc);
+	current_comment.erase(cend+1);
       }
-    }
-    pos = line.find_last_not_of( whtspc );
-    assert( pos != string::npos );
-    if( pos != string::npos && ++pos < line.length() )
-      line.erase(pos);
-    pos = line.find_first_not_of(whtspc);
-    // Strip leading white space
-    if(pos != string::npos && pos > 0 && pos < line.length()) {
-      line.erase(0,pos);
-    }
-    // Ignore begin and end statements
-    if(line.compare(0,5,"begin")==0 ||
-       line.compare(0,3,"end")==0) {
-      cout << "Skipping: " << line << endl;
-      continue;
+      end = pos;
     }
 
-    // Get rid of all white space not in quotes
-    // Step through one char at a time
-    pos = 0;
-    int inquote=0;
-    char quotechar=' ';
-    // cout << "Unstripped line: |" << line << "|" << endl;
-    while(pos<line.length()) {
-      if(inquote) {
-	if(line[pos++] == quotechar) { // Possibly end of quoted string
-	  if(line[pos] == quotechar) { // Protected quote
-	    pos++;		// Skip the protected quote
-	  } else {		// End of quoted string
-	    inquote = 0;
-	    quotechar = ' ';
-	    pos++;
+    // Copy the line dropping all white space not in quotes
+    stripped.clear();
+    {
+      Int_t inquote = 0;
+      char quotechar = ' ';
+      for(pos = start; pos < end; pos++) {
+	char c = line[pos];
+	if(inquote) {
+	  stripped += c;
+	  if(c == quotechar) {	// Possibly end of quoted string
+	    if(pos+1 < end && line[pos+1] == quotechar) { // Protected quote
+	      stripped += line[++pos];
+	    } else {
+	      inquote = 0;
+	    }
 	  }
-	}
-      } else {
-	if(line[pos] == ' ' || line[pos] == '\t') {
-	  line.erase(pos,1);
-	} else if(line[pos] == '"' || line[pos] == '\'') {
-	  quotechar = line[pos++];\
-	  inquote = 1;
-	} else {
-	  pos++;
+	} else if(c != ' ' && c != '\t' && c != '\r') {
+	  if(c == '"' || c == '\'') {
+	    quotechar = c;
+	    inquote = 1;
+	  }
+	  stripped += c;
 	}
       }
     }
-    // cout << "Stripped line: |" << line << "|" << endl;
+    if(stripped.empty()) continue;
 
-    // Need to do something to bug out if line is empty
+    // Ignore begin and end statements
+    if(stripped.compare(0,5,"begin")==0 ||
+       stripped.compare(0,3,"end")==0) {
+      cout << "Skipping: " << line.substr(start, end-start) << endl;
+      continue;
+    }
 
     // If in Engine database mode, check if line is a number range AAAA-BBBB
     if(RunNumber>0) {
-      if(line.find_first_not_of("0123456789-")==string::npos) { // Interpret as runnum range
-	if( (pos=line.find_first_of("-")) != string::npos) {
-	  Int_t RangeStart=atoi(line.substr(0,pos).c_str());
-	  Int_t RangeEnd=atoi(line.substr(pos+1,string::npos).c_str());
-	  if(RunNumber >= RangeStart && RunNumber <= RangeEnd) {
-	    InRunRange = 1;
-	  } else {
-	    InRunRange = 0;
-	  }
-	} else {		// A single number.  Run
-	  if(atoi(line.c_str()) == RunNumber) {
-	    InRunRange = 1;
-	  } else {
-	    InRunRange = 0;
-	  }
-	}
+      Int_t RangeStart, RangeEnd;
+      if(THcRunRangeIndex::ParseRange(stripped, RangeStart, RangeEnd)) {
+	InRunRange = (RunNumber >= RangeStart && RunNumber <= RangeEnd);
 	continue;		// Skip to next line
       }
     }
 
     if(!InRunRange) continue;
 
-    // Interpret left of = as var name
-    Int_t valuestartpos=0;  // Stays zero if no = found
-    Int_t ttype = 0;     // Are any of the values floating point?
-    if((pos=line.find_first_of("="))!=string::npos) {
-      strcpy(varname, (line.substr(0,pos)).c_str());
+    // Interpret left of = as var name.  Lines without = continue the
+    // array of the last assignment.
+    string::size_type valuestartpos=0;
+    if((pos=stripped.find('='))!=string::npos) {
+      StoreArray(varname, pending_comment, pending_offset, pending,
+		 pending_isint);
+      pending.clear();
+      varname.assign(stripped, 0, pos);
       valuestartpos = pos+1;
       currentindex = 0;
     }
+    if(pending.empty()) {
+      pending_offset = currentindex;
+      pending_isint = kTRUE;
+      pending_comment.clear();
+    }
+    if(pending_comment.empty()) {
+      pending_comment = current_comment;
+    }
 
     // If first char after = is a quote, then this is a string assignment
-    if(line[valuestartpos] == '"' || line[valuestartpos] == '\'') {
-      quotechar = line[valuestartpos++];
+    if(valuestartpos < stripped.length() &&
+       (stripped[valuestartpos] == '"' || stripped[valuestartpos] == '\'')) {
+      char quotechar = stripped[valuestartpos++];
       // Scan until end of line or terminating quote
-      //      valuestartpos++;
       pos = valuestartpos;
-      while(pos<line.length()) {
-	if(line[pos++] == quotechar) { // Possibly end of quoted string
-	  if(line[pos] == quotechar) { // Protected quote
+      while(pos<stripped.length()) {
+	if(stripped[pos++] == quotechar) { // Possibly end of quoted string
+	  if(pos<stripped.length() && stripped[pos] == quotechar) { // Protected quote
 	    pos++;
 	  } else {
 	    pos--;
@@ -286,192 +477,317 @@ The ENGINE CTP support parameter "blocks" which were marked with
       if(TextList) {
 	// Should check that a numerical assignment doesn't exist, but for
 	// now, the same variable name can be used for strings and numbers
-	string varnames(varname);
-	AddString(varnames, line.substr(valuestartpos,pos-valuestartpos));
+	AddString(varname, stripped.substr(valuestartpos,pos-valuestartpos));
+	if(fRecorder) fRecorder->AddString(varname.c_str());
       }
       continue;
     }
 
-    TString values((line.substr(valuestartpos)).c_str());
-    TObjArray *vararr = values.Tokenize(",");
-    Int_t nvals = vararr->GetLast()+1;
-
-    Int_t* ip=0;
-    Double_t* fp=0;
-    // or expressions
-    for(Int_t i=0;(ttype==0&&i<nvals);i++) {
-      TString valstr = ((TObjString *)vararr->At(i))->GetString();
-      if(valstr.IsFloat()) {	// Is a number
-	if(valstr.Contains(".") || valstr.Contains("e",TString::kIgnoreCase)) {
-	  ttype = 1;
-	  break;
-	}
-      } else {
-	ttype = 2;		// Force float if expression or Var
-	break;
-      }
-    }
-
-    // New pseudo code
-    // currentindex = where next item goes
-    // nvals = number of new items on line
-    // newlength = curentindex+nvals
-
-    // if (variable already exists)   (valuestartpos is 0 or a find succeeded)
-    //       get existinglegnth
-    //       if (existinglength > newlength && type doesn't change) {
-    //            copy nvals values directly into array
-    //       else
-    //            make new longer array of length max(existinglength, newlength)
-    //            copy existinglength values into longer array changing type if needed
-    //            delete old varname
-    //            recreate varname of proper length
-    // else (variable doesn't exist)
-    //      make array of newlength
-    //      create varname
-    //
-    // There is some code duplication here.  Refactor later
-
-    Int_t newlength = currentindex + nvals;
-    THaVar* existingvar=Find(varname);
-    if(existingvar) {
-      string existingcomment;
-      existingcomment.assign(existingvar->GetTitle());
-      if(!existingcomment.empty()) {
-	current_comment.assign(existingcomment);
-      }
-      Int_t existingtype=existingvar->GetType();
-      Int_t existinglength=existingvar->GetLen();
-      if(newlength > existinglength ||
-	 (existingtype == kInt && ttype > 0)) { // Length or type change needed
-	if(newlength < existinglength) newlength = existinglength;
-	Int_t newtype=-1;
-	if(ttype>0 || existingtype == kDouble) {
-	  newtype = kDouble;
-	  fp = new Double_t[newlength];
-	  if(existingtype == kDouble) {
-	    Double_t* existingp= (Double_t*) existingvar->GetValuePointer();
-	    for(Int_t i=0;i<existinglength;i++) {
-	      fp[i] = existingp[i];
-	    }
-	  } else if(existingtype == kInt) {
-	    Int_t* existingp= (Int_t*) existingvar->GetValuePointer();
-	    for(Int_t i=0;i<existinglength;i++) {
-	      fp[i] = existingp[i];
-	    }
-	  } else {
-	    cout << "Whoops!" << endl;
-	  }
-	} else if(existingtype == kInt) {	// Stays int
-	  newtype = kInt;
-	  ip = new Int_t[newlength];
-	  Int_t* existingp= (Int_t*) existingvar->GetValuePointer();
-	  for(Int_t i=0;i<existinglength;i++) {
-	    ip[i] = existingp[i];
-	  }
+    // Comma separated list of numbers and expressions.  Empty entries
+    // are skipped.
+    UInt_t nearlier = pending.size();	// Values from earlier lines
+    pos = valuestartpos;
+    while(pos < stripped.length()) {
+      string::size_type tokend = stripped.find(',', pos);
+      if(tokend == string::npos) tokend = stripped.length();
+      if(tokend > pos) {
+	token.assign(stripped, pos, tokend-pos);
+	const char* s = token.c_str();
+	char* e;
+	Double_t val;
+	if(IsIntLiteral(s)) {
+	  val = strtol(s, &e, 10);
 	} else {
-	  cout << "Whoops!" << endl;
-	}
-	// Now copy new values in
-	for(Int_t i=0;i<nvals;i++) {
-	  TString valstr = ((TObjString *)vararr->At(i))->GetString();
-	  if(newtype == kInt) {
-	    ip[currentindex+i] = valstr.Atoi();
+	  pending_isint = kFALSE;
+	  if(IsNumberStart(s) && (val = strtod(s, &e), *e == '\0')) {
+	    // Plain floating point number
 	  } else {
-	    if(valstr.IsFloat()) {
-	      fp[currentindex+i] = valstr.Atof();
-	    } else {
-	      THaFormula* formula = new THaFormula
-		("temp",valstr.Data(), (Bool_t) 0, this, 0);
-	      fp[currentindex+i] = formula->Eval();
-	      delete formula;
-	    }
-	  }
-	}
-	currentindex += nvals;
-	// Remove old variable and recreate
-	if(existingtype == kDouble) {
-	  delete [] (Double_t*) existingvar->GetValuePointer();
-	} else if (existingtype == kInt) {
-	  delete [] (Int_t*) existingvar->GetValuePointer();
-	}
-	RemoveName(varname);
-	char *arrayname=new char [strlen(varname)+20];
-	sprintf(arrayname,"%s[%d]",varname,newlength);
-	if(newtype == kInt) {
-	  Define(arrayname, current_comment.c_str(), *ip);
-	} else {
-	  Define(arrayname, current_comment.c_str(), *fp);
-	}
-	delete[] arrayname;
-      } else {
-	// Existing array long enough and of right type, just copy to it.
-	if(ttype == 0 && existingtype == kInt) {
-	  Int_t* existingp= (Int_t*) existingvar->GetValuePointer();
-	  for(Int_t i=0;i<nvals;i++) {
-	    TString valstr = ((TObjString *)vararr->At(i))->GetString();
-	    existingp[currentindex+i] = valstr.Atoi();
-	  }
-	} else {
-	  Double_t* existingp= (Double_t*) existingvar->GetValuePointer();
-	  for(Int_t i=0;i<nvals;i++) {
-	    TString valstr = ((TObjString *)vararr->At(i))->GetString();
-	    if(valstr.IsFloat()) {
-	      existingp[currentindex+i] = valstr.Atof();
-	    } else {
-	      THaFormula* formula = new THaFormula
-		("temp",valstr.Data(), (Bool_t) 0, this, 0);
-	      existingp[currentindex+i] = formula->Eval();
-	      delete formula;
+	    // An expression sees the values of the earlier lines of the
+	    // array, as when every line was stored once it was read
+	    if(nearlier > 0) {
+	      vector<Double_t> earlier(pending.begin(), pending.begin()+nearlier);
+	      StoreArray(varname, pending_comment, pending_offset, earlier,
+			 pending_isint);
+	      pending.erase(pending.begin(), pending.begin()+nearlier);
+	      pending_offset += nearlier;
+	      nearlier = 0;
 	    }
+	    val = Evaluate(s);
 	  }
 	}
-	currentindex += nvals;
+	pending.push_back(val);
+	currentindex++;
       }
+      pos = tokend+1;
+    }
+  }
+  StoreArray(varname, pending_comment, pending_offset, pending,
+	     pending_isint);
+
+  return;
+
+}
+//_____________________________________________________________________________
+Int_t THcParmList::GetRunDelta( const char* fname, Int_t run1, Int_t run2,
+				vector<string>& names ) const
+{
+  // Fill names with the parameters of database file fname that are set
+  // in a run range block that applies to only one of run1 and run2.  These
+  // are the parameters that may differ after Load(fname, run2) compared
+  // to Load(fname, run1).  Returns the number of such parameters, or -1
+  // if the file cannot be read.
+
+  names.clear();
+  const THcRunRangeIndex* index = THcRunRangeIndex::Get(fname);
+  if(!index) return -1;
+  index->GetDelta(run1, run2, names);
+  return names.size();
+}
+//_____________________________________________________________________________
+void THcParmList::StoreArray( const string& name, const string& comment,
+			      Int_t offset, const vector<Double_t>& values,
+			      Bool_t isint )
+{
+  // Store values, read from a parameter file, as elements offset,
+  // offset+1, ... of the array parameter name.  An existing parameter
+  // is extended or promoted to floating point as needed; it keeps its
+  // title if it has one.
+
+  Int_t nvals = values.size();
+  if(name.empty() || nvals == 0) return;
+  if(fRecorder) fRecorder->AddParameter(name.c_str(), this);
+
+  Int_t newlength = offset + nvals;
+  string title(comment);
+  Int_t newtype = isint ? kInt : kDouble;
+  Int_t existinglength = 0;
+  Int_t existingtype = -1;
+  void* existingp = 0;
+
+  THaVar* existingvar=Find(name.c_str());
+  if(existingvar) {
+    if(existingvar->GetTitle() && existingvar->GetTitle()[0]) {
+      title.assign(existingvar->GetTitle());
+    }
+    existingtype = existingvar->GetType();
+    if(existingtype == kInt || existingtype == kDouble) {
+      existinglength = existingvar->GetLen();
+      existingp = (void*) existingvar->GetValuePointer();
     } else {
-      if(currentindex !=0) {
-	cout << "currentindex=" << currentindex << " shouldn't be!" << endl;
-      }
-      if(ttype==0) {
-	ip = new Int_t[nvals];
-      } else {
-	fp = new Double_t[nvals];
-      }
+      cout << "Whoops!" << endl;
+    }
+    if(existingtype == kDouble) newtype = kDouble;
+    if(existingp && newlength <= existinglength && newtype == existingtype) {
+      // Existing array long enough and of right type, just copy to it.
+      Bool_t changed = kFALSE;
       for(Int_t i=0;i<nvals;i++) {
-	TString valstr = ((TObjString *)vararr->At(i))->GetString();
-	if(ttype==0) {
-	  ip[i] = valstr.Atoi();
+	if(newtype == kInt) {
+	  Int_t& ival = ((Int_t*) existingp)[offset+i];
+	  if(ival != (Int_t) values[i]) changed = kTRUE;
+	  ival = (Int_t) values[i];
 	} else {
-	  if(valstr.IsFloat()) {
-	    fp[i] = valstr.Atof();
-	  } else {
-	    THaFormula* formula = new THaFormula
-	      ("temp",valstr.Data(), (Bool_t) 0, this, 0);
-	    fp[i] = formula->Eval();
-	    delete formula;
-	  }
+	  Double_t& dval = ((Double_t*) existingp)[offset+i];
+	  if(dval != values[i]) changed = kTRUE;
+	  dval = values[i];
 	}
       }
-      currentindex = nvals;
+      if(changed) MarkChanged(name);
+      return;
+    }
+    if(newlength < existinglength) newlength = existinglength;
+  } else if(offset != 0) {
+    cout << "currentindex=" << offset << " shouldn't be!" << endl;
+  }
 
-      char *arrayname=new char [strlen(varname)+20];
-      sprintf(arrayname,"%s[%d]",varname,nvals);
-      if(ttype==0) {
-	Define(arrayname, current_comment.c_str(), *ip);
-      } else {
-	Define(arrayname, current_comment.c_str(), *fp);
-      }
-      delete[] arrayname;
+  // Make a new array holding the old and the new values
+  Int_t* ip=0;
+  Double_t* fp=0;
+  if(newtype == kInt) {
+    ip = new Int_t[newlength];
+  } else {
+    fp = new Double_t[newlength];
+  }
+  for(Int_t i=0;i<newlength;i++) {
+    Double_t val = 0;
+    if(i >= offset && i < offset+nvals) {
+      val = values[i-offset];
+    } else if(i < existinglength) {
+      val = (existingtype == kInt) ? ((Int_t*) existingp)[i]
+	: ((Double_t*) existingp)[i];
+    }
+    if(ip) {
+      ip[i] = (Int_t) val;
+    } else {
+      fp[i] = val;
     }
+  }
 
-    delete vararr;		// Discard result of Tokenize
+  ReplaceArray(existingvar, name, title, ip, fp, newlength);
+}
+//_____________________________________________________________________________
+void THcParmList::ReplaceArray( THaVar* existingvar, const string& name,
+				const string& title, Int_t* ip, Double_t* fp,
+				Int_t length )
+{
+  // Define array parameter name with the storage ip (or fp), which the
+  // list takes over.  The existing parameter existingvar, if any, is
+  // removed and its storage deleted.
+
+  fGeneration++;
+  MarkChanged(name);
+  if(existingvar) {
+    if(existingvar->GetType() == kDouble) {
+      delete [] (Double_t*) existingvar->GetValuePointer();
+    } else if (existingvar->GetType() == kInt) {
+      delete [] (Int_t*) existingvar->GetValuePointer();
+    }
+    RemoveName(name.c_str());
+  }
+  char *arrayname=new char [name.length()+20];
+  sprintf(arrayname,"%s[%d]",name.c_str(),length);
+  if(ip) {
+    Define(arrayname, title.c_str(), *ip);
+  } else {
+    Define(arrayname, title.c_str(), *fp);
+  }
+  delete[] arrayname;
+}
+//_____________________________________________________________________________
+void THcParmList::MarkChanged( const string& name )
+{
+  // Record that the value of parameter name has changed
 
-    //    cout << line << endl;
+  fLastChange[name] = ++fChangeSerial;
+}
+//_____________________________________________________________________________
+THaVar* THcParmList::DefineByType( const char* name, const char* desc,
+				   const void* loc, VarType type,
+				   const Int_t* count, const char* errloc )
+{
+  // Define a parameter.  Handles that did not find it look it up again.
 
-  }
+  fGeneration++;
+  return THaVarList::DefineByType(name, desc, loc, type, count, errloc);
+}
 
-  return;
+//_____________________________________________________________________________
+Int_t THcParmList::RemoveName( const char* name )
+{
+  // Remove a parameter.  Handles bound to it no longer use its storage.
+
+  fGeneration++;
+  return THaVarList::RemoveName(name);
+}
+
+//_____________________________________________________________________________
+Int_t THcParmList::RemoveRegexp( const char* expr )
+{
+  fGeneration++;
+  return THaVarList::RemoveRegexp(expr);
+}
+
+//_____________________________________________________________________________
+void THcParmList::Clear( Option_t* opt )
+{
+  fGeneration++;
+  THaVarList::Clear(opt);
+}
+
+//_____________________________________________________________________________
+void THcParmList::AddAccumulator( const char* name )
+{
+  // Declare parameter name (an integer counter or array of counters) as
+  // accumulated over the events of a run
+
+  if( find(fAccumulators.begin(), fAccumulators.end(), name) ==
+      fAccumulators.end() )
+    fAccumulators.push_back(name);
+  if(fUsage) fUsage->AddAccumulator(name);
+}
+
+//_____________________________________________________________________________
+void THcParmList::DefineAccumulator( const char* name, const char* desc,
+				     Int_t* var, Int_t n )
+{
+  // Define var[0..n-1] as parameter name, replacing an earlier definition
+  // (e.g. from the Init of a previous run), and declare it an accumulator
+
+  RemoveName(name);
+  if( n > 1 )
+    Define(Form("%s[%d]",name,n), desc, *var);
+  else
+    Define(name, desc, *var);
+  AddAccumulator(name);
+}
 
+//_____________________________________________________________________________
+void THcParmList::AddCheckpointVariable( const char* name )
+{
+  // Declare parameter name as run state that checkpoints save and
+  // restore, without it being summed like an accumulator
+
+  if( find(fCheckpointVars.begin(), fCheckpointVars.end(), name) ==
+      fCheckpointVars.end() )
+    fCheckpointVars.push_back(name);
+}
+
+//_____________________________________________________________________________
+UInt_t THcParmList::GetLastChange( const char* name ) const
+{
+  // Serial number of the last change of parameter name.  Zero if it has
+  // never been set.
+
+  map<string,UInt_t>::const_iterator it = fLastChange.find(name);
+  return (it == fLastChange.end()) ? 0 : it->second;
+}
+//_____________________________________________________________________________
+Int_t THcParmList::GetChangedSince( UInt_t serial, vector<string>& names ) const
+{
+  // Fill names with the parameters changed after change serial (see
+  // GetChangeSerial) and return their number.  Useful in multi-run jobs
+  // to see what differs for the next run.
+
+  names.clear();
+  for(map<string,UInt_t>::const_iterator it = fLastChange.begin();
+      it != fLastChange.end(); ++it) {
+    if(it->second > serial) names.push_back(it->first);
+  }
+  return names.size();
+}
+//_____________________________________________________________________________
+Double_t THcParmList::Evaluate( const char* expr )
+{
+  // Evaluate a parameter value expression.  Arithmetic on numbers and
+  // previously defined parameters is done directly; anything else
+  // (functions, constants, ...) is handed to a cached THcFormula.
+
+  Double_t val;
+  CTPExprParser parser(this, expr);
+  Bool_t ok = parser.Parse(val);
+  if(fRecorder) {
+    // The value depends on the parameters used in the expression
+    const vector<string>& names = parser.GetNames();
+    for(UInt_t i=0;i<names.size();i++) {
+      fRecorder->AddDependency(names[i].c_str(), this);
+    }
+  }
+  if(ok) return val;
+
+  THcFormula* formula = THcFormula::Get(expr, this, this, 0);
+  if(fRecorder) {
+    // If not all parameters the formula depends on are known, the load
+    // is not snapshotted.
+    if(formula->IsCacheable()) {
+      vector<string> names;
+      formula->GetNames(names);
+      for(UInt_t i=0;i<names.size();i++) {
+	fRecorder->AddDependency(names[i].c_str(), this);
+      }
+    } else {
+      fRecorder->SetIncomplete();
+    }
+  }
+  return formula->Eval();
 }
 //_____________________________________________________________________________
 Int_t THcParmList::LoadParmValues(const DBRequest* list, const char* prefix)
@@ -514,16 +830,18 @@ zero), then there will be no error if the parameter is missing.
     const char* key = keystr.c_str();
     //    cout <<"Now at "<<ti->name<<endl;
     this_cnt = 0;
-    if(this->Find(key)) {
-      VarType ty = this->Find(key)->GetType();
+    if(fUsage) fUsage->Add(keystr);
+    const THaVar* var = Find(key);
+    if(var) {
+      VarType ty = var->GetType();
       if (ti->nelem>1) {
 	// it is an array, use the appropriateinterface
 	switch (ti->type) {
 	case (kDouble) :
-	  this_cnt = GetArray(key,static_cast<Double_t*>(ti->var),ti->nelem);
+	  this_cnt = ReadArray(var,key,static_cast<Double_t*>(ti->var),ti->nelem);
 	  break;
 	case (kInt) :
-	  this_cnt = GetArray(key,static_cast<Int_t*>(ti->var),ti->nelem);
+	  this_cnt = ReadArray(var,key,static_cast<Int_t*>(ti->var),ti->nelem);
 	  break;
 	default:
 	  Error("THcParmList","Invalid type to read %s",key);
@@ -531,12 +849,13 @@ zero), then there will be no error if the parameter is missing.
 	}
 
       } else {
+	const void* vp = var->GetValuePointer();
 	switch (ti->type) {
 	case (kDouble) :
 	  if(ty == kInt) {
-	    *static_cast<Double_t*>(ti->var)=*(Int_t *)this->Find(key)->GetValuePointer();
+	    *static_cast<Double_t*>(ti->var)=*(const Int_t *)vp;
 	  } else if (ty == kDouble) {
-	    *static_cast<Double_t*>(ti->var)=*(Double_t *)this->Find(key)->GetValuePointer();
+	    *static_cast<Double_t*>(ti->var)=*(const Double_t *)vp;
 	  } else {
 	    cout << "*** ERROR!!! Type Mismatch " << key << endl;
 	  }
@@ -545,9 +864,9 @@ zero), then there will be no error if the parameter is missing.
 	  break;
 	case (kInt) :
 	  if(ty == kInt) {
-	    *static_cast<Int_t*>(ti->var)=*(Int_t *)this->Find(key)->GetValuePointer();
+	    *static_cast<Int_t*>(ti->var)=*(const Int_t *)vp;
 	  } else if (ty == kDouble) {
-	    *static_cast<Int_t*>(ti->var)=TMath::Nint(*(Double_t *)this->Find(key)->GetValuePointer());
+	    *static_cast<Int_t*>(ti->var)=TMath::Nint(*(const Double_t *)vp);
 	    cout << "*** WARNING!!!  Rounded " << key << " to nearest integer " << endl;
 	  } else {
 	    cout << "*** ERROR!!! Type Mismatch " << key << endl;
@@ -590,26 +909,28 @@ Int_t THcParmList::GetArray(const char* attr, Int_t* array, Int_t size)
 {
   // Read in a set of Int_t's in to a C-style array.
 
-  return ReadArray(attr,array,size);
+  if(fUsage) fUsage->Add(attr);
+  return ReadArray(Find(attr),attr,array,size);
 }
 //_____________________________________________________________________________
 Int_t THcParmList::GetArray(const char* attr, Double_t* array, Int_t size)
 {
   // Read in a set of Double_t's in to a vector.
 
-  return ReadArray(attr,array,size);
+  if(fUsage) fUsage->Add(attr);
+  return ReadArray(Find(attr),attr,array,size);
 }
 
 //_____________________________________________________________________________
 template<class T>
-Int_t THcParmList::ReadArray(const char* attrC, T* array, Int_t size)
+Int_t THcParmList::ReadArray(const THaVar* var, const char* attrC, T* array,
+			     Int_t size)
 {
-  // Copy values from parameter store to array
+  // Copy values of parameter var (named attrC) from parameter store to array
   // No resizing is done, so only 'size' elements may be stored.
 
   Int_t cnt=0;
 
-  THaVar *var = Find(attrC);
   if(!var) return(cnt);
   VarType ty = var->GetType();
   if( ty != kInt && ty != kDouble) {
@@ -687,6 +1008,7 @@ Int_t THcParmList::LoadCCDBDirectory(const char* directory,
     dirname.append("/");
   }
   Int_t dirlen=dirname.length();
+  fGeneration++;
 
   vector<string> namepaths;
   CCDB_obj->GetListOfNamepaths(namepaths);
@@ -730,6 +1052,7 @@ Int_t THcParmList::LoadCCDBDirectory(const char* directory,
 	    ip[row] = data[row][0];
 	  }
 	  Define(varnamearray.c_str(), title.c_str(), *ip);
+	  MarkChanged(varname);
 
 	} else if (ccdbtype==ConstantsTypeColumn::cDoubleColumn) {
 	  vector<vector<double> > data;
@@ -744,6 +1067,7 @@ Int_t THcParmList::LoadCCDBDirectory(const char* directory,
 	    fp[row] = data[row][0];
 	  }
 	  Define(varnamearray.c_str(), title.c_str(), *fp);
+	  MarkChanged(varname);
 	} else if (ccdbtype==ConstantsTypeColumn::cStringColumn) {
 	  if(ccdbnrows > 1) {
 	    cout << namepaths[iname] << ": Only first element of CCDB string array loaded."  << endl;
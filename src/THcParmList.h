@@ -9,6 +9,9 @@
 
 #include "THaVarList.h"
 #include "THaTextvars.h"
+#include <map>
+#include <string>
+#include <vector>
 
 #ifdef WITH_CCDB
 #ifdef __CINT__
@@ -22,7 +25,9 @@ using namespace ccdb;
 
 using namespace std;
 
-
+class THaVar;
+class THcParmSnapshot;
+class THcParmUsage;
 
 class THcParmList : public THaVarList {
 
@@ -33,6 +38,52 @@ public:
 
   virtual void Load( const char *fname, Int_t RunNumber=0);
 
+  // Parameters of database file fname that may change from run1 to run2
+  Int_t GetRunDelta(const char* fname, Int_t run1, Int_t run2,
+		    std::vector<std::string>& names) const;
+
+  // Change tracking.  Every change of a parameter's value by Load,
+  // AddString or CCDB loading gets a new serial number.
+  UInt_t GetChangeSerial() const { return fChangeSerial; }
+  UInt_t GetLastChange(const char* name) const;
+  Int_t  GetChangedSince(UInt_t serial, std::vector<std::string>& names) const;
+
+  // Record of the parameters read by the Init in progress
+  THcParmUsage* GetUsage() const { return fUsage; }
+  void SetUsage(THcParmUsage* usage) { fUsage = usage; }
+
+  // Incremented whenever parameters may have been added, removed or
+  // moved, e.g. by Load.  Used by THcParmHandle.
+  UInt_t GetGeneration() const { return fGeneration; }
+
+  // Every definition and removal of a parameter goes through these, so
+  // that they change the generation
+  virtual THaVar* DefineByType(const char* name, const char* desc,
+			       const void* loc, VarType type,
+			       const Int_t* count,
+			       const char* errloc="DefineByType");
+  virtual Int_t RemoveName(const char* name);
+  virtual Int_t RemoveRegexp(const char* expr);
+  virtual void  Clear(Option_t* opt="");
+
+  // Counters accumulated over the events of a run (e.g. efficiency
+  // counts), which are summed when partial replays are merged
+  void AddAccumulator(const char* name);
+  const std::vector<std::string>& GetAccumulators() const { return fAccumulators; }
+  // Define the n counters var as parameter name and declare them an
+  // accumulator
+  void DefineAccumulator(const char* name, const char* desc, Int_t* var,
+			 Int_t n);
+  // Other run state (e.g. scaler baselines), saved by checkpoints but
+  // not summed
+  void AddCheckpointVariable(const char* name);
+  const std::vector<std::string>& GetCheckpointVariables() const
+  { return fCheckpointVars; }
+
+  // Directory for parameter snapshots.  Empty disables snapshots.
+  void SetSnapshotDir(const char* dir) { fSnapshotDir = dir ? dir : ""; }
+  const char* GetSnapshotDir() const { return fSnapshotDir.c_str(); }
+
   virtual void PrintFull(Option_t *opt="") const;
 
   const char* GetString(const std::string& name) const {
@@ -40,9 +91,12 @@ public:
   }
 
   Int_t AddString(const std::string& name, const std::string& value) {
+    const char* old = GetString(name);
+    if(!old || value != old) MarkChanged(name);
     return(TextList->Add(name, value));
   }
   void RemoveString(const std::string& name) {
+    MarkChanged(name);
     TextList->Remove(name);
   }
 
@@ -63,12 +117,34 @@ private:
 
   THaTextvars* TextList;  //! Dictionary of string parameters
 
+  std::string fSnapshotDir;   //! Directory of parameter snapshots
+  THcParmSnapshot* fRecorder; //! Snapshot being recorded during Load
+  UInt_t fGeneration;         //! Changes when parameters are redefined
+  UInt_t fChangeSerial;       //! Serial number of the last change
+  std::map<std::string,UInt_t> fLastChange; //! Serial of last change by name
+  THcParmUsage* fUsage;       //! Records parameters read, if set
+  std::vector<std::string> fAccumulators; //! Run accumulators
+  std::vector<std::string> fCheckpointVars; //! Other run state
+
 #ifdef WITH_CCDB
   SQLiteCalibration* CCDB_obj;
 #endif
 
   template<class T>
-    Int_t ReadArray(const char* attrC, T* array, Int_t size);
+    Int_t ReadArray(const THaVar* var, const char* attrC, T* array,
+		    Int_t size);
+
+  void StoreArray(const std::string& name, const std::string& comment,
+		  Int_t offset, const std::vector<Double_t>& values,
+		  Bool_t isint);
+  Double_t Evaluate(const char* expr);
+  void MarkChanged(const std::string& name);
+  void ParseFile(const char* fname, Int_t RunNumber);
+  void ReplaceArray(THaVar* existingvar, const std::string& name,
+		    const std::string& title, Int_t* ip, Double_t* fp,
+		    Int_t length);
+
+  friend class THcParmSnapshot;
 
 protected:
 
@@ -0,0 +1,358 @@
+/** \class THcParmSnapshot
+    \ingroup Base
+
+ Binary snapshot of the parameters set by one THcParmList::Load call.
+
+ When a snapshot directory is set with THcParmList::SetSnapshotDir, each
+ Load(fname, RunNumber) first looks for the snapshot file of fname and
+ the run number.  The file is mapped into memory and applied directly if
+
+ - every source file (the parameter file and all files it includes) still
+   has the MD5 checksum recorded in the snapshot, and includes that could
+   not be opened still cannot be, and
+ - every parameter that the parsed values depended on (parameters used in
+   expressions, and parameters that were extended or overwritten) has the
+   same type and values as when the snapshot was made.
+
+ Otherwise the files are parsed as usual and the snapshot is rewritten.
+ It is written under a temporary name and renamed when complete, so that
+ a concurrent replay never reads a partial snapshot.
+ A Load with an expression whose dependencies are not known (see
+ THcFormula::IsCacheable) is not snapshotted.
+
+ Snapshots are written in native byte order:
+ ~~~
+   "HCPS" version
+   nsources   { name md5 }
+   ndeps      { name type len values[len] (Double_t) }
+   nparms     { name title type len values[len] (Int_t or Double_t) }
+   nstrings   { name value }
+ ~~~
+ Strings are stored as an Int_t length followed by the characters.
+
+*/
+
+#include "THcParmSnapshot.h"
+#include "THcParmList.h"
+#include "THaVar.h"
+
+#include "TError.h"
+#include "TMD5.h"
+#include "TString.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+  // Identifies snapshot files and their layout
+  const char   kSnapMagic[4] = { 'H', 'C', 'P', 'S' };
+  const Int_t  kSnapVersion  = 1;
+
+  string FileChecksum( const char* fname )
+  {
+    TMD5* md5 = TMD5::FileChecksum(fname);
+    if( !md5 ) return string();
+    string sum = md5->AsString();
+    delete md5;
+    return sum;
+  }
+
+  // Sequential reader of a mapped snapshot.  Any read past the end
+  // clears fOK and makes all later reads fail.
+  class SnapReader {
+  public:
+    SnapReader( const char* buf, size_t len )
+      : fPos(buf), fEnd(buf+len), fOK(true) {}
+    bool OK() const { return fOK; }
+    const char* Data( size_t n ) {
+      if( !fOK || (size_t)(fEnd-fPos) < n ) {
+	fOK = false;
+	return 0;
+      }
+      const char* p = fPos;
+      fPos += n;
+      return p;
+    }
+    Int_t Int() {
+      Int_t i = 0;
+      const char* p = Data(sizeof(i));
+      if( p ) memcpy(&i, p, sizeof(i));
+      return i;
+    }
+    bool String( string& s ) {
+      Int_t n = Int();
+      if( n < 0 ) fOK = false;
+      const char* p = Data(fOK ? n : 0);
+      if( p ) s.assign(p, n);
+      return fOK;
+    }
+  private:
+    const char* fPos;
+    const char* fEnd;
+    bool        fOK;
+  };
+
+  bool PutData( FILE* fp, const void* p, size_t n )
+  {
+    return n == 0 || fwrite(p, n, 1, fp) == 1;
+  }
+  bool PutInt( FILE* fp, Int_t i )
+  {
+    return PutData(fp, &i, sizeof(i));
+  }
+  bool PutString( FILE* fp, const string& s )
+  {
+    return PutInt(fp, s.length()) && PutData(fp, s.data(), s.length());
+  }
+}
+
+//_____________________________________________________________________________
+THcParmSnapshot::THcParmSnapshot() : fComplete(kTRUE)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+void THcParmSnapshot::AddSource( const char* fname, Bool_t opened )
+{
+  // Record a parameter file that was read, or that could not be opened
+
+  fSources.push_back(make_pair(string(fname),
+			       opened ? FileChecksum(fname) : string()));
+}
+
+//_____________________________________________________________________________
+void THcParmSnapshot::AddDependency( const char* name,
+				     const THcParmList* list )
+{
+  // Record the current state of parameter name, unless it was recorded
+  // before or has already been set by the file being parsed.
+
+  if( !fSeen.insert(name).second ) return;
+
+  Dependency dep;
+  dep.name = name;
+  dep.type = -1;
+  const THaVar* var = list->Find(name);
+  if( var ) {
+    dep.type = var->GetType();
+    if( dep.type == kInt || dep.type == kDouble ) {
+      Int_t len = var->GetLen();
+      dep.values.resize(len);
+      for(Int_t i=0;i<len;i++) {
+	dep.values[i] = var->GetValue(i);
+      }
+    }
+  }
+  fDeps.push_back(dep);
+}
+
+//_____________________________________________________________________________
+void THcParmSnapshot::AddParameter( const char* name,
+				    const THcParmList* list )
+{
+  // Record that numeric parameter name is set by the file being parsed
+
+  AddDependency(name, list);
+  if( fParameterSet.insert(name).second )
+    fParameters.push_back(name);
+}
+
+//_____________________________________________________________________________
+void THcParmSnapshot::AddString( const char* name )
+{
+  // Record that string parameter name is set by the file being parsed
+
+  if( fStringSet.insert(name).second )
+    fStrings.push_back(name);
+}
+
+//_____________________________________________________________________________
+Bool_t THcParmSnapshot::Write( const char* file,
+			       const THcParmList* list ) const
+{
+  // Write the snapshot, with the final values of the recorded parameters
+  // taken from list.
+
+  if( !fComplete ) return kFALSE;
+  TString tmpfile = Form("%s.tmp%d", file, (Int_t)getpid());
+  FILE* fp = fopen(tmpfile, "wb");
+  if( !fp ) return kFALSE;
+
+  bool ok = PutData(fp, kSnapMagic, sizeof(kSnapMagic)) &&
+    PutInt(fp, kSnapVersion) && PutInt(fp, fSources.size());
+  for(UInt_t i=0;ok && i<fSources.size();i++) {
+    ok = PutString(fp, fSources[i].first) && PutString(fp, fSources[i].second);
+  }
+  ok = ok && PutInt(fp, fDeps.size());
+  for(UInt_t i=0;ok && i<fDeps.size();i++) {
+    const Dependency& dep = fDeps[i];
+    ok = PutString(fp, dep.name) && PutInt(fp, dep.type) &&
+      PutInt(fp, dep.values.size()) &&
+      (dep.values.empty() ||
+       PutData(fp, &dep.values[0], dep.values.size()*sizeof(Double_t)));
+  }
+
+  // Parameters that vanished or are not numeric are left out
+  vector<const THaVar*> vars;
+  for(UInt_t i=0;ok && i<fParameters.size();i++) {
+    const THaVar* var = list->Find(fParameters[i].c_str());
+    if( var && (var->GetType() == kInt || var->GetType() == kDouble) )
+      vars.push_back(var);
+  }
+  ok = ok && PutInt(fp, vars.size());
+  for(UInt_t i=0;ok && i<vars.size();i++) {
+    const THaVar* var = vars[i];
+    Int_t type = var->GetType();
+    Int_t len = var->GetLen();
+    size_t size = (type == kInt) ? sizeof(Int_t) : sizeof(Double_t);
+    ok = PutString(fp, var->GetName()) && PutString(fp, var->GetTitle()) &&
+      PutInt(fp, type) && PutInt(fp, len) &&
+      PutData(fp, var->GetValuePointer(), len*size);
+  }
+
+  ok = ok && PutInt(fp, fStrings.size());
+  for(UInt_t i=0;ok && i<fStrings.size();i++) {
+    const char* value = list->GetString(fStrings[i]);
+    ok = PutString(fp, fStrings[i]) && PutString(fp, value ? value : "");
+  }
+
+  if( fclose(fp) != 0 ) ok = false;
+  if( ok && rename(tmpfile, file) != 0 ) ok = false;
+  if( !ok ) remove(tmpfile);
+  return ok;
+}
+
+//_____________________________________________________________________________
+Bool_t THcParmSnapshot::Read( const char* file, THcParmList* list )
+{
+  // Map snapshot file into memory and, if it is still valid, set the
+  // parameters it holds in list.  Returns kFALSE, without touching list,
+  // if the snapshot is missing, damaged or out of date.
+
+  int fd = open(file, O_RDONLY);
+  if( fd < 0 ) return kFALSE;
+  struct stat st;
+  if( fstat(fd, &st) != 0 || st.st_size <= 0 ) {
+    close(fd);
+    return kFALSE;
+  }
+  size_t size = st.st_size;
+  void* map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if( map == MAP_FAILED ) return kFALSE;
+
+  SnapReader in(static_cast<const char*>(map), size);
+  string name, sum;
+
+  // Check the sources and the prior state
+  const char* magic = in.Data(sizeof(kSnapMagic));
+  bool ok = magic && memcmp(magic, kSnapMagic, sizeof(kSnapMagic)) == 0 &&
+    in.Int() == kSnapVersion;
+  Int_t nsources = ok ? in.Int() : 0;
+  for(Int_t i=0;ok && i<nsources;i++) {
+    ok = in.String(name) && in.String(sum) && FileChecksum(name.c_str()) == sum;
+  }
+  Int_t ndeps = ok ? in.Int() : 0;
+  for(Int_t i=0;ok && i<ndeps;i++) {
+    in.String(name);
+    Int_t type = in.Int();
+    Int_t len = in.Int();
+    const char* values = in.Data(len > 0 ? len*sizeof(Double_t) : 0);
+    ok = in.OK() && len >= 0;
+    if( !ok ) break;
+    const THaVar* var = list->Find(name.c_str());
+    if( !var ) {
+      ok = (type == -1);
+    } else if( type != var->GetType() ) {
+      ok = false;
+    } else if( type == kInt || type == kDouble ) {
+      ok = (len == var->GetLen());
+      for(Int_t j=0;ok && j<len;j++) {
+	Double_t value;
+	memcpy(&value, values+j*sizeof(Double_t), sizeof(value));
+	ok = (value == var->GetValue(j));
+      }
+    }
+  }
+
+  // Check that the rest is intact before changing anything
+  const char* parms = in.Data(0);
+  Int_t nparms = ok ? in.Int() : 0;
+  for(Int_t i=0;ok && i<nparms;i++) {
+    in.String(name);
+    in.String(name);
+    Int_t type = in.Int();
+    Int_t len = in.Int();
+    ok = in.OK() && len > 0 && (type == kInt || type == kDouble);
+    if( ok )
+      in.Data(len*(type == kInt ? sizeof(Int_t) : sizeof(Double_t)));
+  }
+  Int_t nstrings = ok ? in.Int() : 0;
+  for(Int_t i=0;ok && i<nstrings;i++) {
+    in.String(name);
+    in.String(sum);
+  }
+  ok = ok && in.OK();
+
+  if( ok ) {
+    SnapReader apply(parms, size - (parms - static_cast<const char*>(map)));
+    string title, value;
+    apply.Int();
+    for(Int_t i=0;i<nparms;i++) {
+      apply.String(name);
+      apply.String(title);
+      Int_t type = apply.Int();
+      Int_t len = apply.Int();
+      size_t nbytes = len*(type == kInt ? sizeof(Int_t) : sizeof(Double_t));
+      const char* values = apply.Data(nbytes);
+      THaVar* var = list->Find(name.c_str());
+      if( var && var->GetType() == type && var->GetLen() == len ) {
+	void* dest = const_cast<void*>(var->GetValuePointer());
+	if( memcmp(dest, values, nbytes) != 0 ) {
+	  memcpy(dest, values, nbytes);
+	  list->MarkChanged(name);
+	}
+      } else if( type == kInt ) {
+	Int_t* ip = new Int_t[len];
+	memcpy(ip, values, nbytes);
+	list->ReplaceArray(var, name, title, ip, 0, len);
+      } else {
+	Double_t* fp = new Double_t[len];
+	memcpy(fp, values, nbytes);
+	list->ReplaceArray(var, name, title, 0, fp, len);
+      }
+    }
+    apply.Int();
+    for(Int_t i=0;i<nstrings;i++) {
+      apply.String(name);
+      apply.String(value);
+      list->AddString(name, value);
+    }
+  }
+
+  munmap(map, size);
+  return ok;
+}
+
+//_____________________________________________________________________________
+string THcParmSnapshot::FileName( const char* dir, const char* fname,
+				  Int_t RunNumber )
+{
+  // Snapshot file name for parameter file fname read for run RunNumber
+
+  string file(dir);
+  if( !file.empty() && file[file.length()-1] != '/' ) file += '/';
+  for( const char* c = fname; *c; c++ )
+    file += (*c == '/') ? '_' : *c;
+  file += Form(".%d.parsnap", RunNumber);
+  return file;
+}
@@ -0,0 +1,67 @@
+#ifndef ROOT_THcParmSnapshot
+#define ROOT_THcParmSnapshot
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcParmSnapshot
+//
+// Binary snapshot of the parameters set by one THcParmList::Load call.
+//
+// While a parameter file is parsed, the snapshot records the files read,
+// the prior state of every parameter the result depends on, and the names
+// of the parameters and strings that were set.  Write() then saves the
+// resulting values.  Read() maps a snapshot file into memory and applies
+// it, provided no source file has changed and the recorded prior state
+// still holds.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+#include <set>
+#include <utility>
+
+class THcParmList;
+
+class THcParmSnapshot {
+
+public:
+  THcParmSnapshot();
+
+  // Recording while parsing
+  void   AddSource( const char* fname, Bool_t opened );
+  void   AddDependency( const char* name, const THcParmList* list );
+  void   AddParameter( const char* name, const THcParmList* list );
+  void   AddString( const char* name );
+  void   SetIncomplete() { fComplete = kFALSE; }
+  Bool_t IsComplete() const { return fComplete; }
+
+  Bool_t Write( const char* file, const THcParmList* list ) const;
+
+  // Apply the snapshot in file to list if it is still valid
+  static Bool_t Read( const char* file, THcParmList* list );
+
+  // Snapshot file in directory dir for parameter file fname and run
+  static std::string FileName( const char* dir, const char* fname,
+			       Int_t RunNumber );
+
+private:
+  // Prior state of a parameter.  type is -1 if it did not exist.
+  struct Dependency {
+    std::string name;
+    Int_t type;
+    std::vector<Double_t> values;
+  };
+
+  Bool_t fComplete;   // False if the result depends on unknown state
+  std::vector<std::pair<std::string,std::string> > fSources; // file, MD5
+  std::vector<Dependency>  fDeps;
+  std::set<std::string>    fSeen;        // Names with prior state recorded
+  std::vector<std::string> fParameters;  // Numeric parameters set
+  std::set<std::string>    fParameterSet;
+  std::vector<std::string> fStrings;     // String parameters set
+  std::set<std::string>    fStringSet;
+};
+
+#endif
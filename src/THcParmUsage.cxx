@@ -0,0 +1,140 @@
+/** \class THcParmUsage
+    \ingroup Base
+
+ Record of the parameters read by a detector's Init.
+
+ When several runs are analyzed in one process, every module is
+ initialized again for each run.  Detectors whose parameters are the same
+ for the new run can skip this.  A detector keeps a THcParmUsage and
+ brackets its Init with Start and Stop.  In between, THcParmList records
+ every parameter requested through LoadParmValues or GetArray.  This
+ includes parameters read by the subdetectors initialized from within
+ the detector's Init.  At the next Init, IsUpToDate tells whether any of
+ these parameters, or the detector map, has changed since:
+ ~~~
+   if( fParmUsage.IsUpToDate() ) {
+     fParmUsage.Reuse();
+     return fStatus = kOK;
+   }
+   fParmUsage.Start();
+   ...
+   fParmUsage.Stop(kTRUE);
+ ~~~
+ Run accumulators (THcParmList::AddAccumulator, e.g. efficiency
+ counters and pedestal sums) registered during the Init are recorded as
+ well.  Reuse sets them to zero, since a skipped Init must still start
+ the counts of the new run from zero.
+
+ The record is only valid after a successful Init.  If Init returns an
+ error, Stop(kFALSE), or no Stop at all, forces a full Init next time.
+
+*/
+
+#include "THcParmUsage.h"
+#include "THcParmList.h"
+#include "THaVar.h"
+#include "THcDetectorMap.h"
+#include "THcGlobals.h"
+
+#include <algorithm>
+
+using namespace std;
+
+//_____________________________________________________________________________
+THcParmUsage::THcParmUsage() : fParent(0), fSerial(0), fMapGeneration(0),
+  fValid(kFALSE), fActive(kFALSE)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+THcParmUsage::~THcParmUsage()
+{
+  // Destructor. Stop recording if an Init was interrupted.
+
+  if( fActive ) Stop(kFALSE);
+}
+
+//_____________________________________________________________________________
+Bool_t THcParmUsage::IsUpToDate() const
+{
+  // Check whether the parameters read by the last Init are unchanged
+
+  if( !fValid || fActive || !gHcParms ) return kFALSE;
+  if( gHcDetectorMap && gHcDetectorMap->GetGeneration() != fMapGeneration )
+    return kFALSE;
+  for( UInt_t i = 0; i < fNames.size(); i++ ) {
+    if( gHcParms->GetLastChange(fNames[i].c_str()) > fSerial )
+      return kFALSE;
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcParmUsage::Start()
+{
+  // Start recording the parameters read from gHcParms
+
+  if( fActive ) Stop(kFALSE);
+  fNames.clear();
+  fAccumulators.clear();
+  fValid = kFALSE;
+  if( !gHcParms ) return;
+  fParent = gHcParms->GetUsage();
+  fSerial = gHcParms->GetChangeSerial();
+  fMapGeneration = gHcDetectorMap ? gHcDetectorMap->GetGeneration() : 0;
+  fActive = kTRUE;
+  gHcParms->SetUsage(this);
+}
+
+//_____________________________________________________________________________
+void THcParmUsage::Stop( Bool_t ok )
+{
+  // Stop recording.  The record is valid if ok is set, i.e. Init succeeded.
+
+  if( !fActive ) return;
+  fActive = kFALSE;
+  sort(fNames.begin(), fNames.end());
+  fNames.erase(unique(fNames.begin(), fNames.end()), fNames.end());
+  fValid = ok;
+  if( gHcParms && gHcParms->GetUsage() == this )
+    gHcParms->SetUsage(fParent);
+  PassOn();
+  fParent = 0;
+}
+
+//_____________________________________________________________________________
+void THcParmUsage::Reuse()
+{
+  // The Init is skipped.  Reset the accumulators it registered and pass
+  // the record on.
+
+  for( UInt_t i = 0; gHcParms && i < fAccumulators.size(); i++ ) {
+    THaVar* var = gHcParms->Find(fAccumulators[i].c_str());
+    if( !var ) continue;
+    void* value = const_cast<void*>(var->GetValuePointer());
+    for( Int_t k = 0; k < var->GetLen(); k++ ) {
+      if( var->GetType() == kInt )
+	static_cast<Int_t*>(value)[k] = 0;
+      else if( var->GetType() == kDouble )
+	static_cast<Double_t*>(value)[k] = 0;
+    }
+  }
+  PassOn();
+}
+
+//_____________________________________________________________________________
+void THcParmUsage::PassOn()
+{
+  // Add the parameters and accumulators of this record to the one being
+  // made by an enclosing Init, if any
+
+  THcParmUsage* outer = gHcParms ? gHcParms->GetUsage() : 0;
+  if( !outer || outer == this ) return;
+  for( UInt_t i = 0; i < fNames.size(); i++ ) {
+    outer->Add(fNames[i]);
+  }
+  for( UInt_t i = 0; i < fAccumulators.size(); i++ ) {
+    outer->AddAccumulator(fAccumulators[i]);
+  }
+}
@@ -0,0 +1,62 @@
+#ifndef ROOT_THcParmUsage
+#define ROOT_THcParmUsage
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcParmUsage
+//
+// Record of the parameters a detector read during its last Init, used to
+// skip re-initialization between runs when none of them has changed.
+// The run accumulators registered by the Init are reset when it is
+// skipped.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+
+class THcParmList;
+
+class THcParmUsage {
+
+public:
+  THcParmUsage();
+  ~THcParmUsage();
+
+  // True if the last Init succeeded and neither the parameters it read
+  // nor the detector map have changed since
+  Bool_t IsUpToDate() const;
+
+  // Bracket an Init.  Parameters read from gHcParms in between are
+  // recorded.  Usages may be nested; the parameters read by an inner
+  // Init are also recorded by the outer one.
+  void   Start();
+  void   Stop( Bool_t ok );
+
+  // Init skipped because IsUpToDate: reset the accumulators it
+  // registered, and pass the record on to an enclosing Init that is
+  // being recorded
+  void   Reuse();
+
+  void   Add( const std::string& name ) { fNames.push_back(name); }
+  void   AddAccumulator( const std::string& name )
+  { fAccumulators.push_back(name); }
+  void   Invalidate() { fValid = kFALSE; }
+
+  Int_t  GetNParms() const { return fNames.size(); }
+
+protected:
+
+  std::vector<std::string> fNames;  // Parameters read
+  std::vector<std::string> fAccumulators;  // Accumulators registered
+  THcParmUsage* fParent;    // Usage being recorded when Start was called
+  UInt_t  fSerial;          // Change serial of gHcParms at Start
+  UInt_t  fMapGeneration;   // Generation of gHcDetectorMap at Start
+  Bool_t  fValid;           // Last Init succeeded
+  Bool_t  fActive;          // Between Start and Stop
+
+  void   PassOn();
+};
+
+#endif
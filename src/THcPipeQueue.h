@@ -0,0 +1,77 @@
+#ifndef ROOT_THcPipeQueue
+#define ROOT_THcPipeQueue
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcPipeQueue
+//
+// Bounded lock-free queue between two pipeline stages, one thread
+// producing and one consuming.  Items are filled and read in place.
+//
+//   Producer:  if( T* item = queue.BeginPush() ) { ...; queue.EndPush(); }
+//   Consumer:  if( T* item = queue.Front() )     { ...; queue.Pop(); }
+//
+// An item stays valid for the consumer until it calls Pop.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <vector>
+
+// The GCC atomic builtins are not understood by CINT.  The queue has no
+// dictionary, so it is hidden from rootcint altogether.
+#ifndef __CINT__
+
+template< class T > class THcPipeQueue {
+
+public:
+  THcPipeQueue( UInt_t capacity ) : fItems(capacity > 0 ? capacity : 1),
+				    fHead(0), fTail(0) {}
+
+  UInt_t GetCapacity() const { return fItems.size(); }
+
+  // Producer: next free item, or 0 if the queue is full
+  T*   BeginPush()
+  {
+    ULong64_t head = __atomic_load_n(&fHead, __ATOMIC_RELAXED);
+    if( head - __atomic_load_n(&fTail, __ATOMIC_ACQUIRE) >= fItems.size() )
+      return 0;
+    return &fItems[head % fItems.size()];
+  }
+  // Producer: publish the item returned by BeginPush
+  void EndPush()
+  {
+    __atomic_store_n(&fHead, fHead+1, __ATOMIC_RELEASE);
+  }
+
+  // Consumer: oldest item, or 0 if the queue is empty
+  T*   Front()
+  {
+    ULong64_t tail = __atomic_load_n(&fTail, __ATOMIC_RELAXED);
+    if( tail == __atomic_load_n(&fHead, __ATOMIC_ACQUIRE) )
+      return 0;
+    return &fItems[tail % fItems.size()];
+  }
+  // Consumer: release the item returned by Front
+  void Pop()
+  {
+    __atomic_store_n(&fTail, fTail+1, __ATOMIC_RELEASE);
+  }
+
+  // Either side, approximate
+  UInt_t GetSize() const
+  {
+    return __atomic_load_n(&fHead, __ATOMIC_ACQUIRE) -
+      __atomic_load_n(&fTail, __ATOMIC_ACQUIRE);
+  }
+
+protected:
+  std::vector<T> fItems;
+  ULong64_t fHead;   // Items pushed, written by the producer only
+  char      fPad[64-sizeof(ULong64_t)];  // Keep head and tail on separate cache lines
+  ULong64_t fTail;   // Items popped, written by the consumer only
+};
+
+#endif /* __CINT__ */
+
+#endif
@@ -47,6 +47,8 @@ THcRaster::THcRaster( const char* name, const char* description,
   fFrCalMom = 0;
   fFrXADCperCM = 0;
   fFrXADCperCM = 0;
+  fBeamMomVersion = 0;
+  fMomRatio = 0;
 
   for(Int_t i=0;i<2;i++){
     fPedADC[i] = 0;
@@ -104,6 +106,11 @@ Int_t THcRaster::ReadDatabase( const TDatime& date )
   // get the calibration factors from gbeam.param file
   gHcParms->LoadParmValues((DBRequest*)&list,prefix);
 
+  // The beam momentum used for the raster positions is read every event,
+  // through a handle, in case it is changed during the run.
+  fBeamMom.Bind(gHcParms, "gpbeam", 0.001);
+  fBeamMomVersion = 0;
+
   return kOK;
 
 }
@@ -139,20 +146,32 @@ THaAnalysisObject::EStatus THcRaster::Init( const TDatime& date )
 {
   cout << "THcRaster::Init()" << endl;
 
+  // Nothing to do if the parameters and the detector map are unchanged
+  // since the last successful Init
+  if( fParmUsage.IsUpToDate() ) {
+    fParmUsage.Reuse();
+    return fStatus = kOK;
+  }
+  fParmUsage.Start();
+
   // Fill detector map with RASTER type channels
   if( gHcDetectorMap->FillMap(fDetMap, "RASTER") < 0 ) {
     static const char* const here = "Init()";
     Error( Here(here), "Error filling detectormap for %s.",
   	   "RASTER");
+    fParmUsage.Stop(kFALSE);
     return kInitError;
   }
 
   THcHitList::InitHitList(fDetMap,"THcRasterRawHit",fDetMap->GetTotNumChan()+1);
 
   EStatus status;
-  if( (status = THaBeamDet::Init( date )) )
+  if( (status = THaBeamDet::Init( date )) ) {
+    fParmUsage.Stop(kFALSE);
     return fStatus=status;
+  }
 
+  fParmUsage.Stop(kTRUE);
   return fStatus = kOK;
 
 }
@@ -283,12 +302,10 @@ Int_t THcRaster::Decode( const THaEvData& evdata )
 //_____________________________________________________________________________
 Int_t THcRaster::Process( ){
 
-	Double_t eBeam = 0.001;
-  DBRequest list[] = {
-    {"gpbeam", &eBeam, kDouble, 0, 1},
-    {0}
-  };
-  gHcParms->LoadParmValues(list);
+  if(fBeamMom.GetVersion() != fBeamMomVersion) {
+    fMomRatio = fFrCalMom/fBeamMom.Get();
+    fBeamMomVersion = fBeamMom.GetVersion();
+  }
 
   /*
     calculate raster position from ADC value.
@@ -310,8 +327,8 @@ Int_t THcRaster::Process( ){
     gfry = (gfry_adc/gfry_adcpercm)*(gfr_cal_mom/ebeam)
   */
 
-  fXpos = (fXADC/fFrXADCperCM)*(fFrCalMom/eBeam);
-  fYpos = (fYADC/fFrYADCperCM)*(fFrCalMom/eBeam);
+  fXpos = (fXADC/fFrXADCperCM)*fMomRatio;
+  fYpos = (fYADC/fFrYADCperCM)*fMomRatio;
 
   // std::cout<<" X = "<<fXpos<<" Y = "<<fYpos<<std::endl;
 
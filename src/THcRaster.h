@@ -14,6 +14,8 @@
 #include "THcDetectorMap.h"
 #include "THcRasterRawHit.h"
 #include "THaCutList.h"
+#include "THcParmHandle.h"
+#include "THcParmUsage.h"
 
 class THcRaster : public THaBeamDet, public THcHitList {
 
@@ -71,6 +73,11 @@ class THcRaster : public THaBeamDet, public THcHitList {
   Double_t  fFrXADCperCM;
   Double_t  fFrYADCperCM;
 
+  THcParmHandle<Double_t> fBeamMom; //! gpbeam, may change during the run
+  UInt_t    fBeamMomVersion;        // Version of gpbeam used for fMomRatio
+  Double_t  fMomRatio;              // fFrCalMom/gpbeam
+  THcParmUsage fParmUsage;          //! Parameters read by the last Init
+
 
   void   CalculatePedestals();
   void   AccumulatePedestals(TClonesArray* rawhits);
@@ -0,0 +1,186 @@
+/** \class THcRawSkim
+    \ingroup Base
+
+ Skim of a raw CODA data file.
+
+ The raw events of the physics events that pass a block of cuts (the
+ master cut <block>_master of the block, or all of its cuts if it has
+ none) are written to a new raw file, in the order read.  All other
+ events, i.e. the control events (prestart, go, end) and the scaler,
+ EPICS and other non-physics events, are written as well, so that a
+ replay of the skim sees the same run information and scaler counts as
+ a replay of the full run.  KeepEventType keeps every event of some
+ physics event type, e.g. the pedestal events the detectors need.
+
+ The file is written in the EVIO format of CODA 2 (fixed blocks of 8192
+ words, events continuing across blocks), in the byte order of the
+ host, and is read like any run file.  THcAnalyzer writes it with
+ SetSkim:
+~~~
+     analyzer->SetCutFile("hodtest_cuts.def");
+     analyzer->SetSkim("skim_50017.log", "Golden");
+~~~
+ THcAnalyzer keeps the pedestal events (THcAnalyzer::SetPedestalEvtype)
+ in the skim; SkimEventType adds other types.
+
+*/
+
+#include "THcRawSkim.h"
+#include "THcEventIndex.h"
+#include "THaGlobals.h"
+#include "THaCut.h"
+#include "THaCutList.h"
+#include "TList.h"
+#include "TError.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+  const UInt_t kBlockSize = 8192;      // Words, including the header
+  const UInt_t kHeaderSize = 8;
+  const UInt_t kBlockMagic = 0xc0da0100;
+  const UInt_t kEvioVersion = 1;
+
+  // Blocks evaluated by THaAnalyzer in the analysis stages
+  const char* const kStageBlocks[] = { "RawDecode", "Decode",
+				       "CoarseTracking", "CoarseReconstruct",
+				       "Tracking", "Reconstruct", "Physics", 0 };
+}
+
+//_____________________________________________________________________________
+THcRawSkim::THcRawSkim() :
+  fFile(0), fBuffer(kBlockSize), fUsed(kHeaderSize), fBlockNum(0),
+  fNEvents(0), fNWritten(0), fNPhysics(0), fNPassed(0)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+THcRawSkim::~THcRawSkim()
+{
+  // Destructor
+
+  Close();
+}
+
+//_____________________________________________________________________________
+void THcRawSkim::KeepEventType( UInt_t evtype )
+{
+  if( find(fKeep.begin(), fKeep.end(), evtype) == fKeep.end() )
+    fKeep.push_back(evtype);
+}
+
+//_____________________________________________________________________________
+Bool_t THcRawSkim::Open( const char* file )
+{
+  Close();
+  fFile = fopen(file, "wb");
+  if( !fFile ) {
+    Error("THcRawSkim::Open", "Cannot create %s", file);
+    return kFALSE;
+  }
+  if( fBlock.IsNull() || !gHaCuts->FindBlock(fBlock) )
+    Warning("THcRawSkim::Open", "No cut block \"%s\". Keeping no physics "
+	    "events.", fBlock.Data());
+  fBlockNum = 0;
+  fUsed = kHeaderSize;
+  fBuffer.assign(kBlockSize, 0);
+  fNEvents = fNWritten = fNPhysics = fNPassed = 0;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcRawSkim::Passes() const
+{
+  const TList* cuts = fBlock.IsNull() ? 0 : gHaCuts->FindBlock(fBlock);
+  if( !cuts ) return kFALSE;
+
+  Bool_t stage = kFALSE;
+  for( Int_t i = 0; kStageBlocks[i] && !stage; i++ )
+    stage = (fBlock == kStageBlocks[i]);
+  // An analysis stage block has been evaluated for every event that
+  // passed the analysis
+  if( !stage )
+    gHaCuts->EvalBlock(fBlock);
+
+  const THaCut* master = gHaCuts->FindCut(fBlock + "_master");
+  if( master )
+    return master->GetResult();
+  TIter next(cuts);
+  while( const THaCut* cut = static_cast<const THaCut*>(next()) )
+    if( !cut->GetResult() ) return kFALSE;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcRawSkim::Write( const UInt_t* event, Bool_t passed )
+{
+  // Append event to the file if it is to be kept
+
+  if( !fFile ) return kFALSE;
+  fNEvents++;
+  UInt_t evtype = event[1] >> 16;
+  if( THcEventIndex::IsPhysics(evtype) ) {
+    fNPhysics++;
+    if( passed ) fNPassed++;
+    if( !passed && find(fKeep.begin(), fKeep.end(), evtype) == fKeep.end() )
+      return kTRUE;
+  }
+
+  // Events continue across blocks.  The header word 3 points to the
+  // first event starting in a block.
+  UInt_t n = event[0]+1;
+  Bool_t start = kTRUE;
+  while( n > 0 ) {
+    if( fUsed == kBlockSize && !FlushBlock() )
+      return kFALSE;
+    if( start && fBuffer[3] == 0 )
+      fBuffer[3] = fUsed;
+    start = kFALSE;
+    UInt_t ncopy = min(n, kBlockSize-fUsed);
+    memcpy(&fBuffer[fUsed], event, ncopy*sizeof(UInt_t));
+    fUsed += ncopy;
+    event += ncopy;
+    n -= ncopy;
+  }
+  fNWritten++;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcRawSkim::FlushBlock()
+{
+  // Write the current block, padded to the full block size
+
+  fBuffer[0] = kBlockSize;
+  fBuffer[1] = fBlockNum++;
+  fBuffer[2] = kHeaderSize;
+  fBuffer[4] = fUsed;
+  fBuffer[5] = kEvioVersion;
+  fBuffer[6] = 0;
+  fBuffer[7] = kBlockMagic;
+  if( fUsed < kBlockSize )
+    fill(fBuffer.begin()+fUsed, fBuffer.end(), 0);
+  if( fwrite(&fBuffer[0], sizeof(UInt_t), kBlockSize, fFile) != kBlockSize ) {
+    Error("THcRawSkim::FlushBlock", "Write error");
+    return kFALSE;
+  }
+  fBuffer[3] = 0;
+  fUsed = kHeaderSize;
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcRawSkim::Close()
+{
+  // Write the last block and close the file
+
+  if( !fFile ) return kFALSE;
+  Bool_t ok = (fUsed == kHeaderSize) || FlushBlock();
+  if( fclose(fFile) != 0 ) ok = kFALSE;
+  fFile = 0;
+  return ok;
+}
@@ -0,0 +1,59 @@
+#ifndef ROOT_THcRawSkim
+#define ROOT_THcRawSkim
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcRawSkim
+//
+// Writes the raw CODA events that pass a block of cuts, and the scaler
+// and control events of the run, to a new raw data file.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include "TString.h"
+#include <cstdio>
+#include <vector>
+
+class THcRawSkim {
+
+public:
+  THcRawSkim();
+  ~THcRawSkim();
+
+  // Physics events are kept if they pass the cut block block
+  void     SetBlock( const char* block ) { fBlock = block; }
+  // Keep all events of type evtype, e.g. pedestal events
+  void     KeepEventType( UInt_t evtype );
+
+  Bool_t   Open( const char* file );
+  // Result of the cut block for the current event.  Blocks other than
+  // those of the analysis stages are evaluated here.
+  Bool_t   Passes() const;
+  // Write event, or for physics events only if passed.  event is a
+  // CODA event in host byte order, starting with its length word.
+  Bool_t   Write( const UInt_t* event, Bool_t passed );
+  Bool_t   Close();
+
+  Long64_t GetNEvents() const  { return fNEvents; }
+  Long64_t GetNWritten() const { return fNWritten; }
+  Long64_t GetNPhysics() const { return fNPhysics; }
+  Long64_t GetNPassed() const  { return fNPassed; }
+
+protected:
+  FILE*    fFile;
+  TString  fBlock;
+  std::vector<UInt_t> fKeep;     // Event types always kept
+  std::vector<UInt_t> fBuffer;   // EVIO block being filled
+  UInt_t   fUsed;                // Words used in fBuffer
+  UInt_t   fBlockNum;
+  Long64_t fNEvents, fNWritten, fNPhysics, fNPassed;
+
+  Bool_t   FlushBlock();
+
+private:
+  THcRawSkim( const THcRawSkim& );
+  THcRawSkim& operator=( const THcRawSkim& );
+};
+
+#endif
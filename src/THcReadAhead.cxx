@@ -0,0 +1,192 @@
+/** \class THcReadAhead
+    \ingroup Base
+
+ Asynchronous read-ahead of a raw data file.
+
+ A reader thread reads the file from the requested position onwards in
+ chunks of a few MB, into a ring of buffers (a THcPipeQueue), as far as
+ the number of buffers allows.  Read copies the requested bytes from
+ these buffers, so that the event loop does not block in read calls as
+ long as the reader keeps ahead; it only waits when the ring is empty.
+ A jump backwards, or further ahead than the ring reaches, restarts the
+ reader at the new position.
+
+ The time the reader spends in read calls and the time the event loop
+ spends waiting for data are counted.  A long wait time means the
+ storage, not the analysis, limits the replay.  THcEventIndex reads
+ through this for THcAnalyzer::SetReadAhead.
+
+*/
+
+#include "THcReadAhead.h"
+
+#include <cstdio>
+#include <sched.h>
+#include <unistd.h>
+#include <cstring>
+#include <sys/time.h>
+
+using namespace std;
+
+namespace {
+  Double_t Now()
+  {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + 1e-6*tv.tv_usec;
+  }
+
+  void Wait( Int_t& spins )
+  {
+    if( ++spins < 64 )
+      sched_yield();
+    else
+      usleep(50);
+  }
+}
+
+//_____________________________________________________________________________
+THcReadAhead::THcReadAhead( Int_t depth, Int_t chunksize ) :
+  fQueue(depth), fChunkSize(chunksize > 4096 ? chunksize : 4096), fFd(-1),
+  fRunning(kFALSE), fStop(0), fReadPos(0)
+{
+  // Constructor
+
+  memset(&fStats, 0, sizeof(fStats));
+}
+
+//_____________________________________________________________________________
+THcReadAhead::~THcReadAhead()
+{
+  // Destructor
+
+  Stop();
+}
+
+//_____________________________________________________________________________
+void THcReadAhead::SetFile( int fd )
+{
+  Stop();
+  fFd = fd;
+}
+
+//_____________________________________________________________________________
+void THcReadAhead::Start( Long64_t pos )
+{
+  // Start the reader at pos, rounded down to a page
+
+  Stop();
+  fReadPos = pos & ~4095LL;
+  fStop = 0;
+  if( pthread_create(&fThread, 0, ReaderMain, this) == 0 )
+    fRunning = kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcReadAhead::Stop()
+{
+  // Stop the reader and drop the buffered data
+
+  if( !fRunning ) return;
+  __atomic_store_n(&fStop, 1, __ATOMIC_RELEASE);
+  pthread_join(fThread, 0);
+  fRunning = kFALSE;
+  while( fQueue.Front() )
+    fQueue.Pop();
+}
+
+//_____________________________________________________________________________
+void* THcReadAhead::ReaderMain( void* readahead )
+{
+  static_cast<THcReadAhead*>(readahead)->ReadLoop();
+  return 0;
+}
+
+//_____________________________________________________________________________
+void THcReadAhead::ReadLoop()
+{
+  // Reader thread: fill the ring until the end of the file, an error or
+  // Stop
+
+  for(;;) {
+    Chunk_t* chunk;
+    Int_t spins = 0;
+    while( !(chunk = fQueue.BeginPush()) ) {
+      if( __atomic_load_n(&fStop, __ATOMIC_ACQUIRE) ) return;
+      Wait(spins);
+    }
+    if( chunk->data.size() < (size_t)fChunkSize )
+      chunk->data.resize(fChunkSize);
+    Double_t t0 = Now();
+    ssize_t nread = pread(fFd, &chunk->data[0], fChunkSize, fReadPos);
+    fStats.readtime += Now()-t0;
+    chunk->offset = fReadPos;
+    chunk->size = nread;
+    fQueue.EndPush();
+    if( nread <= 0 ) return;
+    fStats.nchunks++;
+    fStats.nbytes += nread;
+    __atomic_store_n(&fReadPos, fReadPos+nread, __ATOMIC_RELEASE);
+    if( __atomic_load_n(&fStop, __ATOMIC_ACQUIRE) ) return;
+  }
+}
+
+//_____________________________________________________________________________
+Bool_t THcReadAhead::Read( Long64_t pos, Long64_t n, void* dest )
+{
+  // Copy bytes [pos,pos+n) of the file to dest
+
+  if( fFd < 0 ) return kFALSE;
+  char* out = static_cast<char*>(dest);
+  while( n > 0 ) {
+    Chunk_t* chunk = fRunning ? fQueue.Front() : 0;
+    if( !fRunning || (chunk && pos < chunk->offset) ||
+	(!chunk && pos >= __atomic_load_n(&fReadPos, __ATOMIC_ACQUIRE) +
+	 (Long64_t)fQueue.GetCapacity()*fChunkSize) ) {
+      if( fRunning ) fStats.nrestarts++;
+      Start(pos);
+      if( !fRunning ) return kFALSE;
+      chunk = 0;
+    }
+    if( !chunk ) {
+      Double_t t0 = Now();
+      Int_t spins = 0;
+      while( !(chunk = fQueue.Front()) )
+	Wait(spins);
+      fStats.nwaits++;
+      fStats.waittime += Now()-t0;
+    }
+    if( chunk->size <= 0 )
+      return kFALSE;           // End of file or read error; kept in front
+    if( pos < chunk->offset ) continue;
+    Long64_t end = chunk->offset + chunk->size;
+    if( pos >= end ) {
+      if( pos >= end + (Long64_t)fQueue.GetCapacity()*fChunkSize ) {
+	fStats.nrestarts++;
+	Start(pos);
+	if( !fRunning ) return kFALSE;
+      } else {
+	fQueue.Pop();
+      }
+      continue;
+    }
+    Long64_t ncopy = end-pos < n ? end-pos : n;
+    memcpy(out, &chunk->data[pos-chunk->offset], ncopy);
+    out += ncopy;
+    pos += ncopy;
+    n -= ncopy;
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcReadAhead::Print() const
+{
+  // Show the read and wait times.  Call after Stop.
+
+  printf("Read-ahead (%u x %.1f MB)  %lld chunks, %.1f MB in %.2f s of reads\n",
+	 fQueue.GetCapacity(), fChunkSize/1048576.0, fStats.nchunks,
+	 fStats.nbytes/1048576.0, fStats.readtime);
+  printf("  event loop waited for I/O %lld times, %.2f s; %lld restarts\n",
+	 fStats.nwaits, fStats.waittime, fStats.nrestarts);
+}
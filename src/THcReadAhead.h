@@ -0,0 +1,70 @@
+#ifndef ROOT_THcReadAhead
+#define ROOT_THcReadAhead
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcReadAhead
+//
+// Reads a file sequentially on a background thread into a ring of large
+// buffers, from which the event loop copies the bytes it asks for.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include "THcPipeQueue.h"
+#include <pthread.h>
+#include <vector>
+
+class THcReadAhead {
+
+public:
+  struct Stats_t {
+    Long64_t nchunks;     // Reader: chunks read
+    Long64_t nbytes;      // Reader: bytes read
+    Double_t readtime;    // Reader: seconds in read calls
+    Long64_t nwaits;      // Event loop: times it waited for the reader
+    Double_t waittime;    // Event loop: seconds spent waiting
+    Long64_t nrestarts;   // Event loop: jumps that restarted the reader
+  };
+
+  // depth buffers of chunksize bytes
+  THcReadAhead( Int_t depth = 8, Int_t chunksize = 4<<20 );
+  ~THcReadAhead();
+
+  // Read file descriptor fd, which stays owned by the caller
+  void   SetFile( int fd );
+  // Copy the n bytes at offset pos of the file to dest.  Reading is
+  // fastest in increasing order of pos.  Returns kFALSE on a read error
+  // or if the file ends before.
+  Bool_t Read( Long64_t pos, Long64_t n, void* dest );
+  void   Stop();
+
+  const Stats_t& GetStats() const { return fStats; }
+  void   Print() const;
+
+protected:
+  struct Chunk_t {
+    Long64_t offset;      // Of the chunk in the file
+    Long64_t size;        // Bytes read, 0 at the end of the file, < 0 on error
+    std::vector<char> data;
+  };
+
+  THcPipeQueue<Chunk_t> fQueue;
+  Long64_t  fChunkSize;
+  int       fFd;
+  pthread_t fThread;
+  Bool_t    fRunning;
+  Int_t     fStop;        // Set by the event loop to end the reader
+  Long64_t  fReadPos;     // Next offset the reader reads
+  Stats_t   fStats;
+
+  void         Start( Long64_t pos );
+  void         ReadLoop();
+  static void* ReaderMain( void* readahead );
+
+private:
+  THcReadAhead( const THcReadAhead& );
+  THcReadAhead& operator=( const THcReadAhead& );
+};
+
+#endif
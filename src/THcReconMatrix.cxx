@@ -0,0 +1,396 @@
+/** \class THcReconMatrix
+    \ingroup Base
+
+ COSY reconstruction matrix for target traceback.
+
+ The matrix elements are read by THcHallCSpectrometer::ReadDatabase and
+ compiled once into an evaluation plan. For each track the powers of every
+ focal plane coordinate, up to the highest exponent used in the matrix,
+ are tabulated once. Each term is then a product of five table lookups
+ instead of a series of pow() calls.
+
+ Tracks are evaluated as a batch. The loop over tracks is innermost and
+ runs over contiguous arrays, so the compiler can vectorize it, while the
+ terms are summed in the same order as the original term-by-term loop.
+
+ Matrices are obtained with THcReconMatrix::Get, which keeps every matrix
+ read in a registry keyed by file name. Spectrometers using the same
+ coefficient file share one matrix, and later runs in the same process
+ reuse it as long as the MD5 checksum of the file is unchanged. Optionally
+ (parameter `h_recon_coeff_cache` for the HMS) a binary cache file is
+ written next to the parsed matrix. A later process reads the cache
+ instead of parsing the text file if the checksum stored in the cache
+ matches the coefficient file. The cache is written under a temporary
+ name and renamed, so that processes sharing it never read a partial
+ file, and the registry is protected by a mutex.
+
+*/
+
+#include "THcReconMatrix.h"
+
+#include "TError.h"
+#include "TMath.h"
+#include "TMD5.h"
+
+#include <map>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <pthread.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+  // Identifies cache files and their layout
+  const char   kCacheMagic[4] = { 'H', 'C', 'R', 'M' };
+  const Int_t  kCacheVersion  = 1;
+
+  typedef map<string, THcReconMatrix*> ReconRegistry_t;
+
+  pthread_mutex_t gRegistryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+  // Holds the registry mutex for its lifetime
+  struct RegistryLock {
+    RegistryLock()  { pthread_mutex_lock(&gRegistryMutex); }
+    ~RegistryLock() { pthread_mutex_unlock(&gRegistryMutex); }
+  };
+
+  ReconRegistry_t& ReconRegistry()
+  {
+    // Matrices live until the end of the process
+    static ReconRegistry_t registry;
+    return registry;
+  }
+
+  TString FileChecksum( const char* fname )
+  {
+    TMD5* md5 = TMD5::FileChecksum(fname);
+    if( !md5 ) return TString();
+    TString sum = md5->AsString();
+    delete md5;
+    return sum;
+  }
+}
+
+//_____________________________________________________________________________
+THcReconMatrix::THcReconMatrix() : fNTerms(0), fCompiled(kFALSE),
+  fStatus(kReadOK), fNPowers(0)
+{
+  // Constructor
+
+  for(Int_t j=0;j<kNCoord;j++) {
+    fMaxExp[j] = 0;
+    fPowOffset[j] = 0;
+  }
+}
+
+//_____________________________________________________________________________
+THcReconMatrix::~THcReconMatrix()
+{
+  // Destructor
+}
+
+//_____________________________________________________________________________
+void THcReconMatrix::Clear()
+{
+  // Remove all terms
+
+  fNTerms = 0;
+  fCompiled = kFALSE;
+  for(Int_t k=0;k<kNSum;k++) {
+    fCoeff[k].clear();
+  }
+  fExp.clear();
+  fPowIdx.clear();
+  fNPowers = 0;
+  for(Int_t j=0;j<kNCoord;j++) {
+    fMaxExp[j] = 0;
+    fPowOffset[j] = 0;
+  }
+}
+
+//_____________________________________________________________________________
+void THcReconMatrix::AddTerm( const Double_t* coeff, const Int_t* exp )
+{
+  // Add a matrix element with coefficients coeff[kNSum] and
+  // exponents exp[kNCoord]
+
+  for(Int_t k=0;k<kNSum;k++) {
+    fCoeff[k].push_back(coeff[k]);
+  }
+  for(Int_t j=0;j<kNCoord;j++) {
+    Int_t e = exp[j];
+    if(e < 0 || e > kMaxExp) {
+      ::Warning("THcReconMatrix::AddTerm",
+		"Exponent %d out of range for coordinate %d, using 0", e, j);
+      e = 0;
+    }
+    fExp.push_back(e);
+  }
+  fNTerms++;
+  fCompiled = kFALSE;
+}
+
+//_____________________________________________________________________________
+void THcReconMatrix::Compile()
+{
+  // Build the evaluation plan: layout of the power table and, for every
+  // term, the index of the power of each coordinate it needs.
+
+  for(Int_t j=0;j<kNCoord;j++) {
+    fMaxExp[j] = 0;
+  }
+  for(Int_t iterm=0;iterm<fNTerms;iterm++) {
+    for(Int_t j=0;j<kNCoord;j++) {
+      fMaxExp[j] = TMath::Max(fMaxExp[j], fExp[iterm*kNCoord+j]);
+    }
+  }
+  fNPowers = 0;
+  for(Int_t j=0;j<kNCoord;j++) {
+    fPowOffset[j] = fNPowers;
+    fNPowers += fMaxExp[j]+1;
+  }
+  fPowIdx.resize(fNTerms*kNCoord);
+  for(Int_t iterm=0;iterm<fNTerms;iterm++) {
+    for(Int_t j=0;j<kNCoord;j++) {
+      fPowIdx[iterm*kNCoord+j] = fPowOffset[j] + fExp[iterm*kNCoord+j];
+    }
+  }
+  fCompiled = kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcReconMatrix::Eval( Int_t ntracks, const Double_t* hut, Double_t* sum,
+			   vector<Double_t>& work ) const
+{
+  // Compute the COSY sums for ntracks tracks at once.
+
+  if(ntracks <= 0) return;
+  for(Int_t i=0;i<ntracks*kNSum;i++) {
+    sum[i] = 0.0;
+  }
+  if(!fCompiled || fNTerms == 0) return;
+
+  // Power table, laid out as [fNPowers][ntracks]
+  work.resize(fNPowers*ntracks);
+  Double_t* pw = &work[0];
+  for(Int_t j=0;j<kNCoord;j++) {
+    Double_t* p = pw + fPowOffset[j]*ntracks;
+    for(Int_t it=0;it<ntracks;it++) {
+      p[it] = 1.0;
+    }
+    for(Int_t e=1;e<=fMaxExp[j];e++) {
+      Double_t* pe = p + e*ntracks;
+      const Double_t* pm = pe - ntracks;
+      for(Int_t it=0;it<ntracks;it++) {
+	pe[it] = pm[it]*hut[it*kNCoord+j];
+      }
+    }
+  }
+
+  const Double_t* c0 = &fCoeff[0][0];
+  const Double_t* c1 = &fCoeff[1][0];
+  const Double_t* c2 = &fCoeff[2][0];
+  const Double_t* c3 = &fCoeff[3][0];
+  for(Int_t iterm=0;iterm<fNTerms;iterm++) {
+    const Int_t* idx = &fPowIdx[iterm*kNCoord];
+    const Double_t* p0 = pw + idx[0]*ntracks;
+    const Double_t* p1 = pw + idx[1]*ntracks;
+    const Double_t* p2 = pw + idx[2]*ntracks;
+    const Double_t* p3 = pw + idx[3]*ntracks;
+    const Double_t* p4 = pw + idx[4]*ntracks;
+    for(Int_t it=0;it<ntracks;it++) {
+      Double_t term = p0[it]*p1[it]*p2[it]*p3[it]*p4[it];
+      Double_t* s = sum + it*kNSum;
+      s[0] += term*c0[iterm];
+      s[1] += term*c1[iterm];
+      s[2] += term*c2[iterm];
+      s[3] += term*c3[iterm];
+    }
+  }
+}
+
+//_____________________________________________________________________________
+Int_t THcReconMatrix::ReadFile( const char* fname )
+{
+  // Read the matrix elements from a COSY reconstruction coefficient file
+  // and compile them. Returns one of EReadStatus.
+
+  Clear();
+
+  ifstream ifile;
+  ifile.open(fname);
+  if(!ifile.is_open()) {
+    return kReadNoFile;
+  }
+
+  string line="!";
+  int good=1;
+  while(good && line[0]=='!') {
+    good = getline(ifile,line).good();
+  }
+  // Read in focal plane rotation coefficients
+  // Probably not used, so for now, just paste in fortran code as a comment
+  while(good && line.compare(0,4," ---")!=0) {
+    //  if(line(1:13).eq.'h_ang_slope_x')read(line,1201,err=94)h_ang_slope_x
+    //  if(line(1:13).eq.'h_ang_slope_y')read(line,1201,err=94)h_ang_slope_y
+    //  if(line(1:14).eq.'h_ang_offset_x')read(line,1201,err=94)h_ang_offset_x
+    //  if(line(1:14).eq.'h_ang_offset_y')read(line,1201,err=94)h_ang_offset_y
+    //  if(line(1:14).eq.'h_det_offset_x')read(line,1201,err=94)h_det_offset_x
+    //  if(line(1:14).eq.'h_det_offset_y')read(line,1201,err=94)h_det_offset_y
+    //  if(line(1:14).eq.'h_z_true_focus')read(line,1201,err=94)h_z_true_focus
+    good = getline(ifile,line).good();
+  }
+  // Read in reconstruction coefficients and exponents
+  line=" ";
+  good = getline(ifile,line).good();
+  while(good && line.compare(0,4," ---")!=0) {
+    Double_t coeff[kNSum] = {0.0, 0.0, 0.0, 0.0};
+    Int_t exp[kNCoord] = {0, 0, 0, 0, 0};
+    sscanf(line.c_str()," %le %le %le %le %1d%1d%1d%1d%1d"
+	   ,&coeff[0],&coeff[1],&coeff[2],&coeff[3]
+	   ,&exp[0],&exp[1],&exp[2],&exp[3],&exp[4]);
+    AddTerm(coeff, exp);
+    good = getline(ifile,line).good();
+  }
+  Compile();
+
+  return good ? kReadOK : kReadIncomplete;
+}
+
+//_____________________________________________________________________________
+Bool_t THcReconMatrix::ReadCache( const char* cachefile,
+				  const TString& checksum )
+{
+  // Read the matrix from a binary cache file. Returns kFALSE if the file
+  // does not exist, is damaged, or was made from a different version of
+  // the coefficient file (checksum mismatch).
+
+  FILE* fp = fopen(cachefile, "rb");
+  if( !fp ) return kFALSE;
+
+  Bool_t ok = kFALSE;
+  char magic[4];
+  Int_t version, status, nterms;
+  char sum[33];
+  if( fread(magic, sizeof(magic), 1, fp) == 1 &&
+      memcmp(magic, kCacheMagic, sizeof(magic)) == 0 &&
+      fread(&version, sizeof(version), 1, fp) == 1 &&
+      version == kCacheVersion &&
+      fread(sum, 32, 1, fp) == 1 ) {
+    sum[32] = '\0';
+    if( checksum == sum &&
+	fread(&status, sizeof(status), 1, fp) == 1 &&
+	fread(&nterms, sizeof(nterms), 1, fp) == 1 &&
+	nterms >= 0 ) {
+      Clear();
+      ok = kTRUE;
+      for(Int_t k=0;k<kNSum && ok;k++) {
+	fCoeff[k].resize(nterms);
+	if( nterms > 0 )
+	  ok = (fread(&fCoeff[k][0], sizeof(Double_t), nterms, fp) == (size_t)nterms);
+      }
+      fExp.resize(nterms*kNCoord);
+      if( ok && nterms > 0 )
+	ok = (fread(&fExp[0], sizeof(Int_t), nterms*kNCoord, fp)
+	      == (size_t)(nterms*kNCoord));
+      for(Int_t i=0;ok && i<nterms*kNCoord;i++) {
+	ok = (fExp[i] >= 0 && fExp[i] <= kMaxExp);
+      }
+      if( ok ) {
+	fNTerms = nterms;
+	fStatus = status;
+	Compile();
+      } else {
+	Clear();
+      }
+    }
+  }
+  fclose(fp);
+  return ok;
+}
+
+//_____________________________________________________________________________
+Bool_t THcReconMatrix::WriteCache( const char* cachefile,
+				   const TString& checksum ) const
+{
+  // Write the matrix to a binary cache file, tagged with the checksum of
+  // the coefficient file it was read from. The file is written under a
+  // name unique to this process and renamed when complete.
+
+  if( checksum.Length() != 32 ) return kFALSE;
+  TString tmpfile = Form("%s.tmp%d", cachefile, (Int_t)getpid());
+  FILE* fp = fopen(tmpfile, "wb");
+  if( !fp ) return kFALSE;
+
+  Bool_t ok =
+    fwrite(kCacheMagic, sizeof(kCacheMagic), 1, fp) == 1 &&
+    fwrite(&kCacheVersion, sizeof(kCacheVersion), 1, fp) == 1 &&
+    fwrite(checksum.Data(), 32, 1, fp) == 1 &&
+    fwrite(&fStatus, sizeof(fStatus), 1, fp) == 1 &&
+    fwrite(&fNTerms, sizeof(fNTerms), 1, fp) == 1;
+  for(Int_t k=0;k<kNSum && ok && fNTerms>0;k++) {
+    ok = (fwrite(&fCoeff[k][0], sizeof(Double_t), fNTerms, fp) == (size_t)fNTerms);
+  }
+  if( ok && fNTerms > 0 )
+    ok = (fwrite(&fExp[0], sizeof(Int_t), fNTerms*kNCoord, fp)
+	  == (size_t)(fNTerms*kNCoord));
+  if( fclose(fp) != 0 ) ok = kFALSE;
+  if( ok && rename(tmpfile, cachefile) != 0 ) ok = kFALSE;
+  if( !ok ) remove(tmpfile);
+  return ok;
+}
+
+//_____________________________________________________________________________
+const THcReconMatrix* THcReconMatrix::Get( const char* fname,
+					   const char* cachefile,
+					   Int_t& status )
+{
+  // Return the compiled matrix for coefficient file fname, or NULL if the
+  // file cannot be read. status is set to one of EReadStatus.
+
+  static const char* const here = "THcReconMatrix::Get";
+
+  TString checksum = FileChecksum(fname);
+  if( checksum.IsNull() ) {
+    status = kReadNoFile;
+    return NULL;
+  }
+
+  RegistryLock lock;
+  ReconRegistry_t& registry = ReconRegistry();
+  ReconRegistry_t::iterator it = registry.find(fname);
+  if( it != registry.end() && it->second->fChecksum == checksum ) {
+    status = it->second->fStatus;
+    return it->second;
+  }
+
+  // Not loaded yet or file changed. A matrix that is replaced is still in
+  // use by the spectrometers that got it, so it is never deleted.
+  THcReconMatrix* matrix = new THcReconMatrix;
+  Bool_t have_cache = kFALSE;
+  if( cachefile && *cachefile ) {
+    have_cache = matrix->ReadCache(cachefile, checksum);
+    if( have_cache )
+      cout << "Read reconstruction matrix from cache " << cachefile << endl;
+  }
+  if( !have_cache ) {
+    matrix->fStatus = matrix->ReadFile(fname);
+    if( matrix->fStatus == kReadNoFile ) {
+      delete matrix;
+      status = kReadNoFile;
+      return NULL;
+    }
+    if( cachefile && *cachefile && !matrix->WriteCache(cachefile, checksum) )
+      ::Warning(here, "Cannot write reconstruction matrix cache %s",
+		cachefile);
+  }
+  matrix->fChecksum = checksum;
+  registry[fname] = matrix;
+
+  status = matrix->fStatus;
+  return matrix;
+}
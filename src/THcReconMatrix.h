@@ -0,0 +1,75 @@
+#ifndef ROOT_THcReconMatrix
+#define ROOT_THcReconMatrix
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcReconMatrix
+//
+// COSY reconstruction matrix compiled into a monomial evaluation plan.
+//
+// Matrices read from a coefficient file are kept in a process-wide
+// registry, shared by all spectrometers and runs that use the same file.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include "TString.h"
+#include <vector>
+
+class THcReconMatrix {
+
+public:
+  // Number of focal plane coordinates and of reconstructed quantities
+  enum { kNCoord = 5, kNSum = 4, kMaxExp = 9 };
+
+  // Status codes of ReadFile and Get
+  enum EReadStatus { kReadOK = 0, kReadNoFile = -1, kReadIncomplete = -2 };
+
+  // Get the compiled matrix for coefficient file fname. The matrix is read
+  // only if it is not yet in the registry or the file has changed since.
+  // If cachefile is given, a binary copy of the matrix is kept there and
+  // used instead of parsing fname as long as the file checksum matches.
+  static const THcReconMatrix* Get( const char* fname, const char* cachefile,
+				    Int_t& status );
+
+  THcReconMatrix();
+  ~THcReconMatrix();
+
+  void  Clear();
+  void  AddTerm( const Double_t* coeff, const Int_t* exp );
+  void  Compile();
+
+  Int_t  ReadFile( const char* fname );
+  Bool_t ReadCache( const char* cachefile, const TString& checksum );
+  Bool_t WriteCache( const char* cachefile, const TString& checksum ) const;
+
+  Int_t GetNTerms() const { return fNTerms; }
+  Int_t GetMaxExp( Int_t j ) const { return fMaxExp[j]; }
+
+  // Evaluate the COSY sums for a batch of tracks.
+  //   hut[ntracks][kNCoord]  rotated focal plane coordinates
+  //   sum[ntracks][kNSum]    xptar, ytar, yptar, delta
+  //   work                   caller-owned scratch space
+  void  Eval( Int_t ntracks, const Double_t* hut, Double_t* sum,
+	      std::vector<Double_t>& work ) const;
+
+protected:
+
+  Int_t  fNTerms;
+  Bool_t fCompiled;
+  Int_t  fStatus;              // Result of reading the coefficient file
+  TString fChecksum;           // MD5 of the coefficient file
+
+  // Terms as read, coefficients stored column-wise so that each of the
+  // four sums runs over contiguous memory
+  std::vector<Double_t> fCoeff[kNSum];  // [kNSum][fNTerms]
+  std::vector<Int_t>    fExp;           // [fNTerms][kNCoord]
+
+  // Evaluation plan
+  Int_t  fMaxExp[kNCoord];     // Highest power needed of each coordinate
+  Int_t  fPowOffset[kNCoord];  // Start of each coordinate in power table
+  Int_t  fNPowers;             // Size of power table
+  std::vector<Int_t> fPowIdx;  // [fNTerms][kNCoord] index into power table
+};
+
+#endif
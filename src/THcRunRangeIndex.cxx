@@ -0,0 +1,286 @@
+/** \class THcRunRangeIndex
+    \ingroup Base
+
+ Index of the run range blocks of an ENGINE style database file.
+
+ In a database file, parameter assignments are grouped in blocks that
+ start with a run range header, either a single run number or a range
+ `AAAA-BBBB`.  THcParmList::Load(fname, RunNumber) reads only the blocks
+ whose range contains RunNumber.
+
+ The index holds the byte offsets of every block and its run range, with
+ the ranges also sorted by first run so that the blocks for a run are
+ found without scanning the file.  THcParmList::Load seeks straight to
+ these blocks.  For each block the names of the parameters assigned in it
+ are kept as well, so that jobs processing several runs can ask which
+ parameters may change from one run to the next (GetDelta and
+ THcParmList::GetRunDelta).
+
+ Files containing `#include` statements are still indexed, but
+ THcParmList::Load reads them in full, since included files are read
+ regardless of the run range they appear in.
+
+ An index is used as long as the size and modification time of its file
+ are unchanged.  If either changed, the MD5 checksum of the file is
+ compared, and the index is rebuilt only if the contents changed.  The
+ registry of indexes may be used from several threads.  The offsets are
+ byte counts of the lines as read, including any carriage return of a
+ CRLF line end.
+
+*/
+
+#include "THcRunRangeIndex.h"
+
+#include "TMD5.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <set>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+
+#include <pthread.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+  typedef map<string, THcRunRangeIndex*> IndexRegistry_t;
+
+  pthread_mutex_t gRegistryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+  // Holds the registry mutex for its lifetime
+  struct RegistryLock {
+    RegistryLock()  { pthread_mutex_lock(&gRegistryMutex); }
+    ~RegistryLock() { pthread_mutex_unlock(&gRegistryMutex); }
+  };
+
+  IndexRegistry_t& IndexRegistry()
+  {
+    // Indexes live until the end of the process
+    static IndexRegistry_t registry;
+    return registry;
+  }
+
+  string FileChecksum( const char* fname )
+  {
+    TMD5* md5 = TMD5::FileChecksum(fname);
+    if( !md5 ) return string();
+    string sum = md5->AsString();
+    delete md5;
+    return sum;
+  }
+
+  // Sorts block indices by first run of the block
+  struct FirstRunLess {
+    const vector<THcRunRangeIndex::Block>& fBlocks;
+    FirstRunLess( const vector<THcRunRangeIndex::Block>& blocks )
+      : fBlocks(blocks) {}
+    bool operator()( Int_t a, Int_t b ) const {
+      return fBlocks[a].first < fBlocks[b].first;
+    }
+  };
+}
+
+//_____________________________________________________________________________
+const THcRunRangeIndex* THcRunRangeIndex::Get( const char* fname )
+{
+  // Return the index of database file fname, building it if it is not
+  // yet in the registry or the file has changed since.
+
+  struct stat st;
+  if( stat(fname, &st) != 0 ) return NULL;
+
+  RegistryLock lock;
+  IndexRegistry_t& registry = IndexRegistry();
+  IndexRegistry_t::iterator it = registry.find(fname);
+  if( it != registry.end() && it->second->fSize == st.st_size &&
+      it->second->fMTime == st.st_mtime )
+    return it->second;
+
+  // Size or time changed: hash to see if the contents did
+  string checksum = FileChecksum(fname);
+  if( checksum.empty() ) return NULL;
+  if( it != registry.end() && it->second->fChecksum == checksum ) {
+    it->second->fSize = st.st_size;
+    it->second->fMTime = st.st_mtime;
+    return it->second;
+  }
+
+  THcRunRangeIndex* index = new THcRunRangeIndex;
+  if( index->Build(fname) != 0 ) {
+    delete index;
+    return NULL;
+  }
+  index->fChecksum = checksum;
+  index->fSize = st.st_size;
+  index->fMTime = st.st_mtime;
+  // An index that is replaced may still be in use by a Load in progress
+  // further up the stack, so it is never deleted.
+  registry[fname] = index;
+  return index;
+}
+
+//_____________________________________________________________________________
+Bool_t THcRunRangeIndex::ParseRange( const string& line, Int_t& first,
+				     Int_t& last )
+{
+  // Interpret line, with white space and comments removed, as a run
+  // range header.  Returns kFALSE if it is not one.
+
+  if( line.empty() || line.find_first_not_of("0123456789-") != string::npos )
+    return kFALSE;
+  string::size_type pos = line.find('-');
+  if( pos != string::npos ) {
+    first = atoi(line.substr(0,pos).c_str());
+    last = atoi(line.c_str()+pos+1);
+  } else {		// A single run
+    first = last = atoi(line.c_str());
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+string::size_type THcRunRangeIndex::FindComment( const string& line,
+						 string::size_type pos )
+{
+  // Find the start of a comment in line at or after pos.  Text in quotes
+  // ('...' or "...", with a doubled quote standing for the quote
+  // character) is not searched.
+
+  char quotechar = 0;
+  for( ; pos < line.length(); pos++ ) {
+    char c = line[pos];
+    if( quotechar ) {
+      if( c == quotechar ) {
+	if( pos+1 < line.length() && line[pos+1] == quotechar )
+	  pos++;		// Protected quote
+	else
+	  quotechar = 0;
+      }
+    } else if( c == '"' || c == '\'' ) {
+      quotechar = c;
+    } else if( c == '#' || c == ';' || line.compare(pos,2,"//") == 0 ) {
+      return pos;
+    }
+  }
+  return string::npos;
+}
+
+//_____________________________________________________________________________
+Int_t THcRunRangeIndex::Build( const char* fname )
+{
+  // Scan database file fname and record its run range blocks.
+  // Returns -1 if the file cannot be opened.
+
+  fBlocks.clear();
+  fOrder.clear();
+  fMaxLast.clear();
+  fHasIncludes = kFALSE;
+
+  ifstream ifile(fname);
+  if( !ifile.is_open() ) return -1;
+
+  string line, stripped;
+  Long64_t offset = 0;
+  set<string> names;		// Names already listed for the current block
+  while( getline(ifile, line) ) {
+    Long64_t linestart = offset;
+    offset += line.length()+1;
+
+    if( line.compare(0,8,"#include") == 0 ) {
+      fHasIncludes = kTRUE;
+      continue;
+    }
+    // Drop white space (including the CR of CRLF line ends), and stop
+    // at a comment
+    stripped.clear();
+    string::size_type end = FindComment(line);
+    if( end == string::npos ) end = line.length();
+    for( string::size_type i = 0; i < end; i++ ) {
+      char c = line[i];
+      if( c != ' ' && c != '\t' && c != '\r' ) stripped += c;
+    }
+
+    Int_t first, last;
+    if( ParseRange(stripped, first, last) ) {
+      if( !fBlocks.empty() ) fBlocks.back().end = linestart;
+      fBlocks.push_back(Block());
+      Block& b = fBlocks.back();
+      b.first = first;
+      b.last = last;
+      b.begin = offset;
+      b.end = offset;
+      names.clear();
+      continue;
+    }
+    string::size_type eq = stripped.find('=');
+    if( !fBlocks.empty() && eq != string::npos && eq > 0 ) {
+      string name = stripped.substr(0,eq);
+      if( names.insert(name).second )
+	fBlocks.back().names.push_back(name);
+    }
+  }
+  if( !fBlocks.empty() ) fBlocks.back().end = offset;
+
+  // Sorted interval list
+  Int_t nblocks = fBlocks.size();
+  fOrder.resize(nblocks);
+  for( Int_t i = 0; i < nblocks; i++ ) fOrder[i] = i;
+  stable_sort(fOrder.begin(), fOrder.end(), FirstRunLess(fBlocks));
+  fMaxLast.resize(nblocks);
+  for( Int_t i = 0; i < nblocks; i++ ) {
+    Int_t last = fBlocks[fOrder[i]].last;
+    fMaxLast[i] = (i > 0 && fMaxLast[i-1] > last) ? fMaxLast[i-1] : last;
+  }
+  return 0;
+}
+
+//_____________________________________________________________________________
+void THcRunRangeIndex::FindBlocks( Int_t run, vector<Int_t>& blocks ) const
+{
+  // Fill blocks with the indices of the blocks whose range contains run,
+  // in the order they appear in the file.
+
+  blocks.clear();
+  // Blocks starting after run cannot match.  Walk back from there as
+  // long as some earlier block may still reach run.
+  Int_t lo = 0, hi = fOrder.size();
+  while( lo < hi ) {
+    Int_t mid = (lo+hi)/2;
+    if( fBlocks[fOrder[mid]].first <= run ) lo = mid+1;
+    else hi = mid;
+  }
+  for( Int_t i = lo-1; i >= 0 && fMaxLast[i] >= run; i-- ) {
+    if( fBlocks[fOrder[i]].last >= run )
+      blocks.push_back(fOrder[i]);
+  }
+  sort(blocks.begin(), blocks.end());
+}
+
+//_____________________________________________________________________________
+void THcRunRangeIndex::GetDelta( Int_t run1, Int_t run2,
+				 vector<string>& names ) const
+{
+  // Fill names with the parameters that may have different values for
+  // run2 than for run1: those assigned in a block that applies to only
+  // one of the two runs.
+
+  names.clear();
+  vector<Int_t> blocks1, blocks2, changed;
+  FindBlocks(run1, blocks1);
+  FindBlocks(run2, blocks2);
+  set_symmetric_difference(blocks1.begin(), blocks1.end(),
+			   blocks2.begin(), blocks2.end(),
+			   back_inserter(changed));
+  set<string> seen;
+  for( UInt_t i = 0; i < changed.size(); i++ ) {
+    const vector<string>& bnames = fBlocks[changed[i]].names;
+    for( UInt_t j = 0; j < bnames.size(); j++ ) {
+      if( seen.insert(bnames[j]).second )
+	names.push_back(bnames[j]);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#ifndef ROOT_THcRunRangeIndex
+#define ROOT_THcRunRangeIndex
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcRunRangeIndex
+//
+// Index of the run range blocks of an ENGINE style database file.
+//
+// Indexes are kept in a process-wide registry and rebuilt only when the
+// contents of the file change.  A file whose size and modification time
+// are unchanged is not read again.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+
+class THcRunRangeIndex {
+
+public:
+  // Lines following a run range header, up to the next header
+  struct Block {
+    Int_t    first, last;     // Run range of the header
+    Long64_t begin, end;      // Byte offsets of the block
+    std::vector<std::string> names;  // Parameters assigned in the block
+  };
+
+  // Get the index of database file fname, or NULL if it cannot be read
+  static const THcRunRangeIndex* Get( const char* fname );
+
+  // Parse a run range header ("AAAA-BBBB" or "AAAA", white space removed)
+  static Bool_t ParseRange( const std::string& line, Int_t& first,
+			    Int_t& last );
+  // Start of the comment (#, ; or //) of a parameter file line, looking
+  // from pos on and skipping quoted strings, or npos if there is none
+  static std::string::size_type FindComment( const std::string& line,
+					     std::string::size_type pos = 0 );
+
+  Int_t Build( const char* fname );
+
+  // Indices of the blocks that apply to run, in file order
+  void  FindBlocks( Int_t run, std::vector<Int_t>& blocks ) const;
+
+  // Parameters that may differ between run1 and run2
+  void  GetDelta( Int_t run1, Int_t run2,
+		  std::vector<std::string>& names ) const;
+
+  Int_t GetNBlocks() const { return fBlocks.size(); }
+  const Block& GetBlock( Int_t i ) const { return fBlocks[i]; }
+  Bool_t HasIncludes() const { return fHasIncludes; }
+
+protected:
+
+  std::vector<Block> fBlocks;   // In file order
+  std::vector<Int_t> fOrder;    // Blocks sorted by first run
+  std::vector<Int_t> fMaxLast;  // Largest last run of fOrder[0..i]
+  Bool_t   fHasIncludes;        // File has #include statements
+  std::string fChecksum;        // MD5 of the file when the index was built
+  Long64_t fSize;               // Size and modification time of the file
+  Long64_t fMTime;              // when last checked
+};
+
+#endif
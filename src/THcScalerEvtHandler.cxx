@@ -17,6 +17,12 @@ The list of global variables and how they are tied to the
 scaler module and channels is defined here; eventually this
 will be modified to use a scaler.map file
 
+Scaler banks are found by their header words.  At Init, the headers and
+header masks from the map file are indexed, so that each word of a
+scaler event is looked up once rather than offered to every scaler.
+The event is decoded in place from the event buffer.  A bank that would
+run past the end of the event is dropped (its scaler is cleared).
+
 NOTE: if you don't have the scaler map file (e.g. Leftscalevt.map)
 there will be no variable output to the Trees.
 
@@ -24,6 +30,18 @@ To use in the analyzer, your setup script needs something like this
 ~~~
      gHaEvtHandlers->Add (new THcScalerEvtHandler("HMS","HC scaler event type 0"));
 ~~~
+The raw counts of all counting variables are also recorded in a
+THcScalerHistory, which gives counts, rates, charge and live time
+between any two events.  It can be saved at the end of the run:
+~~~
+     hscaler->SetHistoryFile("HMS_scalers.dat");
+~~~
+For online monitoring, the counts and rates of the most recent reads can
+be kept in a THcScalerRing, which other threads, or other processes
+mapping the given file, can read while the replay runs:
+~~~
+     hscaler->SetRing(64, "/dev/shm/HMS_scalers");
+~~~
 To enable debugging you may try this in the setup script
 ~~~
      THcScalerEvtHandler *hscaler = new THcScalerEvtHandler("HS","HC scaler event type 0");
@@ -50,8 +68,11 @@ To enable debugging you may try this in the setup script
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 #include "THaVarList.h"
 #include "VarDef.h"
+#include "THcGlobals.h"
+#include "THcParmList.h"
 
 using namespace std;
 using namespace Decoder;
@@ -59,19 +80,16 @@ using namespace Decoder;
 static const UInt_t ICOUNT    = 1;
 static const UInt_t IRATE     = 2;
 static const UInt_t MAXCHAN   = 32;
-static const UInt_t MAXTEVT   = 5000;
 static const UInt_t defaultDT = 4;
 
 THcScalerEvtHandler::THcScalerEvtHandler(const char *name, const char* description)
   : THaEvtTypeHandler(name,description), evcount(0), ifound(0), fNormIdx(-1),
-    dvars(0), dvarsFirst(0), fScalerTree(0)
+    fClockChan(-1), fClockFreq(0), fRingSlots(0), dvars(0), dvarsFirst(0), fScalerTree(0)
 {
-  rdata = new UInt_t[MAXTEVT];
 }
 
 THcScalerEvtHandler::~THcScalerEvtHandler()
 {
-  delete [] rdata;
   if (fScalerTree) {
     delete fScalerTree;
   }
@@ -80,6 +98,8 @@ THcScalerEvtHandler::~THcScalerEvtHandler()
 Int_t THcScalerEvtHandler::End( THaRunBase* r)
 {
   if (fScalerTree) fScalerTree->Write();
+  if (fHistoryFile.Length() > 0 && !fHistory.Write(fHistoryFile.Data()))
+    cout << "THcScalerEvtHandler:: ERROR: cannot write scaler history "<<fHistoryFile<<endl;
   return 0;
 }
 
@@ -126,40 +146,63 @@ Int_t THcScalerEvtHandler::Analyze(THaEvData *evdata)
   }  // if (lfirst && !fScalerTree)
 
 
-  // Parse the data, load local data arrays.
+  // Parse the data directly from the event buffer
 
   Int_t ndata = evdata->GetEvLength();
-  if (ndata >= static_cast<Int_t>(MAXTEVT)) {
-    cout << "THcScalerEvtHandler:: ERROR: Event length crazy "<<endl;
-    ndata = MAXTEVT-1;
-  }
 
   if (fDebugFile) *fDebugFile<<"\n\nTHcScalerEvtHandler :: Debugging event type "<<dec<<evdata->GetEvType()<<endl<<endl;
 
-  // local copy of data
-
-  for (Int_t i=0; i<ndata; i++) rdata[i] = evdata->GetRawData(i);
-
-  Int_t nskip=0;
-  UInt_t *p = rdata;
-  UInt_t *pstop = rdata+ndata;
+  const UInt_t *p = evdata->GetRawDataBuffer();
+  const UInt_t *pstop = p+ndata;
   int j=0;
 
   ifound = 0;
+  fDecoded.assign(scalers.size(), 0);
 
-  while (p < pstop && j < ndata) {
-	if (fDebugFile) {
-      		*fDebugFile << "p  and  pstop  "<<j++<<"   "<<p<<"   "<<pstop<<"   "<<hex<<*p<<"   "<<dec<<endl;
+  while (p < pstop) {
+    if (fDebugFile) {
+      *fDebugFile << "p  and  pstop  "<<j++<<"   "<<p<<"   "<<pstop<<"   "<<hex<<*p<<"   "<<dec<<endl;
     }
-    nskip = 1;
-    for (size_t j=0; j<scalers.size(); j++) {
-      nskip = scalers[j]->Decode(p);
-      if (fDebugFile && nskip > 1) {
-	*fDebugFile << "\n===== Scaler # "<<j<<"     fName = "<<fName<<"   nskip = "<<nskip<<endl;
-	scalers[j]->DebugPrint(fDebugFile);
+    // Scalers whose header matches this word, in map file order
+    fCandidates.clear();
+    for (size_t k=0; k<fHeaderIndex.size(); k++) {
+      const HeaderIndex& hi = fHeaderIndex[k];
+      pair<UInt_t,Int_t> key(*p & hi.mask, -1);
+      vector< pair<UInt_t,Int_t> >::const_iterator it =
+	lower_bound(hi.headers.begin(), hi.headers.end(), key);
+      for (; it != hi.headers.end() && it->first == key.first; ++it)
+	fCandidates.push_back(it->second);
+    }
+    if (fHeaderIndex.size() > 1)
+      sort(fCandidates.begin(), fCandidates.end());
+    Int_t nskip = 1;
+    Int_t nleft = pstop - p;
+    const UInt_t *pdecode = p;
+    if (!fCandidates.empty() && nleft < static_cast<Int_t>(MAXCHAN+1)) {
+      // Near the end of the event, decode from a zero-padded copy so that
+      // a bank longer than the rest of the event is not read past pstop
+      fPadded.assign(MAXCHAN+1, 0);
+      copy(p, pstop, fPadded.begin());
+      pdecode = &fPadded[0];
+    }
+    for (size_t k=0; k<fCandidates.size(); k++) {
+      Int_t isca = fCandidates[k];
+      Int_t n = scalers[isca]->Decode(pdecode);
+      if (n > nleft) {
+	// Truncated bank: drop what was decoded from the padding
+	if (fDebugFile) *fDebugFile << "Scaler # "<<isca<<" bank of "<<n<<" words runs past the event end ("<<nleft<<" words left)"<<endl;
+	scalers[isca]->Clear();
+	n = nleft;
+      } else if (n > 1) {
+	fDecoded[isca] = 1;
+      }
+      if (fDebugFile && n > 1) {
+	*fDebugFile << "\n===== Scaler # "<<isca<<"     fName = "<<fName<<"   nskip = "<<n<<endl;
+	scalers[isca]->DebugPrint(fDebugFile);
       }
-      if (nskip > 1) {
+      if (n > 1) {
 	ifound = 1;
+	nskip = n;
 	break;
       }
     }
@@ -210,6 +253,28 @@ Int_t THcScalerEvtHandler::Analyze(THaEvData *evdata)
 
   evcount = evcount + 1.0;
 
+  if (!fHistCounts.empty()) {
+    // Channels of scalers not read in this event (or dropped as truncated)
+    // keep their last counts and rates.  A read is recorded if any channel
+    // was read now, once all of them have been read at least once.
+    Bool_t record = kFALSE, complete = kTRUE;
+    for (size_t i = 0; i < fHistCounts.size(); i++) {
+      if (fDecoded[fHistScaler[i]]) {
+	fHistCounts[i] = static_cast<UInt_t>(scalers[fHistScaler[i]]->GetData(fHistChan[i]));
+	if (i < fHistRates.size())
+	  fHistRates[i] = scalers[fHistScaler[i]]->GetRate(fHistChan[i]);
+	fHistSeen[i] = 1;
+	record = kTRUE;
+      }
+      if (!fHistSeen[i]) complete = kFALSE;
+    }
+    if (record && complete) {
+      fHistory.Append(evdata->GetEvNum(), evdata->GetEvTime(), &fHistCounts[0]);
+      if (fRing.IsReady())
+	fRing.Push(evdata->GetEvNum(), evdata->GetEvTime(), &fHistCounts[0], &fHistRates[0]);
+    }
+  }
+
   for (size_t j=0; j<scalers.size(); j++) scalers[j]->Clear("");
 
   if (fDebugFile) *fDebugFile << "scaler tree ptr  "<<fScalerTree<<endl;
@@ -292,28 +357,31 @@ THaAnalysisObject::EStatus THcScalerEvtHandler::Init(const TDatime& date)
 	  *fDebugFile << "map line "<<dec<<imodel<<"  "<<icrate<<"  "<<islot<<endl;
 	  *fDebugFile <<"   header  0x"<<hex<<header<<"  0x"<<mask<<dec<<"  "<<inorm<<"  "<<clkchan<<"  "<<clkfreq<<endl;
 	}
+	GenScaler* scaler = 0;
 	switch (imodel) {
 	case 560:
-	  scalers.push_back(new Scaler560(icrate, islot));
+	  scaler = new Scaler560(icrate, islot);
 	  break;
 	case 1151:
-	  scalers.push_back(new Scaler1151(icrate, islot));
+	  scaler = new Scaler1151(icrate, islot);
 	  break;
 	case 3800:
-	  scalers.push_back(new Scaler3800(icrate, islot));
+	  scaler = new Scaler3800(icrate, islot);
 	  break;
 	case 3801:
-	  scalers.push_back(new Scaler3801(icrate, islot));
+	  scaler = new Scaler3801(icrate, islot);
 	  break;
 	}
+	if (scaler) AddScaler(scaler, header, mask);
 	if (scalers.size() > 0) {
 	  UInt_t idx = scalers.size()-1;
-	  scalers[idx]->SetHeader(header, mask);
 	  if (clkchan >= 0) {
 		  scalers[idx]->SetClock(defaultDT, clkchan, clkfreq);
 		  cout << "Setting scaler clock ... channel = "<<clkchan<<" ... freq = "<<clkfreq<<endl;
 		  if (fDebugFile) *fDebugFile <<"Setting scaler clock ... channel = "<<clkchan<<" ... freq = "<<clkfreq<<endl;
 		  fNormIdx = idx;
+		  fClockChan = clkchan;
+		  fClockFreq = clkfreq;
 	  }
 	}
       }
@@ -330,6 +398,7 @@ THaAnalysisObject::EStatus THcScalerEvtHandler::Init(const TDatime& date)
       scalers[i]->LoadNormScaler(scalers[fNormIdx]);
     }
   }
+  BuildHeaderIndex();
 
 #ifdef HARDCODED
   // This code is superseded by the parsing of a map file above.  It's another way ...
@@ -348,36 +417,30 @@ THaAnalysisObject::EStatus THcScalerEvtHandler::Init(const TDatime& date)
 
 
   DefVars();
+  InitHistory();
 
 #ifdef HARDCODED
   // This code is superseded by the parsing of a map file above.  It's another way ...
   if (fName == "Left") {
-    scalers.push_back(new Scaler1151(1,0));
-    scalers.push_back(new Scaler3800(1,1));
-    scalers.push_back(new Scaler3800(1,2));
-    scalers.push_back(new Scaler3800(1,3));
-    scalers[0]->SetHeader(0xabc00000, 0xffff0000);
-    scalers[1]->SetHeader(0xabc10000, 0xffff0000);
-    scalers[2]->SetHeader(0xabc20000, 0xffff0000);
-    scalers[3]->SetHeader(0xabc30000, 0xffff0000);
+    AddScaler(new Scaler1151(1,0), 0xabc00000, 0xffff0000);
+    AddScaler(new Scaler3800(1,1), 0xabc10000, 0xffff0000);
+    AddScaler(new Scaler3800(1,2), 0xabc20000, 0xffff0000);
+    AddScaler(new Scaler3800(1,3), 0xabc30000, 0xffff0000);
     scalers[0]->LoadNormScaler(scalers[1]);
     scalers[1]->SetClock(4, 7, 1024);
     scalers[2]->LoadNormScaler(scalers[1]);
     scalers[3]->LoadNormScaler(scalers[1]);
   } else {
-    scalers.push_back(new Scaler3800(2,0));
-    scalers.push_back(new Scaler3800(2,0));
-    scalers.push_back(new Scaler1151(2,1));
-    scalers.push_back(new Scaler1151(2,2));
-    scalers[0]->SetHeader(0xceb00000, 0xffff0000);
-    scalers[1]->SetHeader(0xceb10000, 0xffff0000);
-    scalers[2]->SetHeader(0xceb20000, 0xffff0000);
-    scalers[3]->SetHeader(0xceb30000, 0xffff0000);
+    AddScaler(new Scaler3800(2,0), 0xceb00000, 0xffff0000);
+    AddScaler(new Scaler3800(2,0), 0xceb10000, 0xffff0000);
+    AddScaler(new Scaler1151(2,1), 0xceb20000, 0xffff0000);
+    AddScaler(new Scaler1151(2,2), 0xceb30000, 0xffff0000);
     scalers[0]->SetClock(4, 7, 1024);
     scalers[1]->LoadNormScaler(scalers[0]);
     scalers[2]->LoadNormScaler(scalers[0]);
     scalers[3]->LoadNormScaler(scalers[0]);
   }
+  BuildHeaderIndex();
 #endif
 
   if(fDebugFile) *fDebugFile << "THcScalerEvtHandler:: Name of scaler bank "<<fName<<endl;
@@ -402,6 +465,78 @@ void THcScalerEvtHandler::AddVars(TString name, TString desc, Int_t iscal,
   scalerloc.push_back(loc);
 }
 
+void THcScalerEvtHandler::AddScaler(GenScaler* scaler, UInt_t header, UInt_t mask)
+{
+  // Add a scaler module, identified in the data by its header word
+  scaler->SetHeader(header, mask);
+  scalers.push_back(scaler);
+  fHeader.push_back(header);
+  fHeaderMask.push_back(mask);
+}
+
+void THcScalerEvtHandler::BuildHeaderIndex()
+{
+  // Index the scalers by header, one sorted table per distinct header
+  // mask.  A data word is the header of scaler i if
+  // (word & fHeaderMask[i]) == fHeader[i], as in GenScaler::IsSlot.
+  fHeaderIndex.clear();
+  for (size_t i = 0; i < scalers.size(); i++) {
+    size_t k = 0;
+    while (k < fHeaderIndex.size() && fHeaderIndex[k].mask != fHeaderMask[i]) k++;
+    if (k == fHeaderIndex.size()) {
+      fHeaderIndex.push_back(HeaderIndex());
+      fHeaderIndex[k].mask = fHeaderMask[i];
+    }
+    fHeaderIndex[k].headers.push_back(make_pair(fHeader[i] & fHeaderMask[i],
+						static_cast<Int_t>(i)));
+  }
+  for (size_t k = 0; k < fHeaderIndex.size(); k++)
+    sort(fHeaderIndex[k].headers.begin(), fHeaderIndex[k].headers.end());
+  fCandidates.reserve(scalers.size());
+}
+
+void THcScalerEvtHandler::InitHistory()
+{
+  // One history channel for each counting variable, plus the clock
+  fHistory.Clear();
+  fHistScaler.clear();
+  fHistChan.clear();
+  for (size_t i = 0; i < scalerloc.size(); i++) {
+    if (scalerloc[i]->ikind != ICOUNT || scalerloc[i]->iscaler >= scalers.size() ||
+	scalerloc[i]->ichan >= MAXCHAN) continue;
+    fHistory.AddChannel(scalerloc[i]->name.Data());
+    fHistScaler.push_back(scalerloc[i]->iscaler);
+    fHistChan.push_back(scalerloc[i]->ichan);
+  }
+  if (fNormIdx >= 0 && fNormIdx < nscalers && fClockChan >= 0) {
+    Int_t iclock = -1;
+    for (size_t i = 0; i < fHistScaler.size(); i++) {
+      if (fHistScaler[i] == fNormIdx && fHistChan[i] == fClockChan) iclock = i;
+    }
+    if (iclock < 0) {
+      iclock = fHistory.AddChannel((fName + "clock").Data());
+      fHistScaler.push_back(fNormIdx);
+      fHistChan.push_back(fClockChan);
+    }
+    fHistory.SetClock(iclock, fClockFreq);
+  }
+  fHistCounts.resize(fHistScaler.size());
+  fHistSeen.assign(fHistScaler.size(), 0);
+
+  // The ring holds the same channels, with their rates.  Init keeps the
+  // ring if they are unchanged.
+  if (fRingSlots <= 0 || fHistCounts.empty()) {
+    fRing.Disable();
+  } else {
+    vector<string> names;
+    for (Int_t i = 0; i < fHistory.GetNChannels(); i++)
+      names.push_back(fHistory.GetChannelName(i));
+    fHistRates.resize(fHistScaler.size());
+    if (!fRing.Init(fRingSlots, names, fNormIdx, fRingFile.Data()))
+      cout << "THcScalerEvtHandler:: ERROR: cannot set up scaler ring "<<fRingFile<<endl;
+  }
+}
+
 void THcScalerEvtHandler::DefVars()
 {
   // called after AddVars has finished being called.
@@ -411,6 +546,16 @@ void THcScalerEvtHandler::DefVars()
   dvarsFirst = new Double_t[Nvars];  // dvarsFirst is a member of this class
   memset(dvars, 0, Nvars*sizeof(Double_t));
   memset(dvarsFirst, 0, Nvars*sizeof(Double_t));
+  // The scaler baselines are run state, saved by replay checkpoints
+  TString base = Form("%s_scaler_", GetName());
+  base.ToLower();
+  gHcParms->RemoveName(base+"evcount");
+  gHcParms->Define(base+"evcount", "Scaler events read", evcount);
+  gHcParms->AddCheckpointVariable(base+"evcount");
+  gHcParms->RemoveName(base+"first");
+  gHcParms->Define(Form("%sfirst[%d]", base.Data(), Nvars),
+		   "Scaler values of the first scaler event", *dvarsFirst);
+  gHcParms->AddCheckpointVariable(base+"first");
   if (gHaVars) {
     if(fDebugFile) *fDebugFile << "THcScalerEVtHandler:: Have gHaVars "<<gHaVars<<endl;
   } else {
@@ -11,6 +11,8 @@
 /////////////////////////////////////////////////////////////////////
 
 #include "THaEvtTypeHandler.h"
+#include "THcScalerHistory.h"
+#include "THcScalerRing.h"
 #include "Decoder.h"
 #include <string>
 #include <vector>
@@ -37,19 +39,53 @@ public:
    virtual EStatus Init( const TDatime& run_time);
    virtual Int_t End( THaRunBase* r=0 );
 
+   // Save the history of the scaler counts to file at End
+   void SetHistoryFile(const char* file) { fHistoryFile = file; }
+   const THcScalerHistory& GetHistory() const { return fHistory; }
+   // Keep the last nslots readings in a ring for online monitoring,
+   // optionally in a file shared with other processes
+   void SetRing(Int_t nslots, const char* file = 0)
+   { fRingSlots = nslots; fRingFile = file; }
+   const THcScalerRing& GetRing() const { return fRing; }
+
 
 private:
 
    void AddVars(TString name, TString desc, Int_t iscal, Int_t ichan, Int_t ikind);
    void DefVars();
+   void AddScaler(Decoder::GenScaler* scaler, UInt_t header, UInt_t mask);
+   void BuildHeaderIndex();
+   void InitHistory();
    static size_t FindNoCase(const std::string& sdata, const std::string& skey);
 
+   // Scalers whose header matches a data word under a given header mask
+   struct HeaderIndex {
+     UInt_t mask;
+     std::vector< std::pair<UInt_t,Int_t> > headers;  // (header, scaler), sorted
+   };
+
    std::vector<Decoder::GenScaler*> scalers;
    std::vector<HCScalerLoc*> scalerloc;
+   std::vector<UInt_t> fHeader, fHeaderMask;  // Per scaler, from the map file
+   std::vector<HeaderIndex> fHeaderIndex;     // One entry per distinct mask
+   std::vector<Int_t> fCandidates;            // Scalers matching a word
+   std::vector<UInt_t> fPadded;               // Tail of an event, zero-padded
+   std::vector<UChar_t> fDecoded;             // Scalers read in this event
    Double_t evcount;
-   UInt_t *rdata;
    std::vector<Int_t> index;
    Int_t Nvars, ifound, fNormIdx, nscalers;
+   Int_t fClockChan;          // Clock channel of scaler fNormIdx
+   Double_t fClockFreq;
+   THcScalerHistory fHistory;        //! Counts of all scaler reads
+   TString fHistoryFile;
+   std::vector<Int_t> fHistScaler;   // Scaler and channel of each
+   std::vector<Int_t> fHistChan;     // history channel
+   std::vector<UInt_t> fHistCounts;
+   std::vector<UChar_t> fHistSeen;   // Channel read since InitHistory
+   THcScalerRing fRing;              //! Recent reads, for monitoring
+   Int_t fRingSlots;
+   TString fRingFile;
+   std::vector<Double_t> fHistRates;
    Double_t *dvars;
    Double_t *dvarsFirst;
    TTree *fScalerTree;
@@ -0,0 +1,384 @@
+/** \class THcScalerHistory
+    \ingroup Base
+
+ Compact history of the scaler reads of a run.
+
+ For every scaler read, the raw 32-bit counts of all channels are
+ appended as increments since the previous read.  Each increment is
+ stored as a variable-length integer, so slowly counting channels take
+ one byte per read.  Increments are taken modulo 2^32, so counter
+ roll-over is handled.  The event number and time stamp of each read are
+ kept as well.
+
+ Running sums are checkpointed every kCheckpoint reads.  Counts between
+ any two events therefore take at most 2*kCheckpoint decoded reads,
+ however long the run.  Derived quantities:
+ - GetTime: elapsed time, from the clock channel if one is set with
+   SetClock, or else from the time stamps if SetTimeStampFrequency was
+   called
+ - GetRate: counts divided by time
+ - GetCharge: charge from a BCM channel, (counts - offset*time)/gain
+ - GetLiveTime: ratio of accepted to total triggers
+
+ The ranges always extend from one scaler read to another.  An event
+ range is widened to the last reads at or before its two ends.
+
+ THcScalerEvtHandler fills a history for its scaler variables, see
+ THcScalerEvtHandler::SetHistoryFile.  Write and Read save and restore
+ the history, so that analysis code can normalise without the scaler
+ tree:
+ ~~~
+   THcScalerHistory h;
+   h.Read("HMS_scalers_1234.dat");
+   Int_t bcm = h.GetChannel("HMSbcm1");
+   Double_t q = h.GetCharge(bcm, gain, offset, firstev, lastev);
+ ~~~
+
+*/
+
+#include "THcScalerHistory.h"
+#include "TString.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+  // Identifies history files and their layout
+  const char   kHistMagic[4] = { 'H', 'C', 'S', 'H' };
+  const Int_t  kHistVersion  = 1;
+
+  void PutVarint( vector<UChar_t>& buf, UInt_t v )
+  {
+    while( v >= 0x80 ) {
+      buf.push_back( static_cast<UChar_t>(v | 0x80) );
+      v >>= 7;
+    }
+    buf.push_back( static_cast<UChar_t>(v) );
+  }
+  UInt_t GetVarint( const UChar_t*& p )
+  {
+    UInt_t v = 0;
+    for( Int_t shift = 0; ; shift += 7 ) {
+      UChar_t c = *p++;
+      v |= static_cast<UInt_t>(c & 0x7f) << shift;
+      if( !(c & 0x80) ) break;
+    }
+    return v;
+  }
+  // As GetVarint, but fails rather than read at or past pend
+  bool GetVarint( const UChar_t*& p, const UChar_t* pend, UInt_t& v )
+  {
+    v = 0;
+    for( Int_t shift = 0; shift < 35; shift += 7 ) {
+      if( p >= pend ) return false;
+      UChar_t c = *p++;
+      v |= static_cast<UInt_t>(c & 0x7f) << shift;
+      if( !(c & 0x80) ) return true;
+    }
+    return false;
+  }
+
+  template<class T>
+  bool PutVector( FILE* fp, const vector<T>& v )
+  {
+    UInt_t n = v.size();
+    return fwrite(&n, sizeof(n), 1, fp) == 1 &&
+      (n == 0 || fwrite(&v[0], sizeof(T), n, fp) == n);
+  }
+  template<class T>
+  bool GetVector( FILE* fp, vector<T>& v )
+  {
+    UInt_t n;
+    if( fread(&n, sizeof(n), 1, fp) != 1 ) return false;
+    v.resize(n);
+    return n == 0 || fread(&v[0], sizeof(T), n, fp) == n;
+  }
+}
+
+//_____________________________________________________________________________
+THcScalerHistory::THcScalerHistory() : fClockChan(-1), fClockFreq(0),
+  fTimeStampFreq(0)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+Int_t THcScalerHistory::AddChannel( const char* name )
+{
+  // Add a channel.  Returns its index, or -1 if reads have already been
+  // recorded.
+
+  if( !fEvNum.empty() ) return -1;
+  fNames.push_back(name);
+  return fNames.size()-1;
+}
+
+//_____________________________________________________________________________
+void THcScalerHistory::SetClock( Int_t ichan, Double_t freq )
+{
+  // Channel ichan counts a clock of frequency freq (Hz)
+
+  fClockChan = ichan;
+  fClockFreq = freq;
+}
+
+//_____________________________________________________________________________
+void THcScalerHistory::Clear()
+{
+  // Remove all channels and reads
+
+  fNames.clear();
+  fClockChan = -1;
+  fClockFreq = 0;
+  fEvNum.clear();
+  fTime.clear();
+  fFirst.clear();
+  fLast.clear();
+  fSum.clear();
+  fData.clear();
+  fCheckSum.clear();
+  fCheckPos.clear();
+}
+
+//_____________________________________________________________________________
+Int_t THcScalerHistory::GetChannel( const char* name ) const
+{
+  // Index of channel name, or -1 if there is no such channel
+
+  for( UInt_t i = 0; i < fNames.size(); i++ ) {
+    if( fNames[i] == name ) return i;
+  }
+  return -1;
+}
+
+//_____________________________________________________________________________
+void THcScalerHistory::Append( Long64_t evnum, ULong64_t timestamp,
+			       const UInt_t* counts )
+{
+  // Record a scaler read
+
+  UInt_t nchan = fNames.size();
+  if( fEvNum.empty() ) {
+    fFirst.assign(counts, counts+nchan);
+    fLast = fFirst;
+    fSum.assign(nchan, 0);
+  } else {
+    for( UInt_t i = 0; i < nchan; i++ ) {
+      UInt_t delta = counts[i] - fLast[i];   // Modulo 2^32
+      PutVarint(fData, delta);
+      fSum[i] += delta;
+      fLast[i] = counts[i];
+    }
+  }
+  fEvNum.push_back(evnum);
+  fTime.push_back(timestamp);
+  if( (fEvNum.size()-1) % kCheckpoint == 0 )
+    Checkpoint();
+}
+
+//_____________________________________________________________________________
+void THcScalerHistory::Checkpoint()
+{
+  // Save the running sums after the last read
+
+  fCheckSum.insert(fCheckSum.end(), fSum.begin(), fSum.end());
+  fCheckPos.push_back(fData.size());
+}
+
+//_____________________________________________________________________________
+Int_t THcScalerHistory::FindRead( Long64_t evnum ) const
+{
+  // Index of the last read at or before event evnum.  The first read if
+  // evnum precedes all reads, -1 if there are none.
+
+  if( fEvNum.empty() ) return -1;
+  Int_t i = upper_bound(fEvNum.begin(), fEvNum.end(), evnum) - fEvNum.begin();
+  return (i > 0) ? i-1 : 0;
+}
+
+//_____________________________________________________________________________
+void THcScalerHistory::GetCumulative( Int_t iread, vector<Long64_t>& sums ) const
+{
+  // Counts of all channels from the first read to read iread
+
+  UInt_t nchan = fNames.size();
+  sums.assign(nchan, 0);
+  if( iread < 0 || iread >= GetNReads() ) return;
+  Int_t icheck = iread/kCheckpoint;
+  copy(fCheckSum.begin()+icheck*nchan, fCheckSum.begin()+(icheck+1)*nchan,
+       sums.begin());
+  const UChar_t* p = fData.empty() ? 0 : &fData[0] + fCheckPos[icheck];
+  for( Int_t r = icheck*kCheckpoint; r < iread; r++ ) {
+    for( UInt_t i = 0; i < nchan; i++ )
+      sums[i] += GetVarint(p);
+  }
+}
+
+//_____________________________________________________________________________
+Long64_t THcScalerHistory::Cumulative( Int_t ichan, Int_t iread ) const
+{
+  // Counts of channel ichan from the first read to read iread
+
+  UInt_t nchan = fNames.size();
+  if( ichan < 0 || ichan >= (Int_t)nchan || iread < 0 ) return 0;
+  Int_t icheck = iread/kCheckpoint;
+  Long64_t sum = fCheckSum[icheck*nchan+ichan];
+  const UChar_t* p = fData.empty() ? 0 : &fData[0] + fCheckPos[icheck];
+  for( Int_t r = icheck*kCheckpoint; r < iread; r++ ) {
+    for( UInt_t i = 0; i < nchan; i++ ) {
+      UInt_t delta = GetVarint(p);
+      if( (Int_t)i == ichan ) sum += delta;
+    }
+  }
+  return sum;
+}
+
+//_____________________________________________________________________________
+Long64_t THcScalerHistory::GetCounts( Int_t ichan, Long64_t ev1,
+				      Long64_t ev2 ) const
+{
+  // Counts of channel ichan between the reads at events ev1 and ev2
+
+  return Cumulative(ichan, FindRead(ev2)) - Cumulative(ichan, FindRead(ev1));
+}
+
+//_____________________________________________________________________________
+Double_t THcScalerHistory::GetTime( Long64_t ev1, Long64_t ev2 ) const
+{
+  // Time (s) between the reads at events ev1 and ev2.  Zero if there is
+  // neither a clock channel nor a time stamp frequency.
+
+  if( fClockChan >= 0 && fClockFreq > 0 )
+    return GetCounts(fClockChan, ev1, ev2)/fClockFreq;
+  Int_t i1 = FindRead(ev1), i2 = FindRead(ev2);
+  if( fTimeStampFreq > 0 && i1 >= 0 )
+    return (static_cast<Double_t>(fTime[i2]) -
+	    static_cast<Double_t>(fTime[i1]))/fTimeStampFreq;
+  return 0;
+}
+
+//_____________________________________________________________________________
+Double_t THcScalerHistory::GetRate( Int_t ichan, Long64_t ev1,
+				    Long64_t ev2 ) const
+{
+  // Average rate (Hz) of channel ichan between events ev1 and ev2
+
+  Double_t time = GetTime(ev1, ev2);
+  return (time != 0) ? GetCounts(ichan, ev1, ev2)/time : 0;
+}
+
+//_____________________________________________________________________________
+Double_t THcScalerHistory::GetCharge( Int_t ichan, Double_t gain,
+				      Double_t offset, Long64_t ev1,
+				      Long64_t ev2 ) const
+{
+  // Charge between events ev1 and ev2 from BCM channel ichan, whose rate
+  // is offset + gain*current
+
+  if( gain == 0 ) return 0;
+  return (GetCounts(ichan, ev1, ev2) - offset*GetTime(ev1, ev2))/gain;
+}
+
+//_____________________________________________________________________________
+Double_t THcScalerHistory::GetLiveTime( Int_t iaccepted, Int_t itriggers,
+					Long64_t ev1, Long64_t ev2 ) const
+{
+  // Fraction of the triggers counted in channel itriggers that were
+  // accepted (channel iaccepted) between events ev1 and ev2
+
+  Long64_t ntrig = GetCounts(itriggers, ev1, ev2);
+  return (ntrig != 0) ?
+    static_cast<Double_t>(GetCounts(iaccepted, ev1, ev2))/ntrig : 0;
+}
+
+//_____________________________________________________________________________
+Bool_t THcScalerHistory::Write( const char* file ) const
+{
+  // Save the history to file.  The byte order is the native one.
+  // The file is written under a temporary name and renamed when complete,
+  // so a reader never sees a partly written history.
+
+  TString tmpfile = Form("%s.tmp%d", file, static_cast<Int_t>(getpid()));
+  FILE* fp = fopen(tmpfile.Data(), "wb");
+  if( !fp ) return kFALSE;
+  bool ok = fwrite(kHistMagic, sizeof(kHistMagic), 1, fp) == 1 &&
+    fwrite(&kHistVersion, sizeof(kHistVersion), 1, fp) == 1;
+  UInt_t nchan = fNames.size();
+  ok = ok && fwrite(&nchan, sizeof(nchan), 1, fp) == 1;
+  for( UInt_t i = 0; ok && i < nchan; i++ ) {
+    UInt_t len = fNames[i].length();
+    ok = fwrite(&len, sizeof(len), 1, fp) == 1 &&
+      fwrite(fNames[i].data(), 1, len, fp) == len;
+  }
+  ok = ok && fwrite(&fClockChan, sizeof(fClockChan), 1, fp) == 1 &&
+    fwrite(&fClockFreq, sizeof(fClockFreq), 1, fp) == 1 &&
+    fwrite(&fTimeStampFreq, sizeof(fTimeStampFreq), 1, fp) == 1 &&
+    PutVector(fp, fEvNum) && PutVector(fp, fTime) && PutVector(fp, fFirst) &&
+    PutVector(fp, fData);
+  if( fclose(fp) != 0 ) ok = false;
+  if( ok && rename(tmpfile.Data(), file) != 0 ) ok = false;
+  if( !ok ) remove(tmpfile.Data());
+  return ok;
+}
+
+//_____________________________________________________________________________
+Bool_t THcScalerHistory::Read( const char* file )
+{
+  // Replace the history by the one saved in file
+
+  FILE* fp = fopen(file, "rb");
+  if( !fp ) return kFALSE;
+  Clear();
+  char magic[sizeof(kHistMagic)];
+  Int_t version = 0;
+  UInt_t nchan = 0;
+  bool ok = fread(magic, sizeof(magic), 1, fp) == 1 &&
+    memcmp(magic, kHistMagic, sizeof(magic)) == 0 &&
+    fread(&version, sizeof(version), 1, fp) == 1 &&
+    version == kHistVersion && fread(&nchan, sizeof(nchan), 1, fp) == 1;
+  for( UInt_t i = 0; ok && i < nchan; i++ ) {
+    UInt_t len;
+    ok = fread(&len, sizeof(len), 1, fp) == 1;
+    string name(ok ? len : 0, ' ');
+    ok = ok && (len == 0 || fread(&name[0], 1, len, fp) == len);
+    fNames.push_back(name);
+  }
+  ok = ok && fread(&fClockChan, sizeof(fClockChan), 1, fp) == 1 &&
+    fread(&fClockFreq, sizeof(fClockFreq), 1, fp) == 1 &&
+    fread(&fTimeStampFreq, sizeof(fTimeStampFreq), 1, fp) == 1 &&
+    GetVector(fp, fEvNum) && GetVector(fp, fTime) && GetVector(fp, fFirst) &&
+    GetVector(fp, fData) && fTime.size() == fEvNum.size() &&
+    fFirst.size() == (fEvNum.empty() ? 0 : nchan);
+  fclose(fp);
+
+  // Rebuild the running sums and checkpoints
+  if( ok ) {
+    fLast = fFirst;
+    fSum.assign(nchan, 0);
+    const UChar_t* p = fData.empty() ? 0 : &fData[0];
+    const UChar_t* pend = p + fData.size();
+    for( UInt_t r = 0; r < fEvNum.size(); r++ ) {
+      if( r > 0 ) {
+	for( UInt_t i = 0; i < nchan; i++ ) {
+	  UInt_t delta;
+	  if( !GetVarint(p, pend, delta) ) { ok = false; break; }
+	  fSum[i] += delta;
+	  fLast[i] += delta;
+	}
+	if( !ok ) break;
+      }
+      if( r % kCheckpoint == 0 ) {
+	fCheckSum.insert(fCheckSum.end(), fSum.begin(), fSum.end());
+	fCheckPos.push_back(p ? p - &fData[0] : 0);
+      }
+    }
+    // The increments must account for exactly the reads in the header
+    if( p != pend ) ok = false;
+  }
+  if( !ok ) Clear();
+  return ok;
+}
@@ -0,0 +1,81 @@
+#ifndef ROOT_THcScalerHistory
+#define ROOT_THcScalerHistory
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcScalerHistory
+//
+// Append-only record of the scaler counts of a run, one entry per scaler
+// read, with queries for counts, rates, charge and live time between
+// arbitrary events.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+
+class THcScalerHistory {
+
+public:
+  THcScalerHistory();
+
+  // Setup.  Channels must be added before the first Append.
+  Int_t  AddChannel( const char* name );
+  void   SetClock( Int_t ichan, Double_t freq );
+  void   SetTimeStampFrequency( Double_t freq ) { fTimeStampFreq = freq; }
+  void   Clear();
+
+  // Record a scaler read: the raw counts of all channels, in the order
+  // they were added, at event evnum with event time timestamp
+  void   Append( Long64_t evnum, ULong64_t timestamp, const UInt_t* counts );
+
+  Int_t  GetNChannels() const { return fNames.size(); }
+  Int_t  GetNReads() const { return fEvNum.size(); }
+  Int_t  GetChannel( const char* name ) const;
+  const char* GetChannelName( Int_t ichan ) const { return fNames[ichan].c_str(); }
+  Long64_t  GetEvNum( Int_t iread ) const { return fEvNum[iread]; }
+  ULong64_t GetTimeStamp( Int_t iread ) const { return fTime[iread]; }
+
+  // Quantities accumulated between the last scaler reads at or before
+  // events ev1 and ev2
+  Long64_t GetCounts( Int_t ichan, Long64_t ev1, Long64_t ev2 ) const;
+  Double_t GetTime( Long64_t ev1, Long64_t ev2 ) const;
+  Double_t GetRate( Int_t ichan, Long64_t ev1, Long64_t ev2 ) const;
+  Double_t GetCharge( Int_t ichan, Double_t gain, Double_t offset,
+		      Long64_t ev1, Long64_t ev2 ) const;
+  Double_t GetLiveTime( Int_t iaccepted, Int_t itriggers,
+			Long64_t ev1, Long64_t ev2 ) const;
+
+  // Cumulative counts of all channels since the first read, at read iread
+  void     GetCumulative( Int_t iread, std::vector<Long64_t>& sums ) const;
+
+  Bool_t   Write( const char* file ) const;
+  Bool_t   Read( const char* file );
+
+protected:
+
+  // Cumulative sums are kept every kCheckpoint reads, so that a query
+  // decodes at most kCheckpoint-1 reads per end of the range
+  static const Int_t kCheckpoint = 64;
+
+  std::vector<std::string> fNames;   // Channel names
+  Int_t     fClockChan;              // Channel counting a clock, or -1
+  Double_t  fClockFreq;              // Its frequency (Hz)
+  Double_t  fTimeStampFreq;          // Time stamp ticks per second, or 0
+
+  std::vector<Long64_t>  fEvNum;     // Event number of each read
+  std::vector<ULong64_t> fTime;      // Time stamp of each read
+  std::vector<UInt_t>    fFirst;     // Raw counts at the first read
+  std::vector<UInt_t>    fLast;      // Raw counts at the last read
+  std::vector<Long64_t>  fSum;       // Counts since the first read
+  std::vector<UChar_t>   fData;      // Varint encoded increments, per read
+  std::vector<Long64_t>  fCheckSum;  // fSum at every kCheckpoint-th read
+  std::vector<UInt_t>    fCheckPos;  // Position in fData after that read
+
+  Int_t  FindRead( Long64_t evnum ) const;
+  Long64_t Cumulative( Int_t ichan, Int_t iread ) const;
+  void   Checkpoint();
+};
+
+#endif
@@ -0,0 +1,393 @@
+/** \class THcScalerRing
+    \ingroup Base
+
+ Lock-free ring buffer of recent scaler readings, for online monitoring.
+
+ THcScalerEvtHandler pushes every scaler reading (raw counts and rates
+ of its counting variables) into the ring.  A monitoring thread can call
+ Snapshot at any time to copy the latest readings.  The writer never
+ waits.  Each slot carries a sequence number that the writer makes odd
+ before changing the slot and sets to 2*(index+1) when done.  A reader
+ keeps a copy only if it saw the same, complete sequence number before
+ and after copying.  Readings that were overwritten while being copied
+ are dropped from the snapshot rather than waiting for the writer.
+
+ With a file name given to Init (e.g. a file in /dev/shm), the ring lives
+ in a shared mapping of that file.  A monitor in another process then
+ reads it with:
+ ~~~
+   THcScalerRing ring;
+   ring.Attach("/dev/shm/hms_scalers");
+   vector<THcScalerRing::Reading> r;
+   if( ring.Snapshot(r, 1) )
+     cout << ring.GetChannelName(0) << " " << r[0].rates[0] << endl;
+ ~~~
+ The header records the index of the scaler used for normalisation
+ (THcScalerEvtHandler's fNormIdx).
+
+ Calling Init again with the same slots, channels and file keeps the
+ ring, so readers are not disturbed when the handler is initialised for
+ every run.  If the layout changes, a new ring is set up.  A new ring
+ file is written under a temporary name and renamed into place, so
+ readers of the old file keep a valid mapping; IsCurrent tells them to
+ Attach again.  The memory of a replaced ring is released only by Close,
+ since a Snapshot may still be reading it.  For the same reason, a ring
+ that is no longer wanted is given up with Disable, not Close.
+
+*/
+
+#include "THcScalerRing.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+  const char  kRingMagic[4] = { 'H', 'C', 'S', 'R' };
+  const Int_t kRingVersion  = 1;
+
+  // Sequence number access.  The GCC atomic builtins give the ordering
+  // of a sequence lock without requiring C++11.
+  inline ULong64_t LoadAcquire( const ULong64_t* p )
+  {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+  }
+  inline ULong64_t LoadRelaxed( const ULong64_t* p )
+  {
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+  }
+  inline void StoreRelease( ULong64_t* p, ULong64_t v )
+  {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+  }
+  inline void StoreRelaxed( ULong64_t* p, ULong64_t v )
+  {
+    __atomic_store_n(p, v, __ATOMIC_RELAXED);
+  }
+}
+
+//_____________________________________________________________________________
+THcScalerRing::THcScalerRing() :
+  fMem(0), fSize(0), fMapped(kFALSE), fInode(0)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+THcScalerRing::~THcScalerRing()
+{
+  // Destructor
+
+  Close();
+}
+
+//_____________________________________________________________________________
+size_t THcScalerRing::SlotSize( Int_t nchan )
+{
+  // Bytes per slot, a multiple of 8
+
+  size_t size = 3*sizeof(ULong64_t) + nchan*(sizeof(Double_t)+sizeof(UInt_t));
+  return (size+7) & ~static_cast<size_t>(7);
+}
+
+//_____________________________________________________________________________
+char* THcScalerRing::GetSlot( char* mem, ULong64_t index )
+{
+  // Slot of ring memory mem holding reading index
+
+  const Header* hdr = reinterpret_cast<const Header*>(mem);
+  return mem + sizeof(Header) + hdr->nchan*kNameLen +
+    (index % hdr->nslots)*hdr->slotsize;
+}
+
+//_____________________________________________________________________________
+Bool_t THcScalerRing::SameLayout( Int_t nslots, const vector<string>& names,
+				  Int_t normidx ) const
+{
+  // True if the ring is set up for these slots and channels
+
+  if( !fMem ) return kFALSE;
+  const Header* hdr = GetHeader();
+  if( hdr->nslots != nslots || hdr->nchan != (Int_t)names.size() ||
+      hdr->normidx != normidx )
+    return kFALSE;
+  const char* name = fMem + sizeof(Header);
+  for( UInt_t i = 0; i < names.size(); i++, name += kNameLen ) {
+    if( strncmp(name, names[i].c_str(), kNameLen-1) != 0 )
+      return kFALSE;
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcScalerRing::Release( const Region& region )
+{
+  // Unmap or free the memory of a ring
+
+  if( region.mapped )
+    munmap(region.mem, region.size);
+  else
+    free(region.mem);
+}
+
+//_____________________________________________________________________________
+Bool_t THcScalerRing::Init( Int_t nslots, const vector<string>& names,
+			    Int_t normidx, const char* file )
+{
+  // Set up the ring for writing.  Returns kFALSE if the memory or the
+  // shared file cannot be set up.
+
+  if( nslots <= 0 ) {
+    Disable();
+    return kFALSE;
+  }
+  string fname = file ? file : "";
+  if( fname == fFile && SameLayout(nslots, names, normidx) )
+    return kTRUE;
+
+  Int_t nchan = names.size();
+  size_t size = sizeof(Header) + nchan*kNameLen + nslots*SlotSize(nchan);
+  char* mem = 0;
+  ULong64_t inode = 0;
+  char tmpfile[FILENAME_MAX];
+  if( !fname.empty() ) {
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp%d", fname.c_str(),
+	     static_cast<Int_t>(getpid()));
+    int fd = open(tmpfile, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if( fd < 0 ) return kFALSE;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if( ftruncate(fd, size) == 0 && fstat(fd, &st) == 0 ) {
+      inode = st.st_ino;
+      map = mmap(0, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if( map == MAP_FAILED ) {
+      unlink(tmpfile);
+      return kFALSE;
+    }
+    mem = static_cast<char*>(map);
+  } else {
+    mem = static_cast<char*>(calloc(size, 1));
+    if( !mem ) return kFALSE;
+  }
+  memset(mem, 0, size);
+
+  Header* hdr = reinterpret_cast<Header*>(mem);
+  hdr->version = kRingVersion;
+  hdr->nslots = nslots;
+  hdr->nchan = nchan;
+  hdr->normidx = normidx;
+  hdr->slotsize = SlotSize(nchan);
+  hdr->head = 0;
+  char* name = mem + sizeof(Header);
+  for( Int_t i = 0; i < nchan; i++, name += kNameLen )
+    strncpy(name, names[i].c_str(), kNameLen-1);
+  // The magic number marks the ring as ready for readers
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(hdr->magic, kRingMagic, sizeof(kRingMagic));
+
+  if( !fname.empty() && rename(tmpfile, fname.c_str()) != 0 ) {
+    munmap(mem, size);
+    unlink(tmpfile);
+    return kFALSE;
+  }
+
+  Retire();
+  fSize = size;
+  fMapped = !fname.empty();
+  fFile = fname;
+  fInode = inode;
+  __atomic_store_n(&fMem, mem, __ATOMIC_RELEASE);
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcScalerRing::Retire()
+{
+  // Keep the current ring until Close, for Snapshots still reading it
+
+  if( fMem ) {
+    Region old = { fMem, fSize, fMapped };
+    fRetired.push_back(old);
+  }
+}
+
+//_____________________________________________________________________________
+void THcScalerRing::Disable()
+{
+  // Stop writing to the ring.  Unlike Close, this is safe while other
+  // threads take Snapshots.
+
+  Retire();
+  fSize = 0;
+  fMapped = kFALSE;
+  fFile.clear();
+  fInode = 0;
+  __atomic_store_n(&fMem, (char*)0, __ATOMIC_RELEASE);
+}
+
+//_____________________________________________________________________________
+Bool_t THcScalerRing::Attach( const char* file )
+{
+  // Map the ring written by another process to file, read-only
+
+  Close();
+  int fd = open(file, O_RDONLY);
+  if( fd < 0 ) return kFALSE;
+  struct stat st;
+  if( fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header) ) {
+    close(fd);
+    return kFALSE;
+  }
+  void* mem = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if( mem == MAP_FAILED ) return kFALSE;
+  fMem = static_cast<char*>(mem);
+  fSize = st.st_size;
+  fMapped = kTRUE;
+  fFile = file;
+  fInode = st.st_ino;
+
+  const Header* hdr = GetHeader();
+  if( memcmp(hdr->magic, kRingMagic, sizeof(kRingMagic)) != 0 ||
+      hdr->version != kRingVersion || hdr->nslots <= 0 || hdr->nchan < 0 ||
+      fSize < sizeof(Header) + hdr->nchan*kNameLen +
+      (size_t)hdr->nslots*hdr->slotsize ) {
+    Close();
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+Bool_t THcScalerRing::IsCurrent() const
+{
+  // True if the ring file is still the one mapped.  Always true for a
+  // ring that is not in a file.
+
+  if( fFile.empty() ) return kTRUE;
+  struct stat st;
+  return stat(fFile.c_str(), &st) == 0 &&
+    static_cast<ULong64_t>(st.st_ino) == fInode;
+}
+
+//_____________________________________________________________________________
+void THcScalerRing::Close()
+{
+  // Release the ring memory, including that of replaced rings
+
+  for( UInt_t i = 0; i < fRetired.size(); i++ )
+    Release(fRetired[i]);
+  fRetired.clear();
+  if( fMem ) {
+    Region region = { fMem, fSize, fMapped };
+    Release(region);
+  }
+  fMem = 0;
+  fSize = 0;
+  fMapped = kFALSE;
+  fFile.clear();
+  fInode = 0;
+}
+
+//_____________________________________________________________________________
+void THcScalerRing::Push( Long64_t evnum, ULong64_t timestamp,
+			  const UInt_t* counts, const Double_t* rates )
+{
+  // Add a reading, overwriting the oldest one if the ring is full
+
+  if( !fMem ) return;
+  Header* hdr = GetHeader();
+  ULong64_t index = hdr->head;
+  char* slot = GetSlot(fMem, index);
+  ULong64_t* seq = reinterpret_cast<ULong64_t*>(slot);
+  Int_t nchan = hdr->nchan;
+
+  StoreRelaxed(seq, 2*index+1);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  char* p = slot + sizeof(ULong64_t);
+  memcpy(p, &evnum, sizeof(evnum));          p += sizeof(ULong64_t);
+  memcpy(p, &timestamp, sizeof(timestamp));  p += sizeof(ULong64_t);
+  memcpy(p, rates, nchan*sizeof(Double_t));  p += nchan*sizeof(Double_t);
+  memcpy(p, counts, nchan*sizeof(UInt_t));
+  StoreRelease(seq, 2*index+2);
+  StoreRelease(&hdr->head, index+1);
+}
+
+//_____________________________________________________________________________
+Int_t THcScalerRing::Snapshot( vector<Reading>& readings, Int_t n ) const
+{
+  // Copy up to the n most recent readings
+
+  readings.clear();
+  // The same ring throughout, even if the writer replaces it meanwhile
+  char* mem = __atomic_load_n(&fMem, __ATOMIC_ACQUIRE);
+  if( !mem || n <= 0 ) return 0;
+  const Header* hdr = reinterpret_cast<const Header*>(mem);
+  Int_t nchan = hdr->nchan;
+  ULong64_t head = LoadAcquire(&hdr->head);
+  if( n > hdr->nslots ) n = hdr->nslots;
+  ULong64_t first = (head > (ULong64_t)n) ? head-n : 0;
+
+  Reading r;
+  r.counts.resize(nchan);
+  r.rates.resize(nchan);
+  for( ULong64_t index = first; index < head; index++ ) {
+    const char* slot = GetSlot(mem, index);
+    const ULong64_t* seq = reinterpret_cast<const ULong64_t*>(slot);
+    ULong64_t s1 = LoadAcquire(seq);
+    if( s1 != 2*index+2 ) continue;         // Being overwritten
+    const char* p = slot + sizeof(ULong64_t);
+    memcpy(&r.evnum, p, sizeof(r.evnum));          p += sizeof(ULong64_t);
+    memcpy(&r.timestamp, p, sizeof(r.timestamp));  p += sizeof(ULong64_t);
+    if( nchan > 0 ) {
+      memcpy(&r.rates[0], p, nchan*sizeof(Double_t));
+      p += nchan*sizeof(Double_t);
+      memcpy(&r.counts[0], p, nchan*sizeof(UInt_t));
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if( LoadRelaxed(seq) != s1 ) continue;   // Changed while copying
+    r.index = index;
+    readings.push_back(r);
+  }
+  return readings.size();
+}
+
+//_____________________________________________________________________________
+Int_t THcScalerRing::GetNSlots() const
+{
+  return fMem ? GetHeader()->nslots : 0;
+}
+
+//_____________________________________________________________________________
+Int_t THcScalerRing::GetNChannels() const
+{
+  return fMem ? GetHeader()->nchan : 0;
+}
+
+//_____________________________________________________________________________
+Int_t THcScalerRing::GetNormIdx() const
+{
+  return fMem ? GetHeader()->normidx : -1;
+}
+
+//_____________________________________________________________________________
+ULong64_t THcScalerRing::GetNPushed() const
+{
+  return fMem ? LoadAcquire(&GetHeader()->head) : 0;
+}
+
+//_____________________________________________________________________________
+const char* THcScalerRing::GetChannelName( Int_t ichan ) const
+{
+  if( !fMem || ichan < 0 || ichan >= GetHeader()->nchan ) return 0;
+  return fMem + sizeof(Header) + ichan*kNameLen;
+}
@@ -0,0 +1,109 @@
+#ifndef ROOT_THcScalerRing
+#define ROOT_THcScalerRing
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcScalerRing
+//
+// Fixed-capacity ring of the most recent scaler readings.  Written by
+// the event loop, read by monitoring code without locks, in the same
+// process or, through a shared file mapping, in another one.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <string>
+#include <vector>
+
+class THcScalerRing {
+
+public:
+  // One scaler reading
+  struct Reading {
+    ULong64_t index;               // Number of readings before this one
+    Long64_t  evnum;
+    ULong64_t timestamp;
+    std::vector<UInt_t>   counts;  // Raw counts per channel
+    std::vector<Double_t> rates;   // Rates (Hz) per channel
+  };
+
+  THcScalerRing();
+  ~THcScalerRing();
+
+  // Writer: set up a ring of nslots readings of the given channels.  If
+  // file is given, the ring is placed in a shared mapping of that file,
+  // e.g. under /dev/shm, for readers in other processes.  A ring already
+  // set up with the same layout is kept.
+  Bool_t Init( Int_t nslots, const std::vector<std::string>& names,
+	       Int_t normidx, const char* file = 0 );
+  // Writer: stop using the ring.  Its memory is kept until Close, for
+  // Snapshots still reading it.
+  void   Disable();
+  // Reader in another process: map the ring written to file
+  Bool_t Attach( const char* file );
+  // Reader: kFALSE once the writer has replaced the ring file by a new
+  // one, which then needs to be attached again
+  Bool_t IsCurrent() const;
+  void   Close();
+
+  // Writer only.  Never waits for readers.
+  void   Push( Long64_t evnum, ULong64_t timestamp, const UInt_t* counts,
+	       const Double_t* rates );
+
+  // Copy up to n of the most recent readings, oldest first.  Readings
+  // being overwritten while copied are left out.  Never blocks the
+  // writer.  Returns the number of readings copied.
+  Int_t  Snapshot( std::vector<Reading>& readings, Int_t n = 1 ) const;
+
+  Bool_t    IsReady() const { return fMem != 0; }
+  Int_t     GetNSlots() const;
+  Int_t     GetNChannels() const;
+  Int_t     GetNormIdx() const;
+  ULong64_t GetNPushed() const;
+  const char* GetChannelName( Int_t ichan ) const;
+
+protected:
+
+  // Layout of the ring memory: Header, channel names, slots
+  struct Header {
+    char      magic[4];
+    Int_t     version;
+    Int_t     nslots;
+    Int_t     nchan;
+    Int_t     normidx;      // Scaler used for normalisation, or -1
+    Int_t     slotsize;     // Bytes per slot
+    ULong64_t head;         // Readings pushed so far
+  };
+  // Each slot: sequence number, event number, time stamp, nchan rates,
+  // nchan counts.  The sequence number is odd while the slot is written
+  // and 2*(index+1) once reading index is complete.
+  static const Int_t kNameLen = 32;
+
+  // Memory of a ring
+  struct Region {
+    char*   mem;
+    size_t  size;
+    Bool_t  mapped;         // mem is a file mapping
+  };
+
+  char*   fMem;
+  size_t  fSize;
+  Bool_t  fMapped;          // fMem is a file mapping
+  std::string fFile;        // File of a shared ring
+  ULong64_t   fInode;       // Inode of fFile when mapped
+  std::vector<Region> fRetired;  // Replaced rings, released by Close
+
+  Header*       GetHeader() const { return reinterpret_cast<Header*>(fMem); }
+  Bool_t        SameLayout( Int_t nslots, const std::vector<std::string>& names,
+			    Int_t normidx ) const;
+  static char*  GetSlot( char* mem, ULong64_t index );
+  static size_t SlotSize( Int_t nchan );
+  static void   Release( const Region& region );
+  void          Retire();
+
+private:
+  THcScalerRing( const THcScalerRing& );
+  THcScalerRing& operator=( const THcScalerRing& );
+};
+
+#endif
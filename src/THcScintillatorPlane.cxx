@@ -771,7 +771,10 @@ void THcScintillatorPlane::CalculatePedestals( )
   *
   * - Calculate pedestals from arrays made in THcScintillatorPlane::AccumulatePedestals
   * - In old fortran ENGINE code, a comparison was made between calculated pedestals and the pedestals read in by the FASTBUS modules for zero supression. This is not implemented.
+  * - Without pedestal events, the pedestals are left as they are
   */
+  if(fNPedestalEvents == 0) return;	// Keep the pedestals of the parameters
+
   for(UInt_t i=0; i<fNelem;i++) {
 
     // Positive tubes
@@ -821,6 +824,23 @@ void THcScintillatorPlane::InitializePedestals( )
     fNegPedLimit[i] = 1000;	// In engine, this are set in parameter file
     fNegPedCount[i] = 0;
   }
+
+  // Pedestal sums are run accumulators, saved by replay checkpoints
+  TString base = Form("%cscin_%s_", tolower(GetParent()->GetPrefix()[0]), GetName());
+  gHcParms->DefineAccumulator(base+"ped_events", "Pedestal events",
+			      &fNPedestalEvents, 1);
+  gHcParms->DefineAccumulator(base+"pos_ped_sum", "Pos pedestal sums",
+			      fPosPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"pos_ped_sum2", "Pos pedestal sums of squares",
+			      fPosPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"pos_ped_count", "Pos pedestal counts",
+			      fPosPedCount, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_sum", "Neg pedestal sums",
+			      fNegPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_sum2", "Neg pedestal sums of squares",
+			      fNegPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_count", "Neg pedestal counts",
+			      fNegPedCount, fNelem);
 }
 //____________________________________________________________________________
 ClassImp(THcScintillatorPlane)
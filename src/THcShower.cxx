@@ -24,7 +24,6 @@ Shower counter class, describing a generic segmented shower detector.     //
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
-#include <numeric>
 
 using namespace std;
 
@@ -128,6 +127,18 @@ void THcShower::Setup(const char* name, const char* description)
 //_____________________________________________________________________________
 THaAnalysisObject::EStatus THcShower::Init( const TDatime& date )
 {
+  // Pedestals are calculated on the first event that is not a pedestal
+  // event, also from the sums restored by a resumed replay
+  fAnalyzePedestals = 1;
+
+  // Nothing to do if the parameters and the detector map are unchanged
+  // since the last successful Init
+  if( fParmUsage.IsUpToDate() ) {
+    fParmUsage.Reuse();
+    return fStatus = kOK;
+  }
+  fParmUsage.Start();
+
   Setup(GetName(), GetTitle());
 
   char EngineDID[] = "xCAL";
@@ -135,6 +146,7 @@ THaAnalysisObject::EStatus THcShower::Init( const TDatime& date )
   if( gHcDetectorMap->FillMap(fDetMap, EngineDID) < 0 ) {
     static const char* const here = "Init()";
     Error( Here(here), "Error filling detectormap for %s.", EngineDID );
+    fParmUsage.Stop(kFALSE);
     return kInitError;
   }
 
@@ -144,20 +156,30 @@ THaAnalysisObject::EStatus THcShower::Init( const TDatime& date )
   InitHitList(fDetMap, "THcRawShowerHit", fDetMap->GetTotNumChan()+1);
 
   EStatus status;
-  if( (status = THaNonTrackingDetector::Init( date )) )
+  if( (status = THaNonTrackingDetector::Init( date )) ) {
+    fParmUsage.Stop(kFALSE);
     return fStatus=status;
+  }
 
   for(UInt_t ip=0;ip<fNLayers;ip++) {
     if((status = fPlanes[ip]->Init( date ))) {
+      fParmUsage.Stop(kFALSE);
       return fStatus=status;
     }
   }
   if(fHasArray) {
     if((status = fArray->Init( date ))) {
+      fParmUsage.Stop(kFALSE);
       return fStatus = status;
     }
   }
 
+  // Tracks are projected to the front of the first and the last layer by
+  // the spectrometer, for cluster matching and the fiducial volume test.
+  THcHallCSpectrometer *app = static_cast<THcHallCSpectrometer*>(GetApparatus());
+  fProjFront = app->AddProjectionPlane(fLayerZPos[0]);
+  fProjBack  = app->AddProjectionPlane(fLayerZPos[fNLayers-1]);
+
   if(fHasArray) {
     cout << "THcShower::Init: adjustment of fiducial volume limits to the fly's eye part." << endl;
     cout << "  Old limits:" << endl;
@@ -177,6 +199,7 @@ THaAnalysisObject::EStatus THcShower::Init( const TDatime& date )
        <<  GetName() << endl;
   cout << "---------------------------------------------------------------\n";
 
+  fParmUsage.Stop(kTRUE);
   return fStatus = kOK;
 }
 
@@ -565,14 +588,12 @@ void THcShower::Clear(Option_t* opt)
   fEtotNorm = 0.;
   fEtrack = 0.;
 
-  // Purge cluster list
+  // Purge cluster list, recycle hits and clusters for the next event.
 
-  for (THcShowerClusterListIt i=fClusterList->begin(); i!=fClusterList->end();
-       ++i) {
-    delete *i;
-    *i = 0;
-  }
   fClusterList->clear();
+  fClusterPool.Clear();
+  fHitPool.Clear();
+  fHitSet.clear();
 
 }
 
@@ -638,7 +659,8 @@ Int_t THcShower::CoarseProcess( TClonesArray& tracks)
 
   // Fill set of unclustered hits.
 
-  THcShowerHitSet HitSet;
+  THcShowerHitSet& HitSet = fHitSet;
+  HitSet.clear();
 
   for(UInt_t j=0; j < fNLayers; j++) {
 
@@ -665,9 +687,10 @@ Int_t THcShower::CoarseProcess( TClonesArray& tracks)
 	Double_t x = fXPos[j][i] + BlockThick[j]/2.;        //top + thick/2
 	Double_t z = fLayerZPos[j] + BlockThick[j]/2.;      //front + thick/2
 
-	THcShowerHit* hit = new THcShowerHit(i,j,x,z,Edep,Epos,Eneg);
+	THcShowerHit* hit = fHitPool.Next();
+	hit->Set(i,j,x,z,Edep,Epos,Eneg);
 
-	HitSet.insert(hit);   //<set> version
+	HitSet.push_back(hit);
       }
 
     }
@@ -683,7 +706,7 @@ Int_t THcShower::CoarseProcess( TClonesArray& tracks)
 	 << GetApparatus()->GetName() << endl;
 
     cout << "  List of unclustered hits. Total hits:     " << fNhits << endl;
-    THcShowerHitIt it = HitSet.begin();    //<set> version
+    THcShowerHitIt it = HitSet.begin();
     for (Int_t i=0; i!=fNhits; i++) {
       cout << "  hit " << i << ": ";
       (*(it++))->show();
@@ -692,7 +715,7 @@ Int_t THcShower::CoarseProcess( TClonesArray& tracks)
 
   // Fill list of clusters.
 
-  ClusterHits(HitSet, fClusterList);
+  ClusterHits(HitSet, fClusterList, fClusterPool);
 
   fNclust = (*fClusterList).size();   //number of clusters
 
@@ -736,18 +759,20 @@ Int_t THcShower::CoarseProcess( TClonesArray& tracks)
 //-----------------------------------------------------------------------------
 
 void THcShower::ClusterHits(THcShowerHitSet& HitSet,
-			    THcShowerClusterList* ClusterList) {
+			    THcShowerClusterList* ClusterList,
+			    THcShowerClusterPool& ClusterPool) {
 
   // Collect hits from the HitSet into the clusters. The resultant clusters
-  // of hits are saved in the ClusterList.
+  // of hits are saved in the ClusterList. Cluster objects are taken from
+  // the ClusterPool, the caller is responsible for recycling the pool.
 
   while (HitSet.size() != 0) {
 
-    THcShowerCluster* cluster = new THcShowerCluster;
+    THcShowerCluster* cluster = ClusterPool.Next();
+    cluster->Reset();
 
-    THcShowerHitIt it = HitSet.end();
-    (*cluster).insert(*(--it));   //Move the last hit from the hit list
-    HitSet.erase(it);             //into the 1st cluster
+    (*cluster).push_back(HitSet.back());  //Move the last hit from the hit list
+    HitSet.pop_back();                    //into the 1st cluster
 
     bool clustered = true;
 
@@ -762,7 +787,7 @@ void THcShower::ClusterHits(THcShowerHitSet& HitSet,
 
 	  if ((**i).isNeighbour(*k)) {
 
-	    (*cluster).insert(*i);      //If the hit #i is neighbouring a hit
+	    (*cluster).push_back(*i);   //If the hit #i is neighbouring a hit
 	    HitSet.erase(i);            //in the cluster, then move it
 	                                //into the cluster.
 	    clustered = true;
@@ -776,6 +801,8 @@ void THcShower::ClusterHits(THcShowerHitSet& HitSet,
 
     }                                   //while clustered
 
+    cluster->Summarize();              //Cache cluster energy and position
+
     ClusterList->push_back(cluster);   //Put the cluster in the cluster list
 
   }                                     //While hit_list not exhausted
@@ -784,40 +811,12 @@ void THcShower::ClusterHits(THcShowerHitSet& HitSet,
 
 //-----------------------------------------------------------------------------
 
-// Various helper functions to accumulate hit related quantities.
-
-Double_t addE(Double_t x, THcShowerHit* h) {
-  return x + h->hitE();
-}
-
-Double_t addX(Double_t x, THcShowerHit* h) {
-  return x + h->hitE() * h->hitX();
-}
-
-Double_t addZ(Double_t x, THcShowerHit* h) {
-  return x + h->hitE() * h->hitZ();
-}
-
-Double_t addEpr(Double_t x, THcShowerHit* h) {
-  return h->hitColumn() == 0 ? x + h->hitE() : x;
-}
-
-Double_t addEpos(Double_t x, THcShowerHit* h) {
-  return x + h->hitEpos();
-}
-
-Double_t addEneg(Double_t x, THcShowerHit* h) {
-  return x + h->hitEneg();
-}
-
 // X coordinate of center of gravity of cluster, calculated as hit energy
 // weighted average. Put X out of the calorimeter (-100 cm), if there is no
 // energy deposition in the cluster.
 //
 Double_t clX(THcShowerCluster* cluster) {
-  Double_t Etot = accumulate((*cluster).begin(),(*cluster).end(),0.,addE);
-  return (Etot != 0. ?
-	  accumulate((*cluster).begin(),(*cluster).end(),0.,addX)/Etot : -100.);
+  return cluster->GetX();
 }
 
 // Z coordinate of center of gravity of cluster, calculated as a hit energy
@@ -825,21 +824,19 @@ Double_t clX(THcShowerCluster* cluster) {
 // deposition in the cluster.
 //
 Double_t clZ(THcShowerCluster* cluster) {
-  Double_t Etot = accumulate((*cluster).begin(),(*cluster).end(),0.,addE);
-  return (Etot != 0. ?
-	  accumulate((*cluster).begin(),(*cluster).end(),0.,addZ)/Etot : 0.);
+  return cluster->GetZ();
 }
 
 //Energy depostion in a cluster
 //
 Double_t clE(THcShowerCluster* cluster) {
-    return accumulate((*cluster).begin(),(*cluster).end(),0.,addE);
+  return cluster->GetE();
 }
 
 //Energy deposition in the Preshower (1st plane) for a cluster
 //
 Double_t clEpr(THcShowerCluster* cluster) {
-    return accumulate((*cluster).begin(),(*cluster).end(),0.,addEpr);
+  return cluster->GetEpr();
 }
 
 //Cluster energy deposition in plane iplane=0,..,3:
@@ -855,24 +852,19 @@ Double_t clEplane(THcShowerCluster* cluster, Int_t iplane, Int_t side) {
     return -1;
   }
 
-  THcShowerHitSet pcluster;
-  for (THcShowerHitIt it=(*cluster).begin(); it!=(*cluster).end(); ++it) {
-    if ((*it)->hitColumn() == iplane) pcluster.insert(*it);
-  }
-
-  Double_t Eplane;
-  switch (side) {
-  case 0 :
-    Eplane = accumulate(pcluster.begin(),pcluster.end(),0.,addEpos);
-    break;
-  case 1 :
-    Eplane = accumulate(pcluster.begin(),pcluster.end(),0.,addEneg);
-    break;
-  case 2 :
-    Eplane = accumulate(pcluster.begin(),pcluster.end(),0.,addE);
-    break;
-  default :
-    Eplane = 0. ;
+  Double_t Eplane = 0.;
+  for (THcShowerClusterIt it=(*cluster).begin(); it!=(*cluster).end(); ++it) {
+    if ((*it)->hitColumn() != iplane) continue;
+    switch (side) {
+    case 0 :
+      Eplane += (*it)->hitEpos();
+      break;
+    case 1 :
+      Eplane += (*it)->hitEneg();
+      break;
+    default :
+      Eplane += (*it)->hitE();
+    }
   }
 
   return Eplane;
@@ -886,21 +878,21 @@ Int_t THcShower::MatchCluster(THaTrack* Track,
   // Match a cluster to a given track. Return the cluster number,
   // and track coordinates at the front of calorimeter.
 
-  XTrFront = kBig;
-  YTrFront = kBig;
-  Double_t pathl = kBig;
-
-  // Track interception with face of the calorimeter. The coordinates are
-  // in the calorimeter's local system.
+  // Track interception with face of the calorimeter, in the spectrometer's
+  // coordinate system. Taken from the spectrometer's track projections.
 
-  fOrigin = fPlanes[0]->GetOrigin();
-
-  CalcTrackIntercept(Track, pathl, XTrFront, YTrFront);
-
-  // Transform coordiantes to the spectrometer's coordinate system.
+  THcHallCSpectrometer *app = static_cast<THcHallCSpectrometer*>(GetApparatus());
+  const THcTrackProjection* proj = app->GetTrackProjection();
 
-  XTrFront += GetOrigin().X();
-  YTrFront += GetOrigin().Y();
+  Int_t itrack = proj->GetTrackIndex(Track);
+  if (itrack < 0) {
+    XTrFront = kBig;
+    YTrFront = kBig;
+    return -1;
+  }
+  XTrFront = proj->GetX(itrack, fProjFront);
+  YTrFront = proj->GetY(itrack, fProjFront);
+  Double_t pathl = proj->GetPathLength(itrack, fProjFront);
 
   Bool_t inFidVol = true;            // In Fiducial Volume flag
 
@@ -909,17 +901,10 @@ Int_t THcShower::MatchCluster(THaTrack* Track,
   if (fvTest) {
 
     // Track coordinates at the back of the detector.
+    // (At the front of the last layer.)
 
-    // Origin at the front of the last layer.
-    fOrigin = fPlanes[fNLayers-1]->GetOrigin();
-
-    Double_t XTrBack = kBig;
-    Double_t YTrBack = kBig;
-
-    CalcTrackIntercept(Track, pathl, XTrBack, YTrBack);
-
-    XTrBack += GetOrigin().X();   // from local coord. system
-    YTrBack += GetOrigin().Y();   // to the spectrometer system
+    Double_t XTrBack = proj->GetX(itrack, fProjBack);
+    Double_t YTrBack = proj->GetY(itrack, fProjBack);
 
     inFidVol = (XTrFront <= fvXmax) && (XTrFront >= fvXmin) &&
                (YTrFront <= fvYmax) && (YTrFront >= fvYmin) &&
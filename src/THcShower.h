@@ -13,6 +13,7 @@
 #include "THcShowerPlane.h"
 #include "THcShowerArray.h"
 #include "THcShowerHit.h"
+#include "THcParmUsage.h"
 #include "TMath.h"
 
 class THcShower : public THaNonTrackingDetector, public THcHitList {
@@ -132,6 +133,10 @@ protected:
 
   THcShowerClusterList* fClusterList;   // List of hit clusters
 
+  THcShowerHitPool     fHitPool;        //! Recycled hit objects
+  THcShowerClusterPool fClusterPool;    //! Recycled cluster objects
+  THcShowerHitSet      fHitSet;         //! Unclustered hits
+
 
   // Geometrical parameters.
 
@@ -175,6 +180,11 @@ protected:
 
   TClonesArray*  fTrackProj;    // projection of track onto plane
 
+  Int_t fProjFront;             // Spectrometer projection planes at the
+  Int_t fProjBack;              // front of first and last layers
+
+  THcParmUsage fParmUsage;  //! Parameters read by the last Init
+
   void           ClearEvent();
   void           DeleteArrays();
   virtual Int_t  ReadDatabase( const TDatime& date );
@@ -185,7 +195,8 @@ protected:
   // Cluster to track association method.
   Int_t MatchCluster(THaTrack*, Double_t&, Double_t&);
 
-  void ClusterHits(THcShowerHitSet& HitSet, THcShowerClusterList* ClusterList);
+  void ClusterHits(THcShowerHitSet& HitSet, THcShowerClusterList* ClusterList,
+		   THcShowerClusterPool& ClusterPool);
 
   friend class THcShowerPlane;   //to access debug flags.
   friend class THcShowerArray;   //to access debug flags.
@@ -195,13 +206,6 @@ protected:
 
 ///////////////////////////////////////////////////////////////////////////////
 
-// Various helper functions to accumulate hit related quantities.
-
-Double_t addE(Double_t x, THcShowerHit* h);
-Double_t addX(Double_t x, THcShowerHit* h);
-Double_t addZ(Double_t x, THcShowerHit* h);
-Double_t addEpr(Double_t x, THcShowerHit* h);
-
 // Methods to calculate coordinates and energy depositions for a given cluster.
 
 Double_t clX(THcShowerCluster* cluster);
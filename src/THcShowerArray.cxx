@@ -12,6 +12,7 @@ Fly's eye array of shower blocks
 #include "THcParmList.h"
 #include "THcHitList.h"
 #include "THcShower.h"
+#include "THcHallCSpectrometer.h"
 #include "THcRawShowerHit.h"
 #include "TClass.h"
 #include "math.h"
@@ -92,6 +93,14 @@ THaAnalysisObject::EStatus THcShowerArray::Init( const TDatime& date )
   if( (status=THaSubDetector::Init( date )) )
     return fStatus = status;
 
+  // Tracks are projected to the front and the back of the array by the
+  // spectrometer, for cluster matching and the fiducial volume test.
+  THcShower* fParent = (THcShower*) GetParent();
+  THcHallCSpectrometer *app =
+    static_cast<THcHallCSpectrometer*>(fParent->GetApparatus());
+  fProjFront = app->AddProjectionPlane(fZFront);
+  fProjBack  = app->AddProjectionPlane(fZFront + fZSize);
+
   return fStatus = kOK;
 
 }
@@ -360,12 +369,10 @@ void THcShowerArray::Clear( Option_t* )
   fNclust = 0;
   fNtracks = 0;
 
-  for (THcShowerClusterListIt i=fClusterList->begin(); i!=fClusterList->end();
-       ++i) {
-    delete *i;
-    *i = 0;
-  }
   fClusterList->clear();
+  fClusterPool.Clear();
+  fHitPool.Clear();
+  fHitSet.clear();
 
   frAdcPedRaw->Clear();
   frAdcPulseIntRaw->Clear();
@@ -396,7 +403,8 @@ Int_t THcShowerArray::CoarseProcess( TClonesArray& tracks )
   // Save energy deposition in the module as hit mean energy, do not use
   // positive and negative side energies.
 
-  THcShowerHitSet HitSet;         //set of hits
+  THcShowerHitSet& HitSet = fHitSet;         //set of hits
+  HitSet.clear();
 
   UInt_t k=0;
   for (UInt_t i=0; i<fNRows; i++) {
@@ -404,10 +412,10 @@ Int_t THcShowerArray::CoarseProcess( TClonesArray& tracks )
 
       if (fA_p[k] > 0) {    //hit
 
-	THcShowerHit* hit =
-	  new THcShowerHit(i, j, fXPos[i][j], fYPos[i][j], fE[k], 0., 0.);
+	THcShowerHit* hit = fHitPool.Next();
+	hit->Set(i, j, fXPos[i][j], fYPos[i][j], fE[k], 0., 0.);
 
-	HitSet.insert(hit);
+	HitSet.push_back(hit);
       }
 
       k++;
@@ -426,7 +434,7 @@ Int_t THcShowerArray::CoarseProcess( TClonesArray& tracks )
 	 << endl;
 
     cout << "  List of unclustered hits. Total hits:     " << fNhits << endl;
-    THcShowerHitIt it = HitSet.begin();    //<set> version
+    THcShowerHitIt it = HitSet.begin();
     for (Int_t i=0; i!=fNhits; i++) {
       cout << "  hit " << i << ": ";
       (*(it++))->show();
@@ -435,7 +443,7 @@ Int_t THcShowerArray::CoarseProcess( TClonesArray& tracks )
 
   // Cluster hits and fill list of clusters.
 
-  fParent->ClusterHits(HitSet, fClusterList);
+  fParent->ClusterHits(HitSet, fClusterList, fClusterPool);
 
   fNclust = (*fClusterList).size();         //number of clusters
 
@@ -480,23 +488,24 @@ Int_t THcShowerArray::MatchCluster(THaTrack* Track,
   // Match an Array cluster to a given track. Return the cluster number,
   // and track coordinates at the front of Array.
 
-  XTrFront = kBig;
-  YTrFront = kBig;
-  Double_t pathl = kBig;
-
-  // Track interception with face of Array. The coordinates are
-  // in the Array's local system.
-
-  fOrigin = GetOrigin();
-
   THcShower* fParent = (THcShower*) GetParent();
 
-  fParent->CalcTrackIntercept(Track, pathl, XTrFront, YTrFront);
+  // Track interception with face of Array, in the spectrometer's
+  // coordinate system. Taken from the spectrometer's track projections.
 
-  // Transform coordiantes to the spectrometer's coordinate system.
+  THcHallCSpectrometer *app =
+    static_cast<THcHallCSpectrometer*>(fParent->GetApparatus());
+  const THcTrackProjection* proj = app->GetTrackProjection();
 
-  XTrFront += GetOrigin().X();
-  YTrFront += GetOrigin().Y();
+  Int_t itrack = proj->GetTrackIndex(Track);
+  if (itrack < 0) {
+    XTrFront = kBig;
+    YTrFront = kBig;
+    return -1;
+  }
+  XTrFront = proj->GetX(itrack, fProjFront);
+  YTrFront = proj->GetY(itrack, fProjFront);
+  Double_t pathl = proj->GetPathLength(itrack, fProjFront);
 
   Bool_t inFidVol = true;            // In Fiducial Volume flag
 
@@ -504,27 +513,16 @@ Int_t THcShowerArray::MatchCluster(THaTrack* Track,
 
   if (fParent->fvTest) {
 
-    TVector3 Origin = fOrigin;         //save fOrigin
-
     // Track coordinates at the back of the detector.
 
-    // Origin at the back of counter.
-    fOrigin.SetXYZ(GetOrigin().X(), GetOrigin().Y(), GetOrigin().Z() + fZSize);
-
-    Double_t XTrBack = kBig;
-    Double_t YTrBack = kBig;
-
-    fParent->CalcTrackIntercept(Track, pathl, XTrBack, YTrBack);
-
-    XTrBack += GetOrigin().X();   // from local coord. system
-    YTrBack += GetOrigin().Y();   // to the spectrometer system
+    Double_t XTrBack = proj->GetX(itrack, fProjBack);
+    Double_t YTrBack = proj->GetY(itrack, fProjBack);
 
     inFidVol = (XTrFront <= fParent->fvXmax) && (XTrFront >= fParent->fvXmin) &&
                (YTrFront <= fParent->fvYmax) && (YTrFront >= fParent->fvYmin) &&
                (XTrBack <= fParent->fvXmax) && (XTrBack >= fParent->fvXmin) &&
                (YTrBack <= fParent->fvYmax) && (YTrBack >= fParent->fvYmin);
 
-    fOrigin = Origin;         //restore fOrigin
   }
 
   // Match a cluster to the track. Choose closest to the track cluster.
@@ -930,6 +928,8 @@ void THcShowerArray::CalculatePedestals( )
 {
   // Use the accumulated pedestal data to calculate pedestals.
 
+  if(fNPedestalEvents == 0) return;	// Keep the pedestals of the parameters
+
   for(Int_t i=0; i<fNelem;i++) {
 
     fPed[i] = ((Float_t) fPedSum[i]) / TMath::Max(1, fPedCount[i]);
@@ -978,6 +978,17 @@ void THcShowerArray::InitializePedestals( )
     fPedSum2[i] = 0;
     fPedCount[i] = 0;
   }
+
+  // Pedestal sums are run accumulators, saved by replay checkpoints
+  TString base = Form("%ccal_%s_", tolower(GetParent()->GetPrefix()[0]), GetName());
+  gHcParms->DefineAccumulator(base+"ped_events", "Pedestal events",
+			      &fNPedestalEvents, 1);
+  gHcParms->DefineAccumulator(base+"ped_sum", "Pedestal sums",
+			      fPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"ped_sum2", "Pedestal sums of squares",
+			      fPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"ped_count", "Pedestal counts",
+			      fPedCount, fNelem);
 }
 
 //------------------------------------------------------------------------------
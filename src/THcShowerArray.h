@@ -97,6 +97,9 @@ protected:
   Double_t** fXPos;              // block X coordinates
   Double_t** fYPos;              // block Y coordinates
 
+  Int_t fProjFront;              // Spectrometer projection planes at the
+  Int_t fProjBack;               // front and back of the array
+
   Int_t fUsingFADC;		// != 0 if using FADC in sample mode
   Int_t fPedSampLow;		// Sample range for
   Int_t fPedSampHigh;		// dynamic pedestal
@@ -135,6 +138,10 @@ protected:
 
   THcShowerClusterList* fClusterList;   // List of hit clusters
 
+  THcShowerHitPool     fHitPool;        //! Recycled hit objects
+  THcShowerClusterPool fClusterPool;    //! Recycled cluster objects
+  THcShowerHitSet      fHitSet;         //! Unclustered hits
+
   TClonesArray* frAdcPedRaw;
   TClonesArray* frAdcPulseIntRaw;
   TClonesArray* frAdcPulseAmpRaw;
@@ -27,6 +27,18 @@ THcShowerHit::THcShowerHit(Int_t hRow, Int_t hCol, Double_t hX, Double_t hZ,
   fEneg=hEneg;
 }
 
+//____________________________________________________________________________
+void THcShowerHit::Set(Int_t hRow, Int_t hCol, Double_t hX, Double_t hZ,
+		       Double_t hE, Double_t hEpos, Double_t hEneg) {
+  fRow=hRow;
+  fCol=hCol;
+  fX=hX;
+  fZ=hZ;
+  fE=hE;
+  fEpos=hEpos;
+  fEneg=hEneg;
+}
+
 //____________________________________________________________________________
 // Decide if a hit is neighbouring the current hit.
 // Two hits are neighbours if share a side or a corner,
@@ -58,3 +70,24 @@ bool THcShowerHit::operator<(THcShowerHit rhs) const {
   else
     return fRow < rhs.fRow;
 }
+
+//____________________________________________________________________________
+// Calculate cluster energy, Preshower energy and the energy weighted
+// center of gravity in a single pass over the hits. X is put out of the
+// calorimeter (-100 cm) and Z to 0 if there is no energy deposition.
+//
+void THcShowerCluster::Summarize() {
+  Double_t E = 0., Epr = 0., EX = 0., EZ = 0.;
+  for (THcShowerHitIt it=begin(); it!=end(); ++it) {
+    THcShowerHit* h = *it;
+    Double_t e = h->hitE();
+    E += e;
+    EX += e * h->hitX();
+    EZ += e * h->hitZ();
+    if (h->hitColumn() == 0) Epr += e;
+  }
+  fE = E;
+  fEpr = Epr;
+  fX = (E != 0. ? EX/E : -100.);
+  fZ = (E != 0. ? EZ/E : 0.);
+}
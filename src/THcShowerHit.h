@@ -3,7 +3,8 @@
 
 // HMS calorimeter hits, version 2
 
-#include <set>
+#include <vector>
+#include <deque>
 #include <iterator>
 #include <iostream>
 #include <memory>
@@ -30,6 +31,10 @@ public:
     //    cout << " hit destructed" << endl;
   }
 
+  // Re-initialize a recycled hit from the per-event pool.
+  void Set(Int_t hRow, Int_t hCol, Double_t hX, Double_t hZ,
+	   Double_t hE, Double_t hEpos, Double_t hEneg);
+
   Int_t hitColumn() {
     return fCol;
   }
@@ -68,21 +73,89 @@ public:
 
 //____________________________________________________________________________
 
-// Container (collection) of hits and its iterator.
+// Container (collection) of hits and its iterator. Hits are kept in the
+// order they were created.  (The former pointer-keyed <set> was ordered
+// by pointer value, i.e. in no particular order; cluster sums do not
+// depend on the order.)
 //
-typedef set<THcShowerHit*> THcShowerHitSet;
+typedef vector<THcShowerHit*> THcShowerHitSet;
 typedef THcShowerHitSet::iterator THcShowerHitIt;
 
-typedef THcShowerHitSet THcShowerCluster;
+//______________________________________________________________________________
+
+// Cluster of hits. Cluster sums are calculated in one pass over the hits
+// once the cluster is complete (see Summarize), and cached.
+//
+class THcShowerCluster : public THcShowerHitSet {
+
+ public:
+
+  THcShowerCluster() : fE(0.), fEpr(0.), fX(-100.), fZ(0.) {}
+
+  // Empty the cluster, keeping the allocated storage.
+  //
+  void Reset() {
+    clear();
+    fE = fEpr = fZ = 0.;
+    fX = -100.;
+  }
+
+  void Summarize();
+
+  Double_t GetE()   const { return fE; }
+  Double_t GetEpr() const { return fEpr; }
+  Double_t GetX()   const { return fX; }
+  Double_t GetZ()   const { return fZ; }
+
+ private:
+
+  Double_t fE;         // Energy deposition in the cluster
+  Double_t fEpr;       // Energy deposition in the 1-st plane (Preshower)
+  Double_t fX;         // Energy weighted X (-100 if no energy deposition)
+  Double_t fZ;         // Energy weighted Z (0 if no energy deposition)
+};
+
 typedef THcShowerCluster::iterator THcShowerClusterIt;
 
 //______________________________________________________________________________
 
-//Alias for container of clusters and for its iterator
+//Alias for container of clusters and for its iterator. The list does not
+//own the clusters, they belong to a THcShowerClusterPool.
 //
 typedef vector<THcShowerCluster*> THcShowerClusterList;
 typedef THcShowerClusterList::iterator THcShowerClusterListIt;
 
 //______________________________________________________________________________
 
+// Per-event pool of hit and cluster objects. Objects are recycled from
+// event to event: Clear() only rewinds the pool, so that no allocations are
+// made once the pool has grown to the largest event seen. A deque is used
+// so that pointers handed out stay valid while the pool grows.
+//
+template <class T> class THcShowerPool {
+
+ public:
+
+  THcShowerPool() : fNused(0) {}
+
+  T* Next() {
+    if (fNused == fStore.size()) fStore.push_back(T());
+    return &fStore[fNused++];
+  }
+
+  void Clear() { fNused = 0; }
+
+  UInt_t Size() const { return fNused; }
+
+ private:
+
+  deque<T> fStore;
+  UInt_t fNused;
+};
+
+typedef THcShowerPool<THcShowerHit> THcShowerHitPool;
+typedef THcShowerPool<THcShowerCluster> THcShowerClusterPool;
+
+//______________________________________________________________________________
+
 #endif
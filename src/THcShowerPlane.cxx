@@ -636,6 +636,8 @@ void THcShowerPlane::CalculatePedestals( )
   // Use the accumulated pedestal data to calculate pedestals
   // Later add check to see if pedestals have drifted ("Danger Will Robinson!")
 
+  if(fNPedestalEvents == 0) return;	// Keep the pedestals of the parameters
+
   for(Int_t i=0; i<fNelem;i++) {
 
     // Positive tubes
@@ -701,4 +703,21 @@ void THcShowerPlane::InitializePedestals( )
     fNegPedSum2[i] = 0;
     fNegPedCount[i] = 0;
   }
+
+  // Pedestal sums are run accumulators, saved by replay checkpoints
+  TString base = Form("%ccal_%s_", tolower(GetParent()->GetPrefix()[0]), GetName());
+  gHcParms->DefineAccumulator(base+"ped_events", "Pedestal events",
+			      &fNPedestalEvents, 1);
+  gHcParms->DefineAccumulator(base+"pos_ped_sum", "Pos pedestal sums",
+			      fPosPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"pos_ped_sum2", "Pos pedestal sums of squares",
+			      fPosPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"pos_ped_count", "Pos pedestal counts",
+			      fPosPedCount, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_sum", "Neg pedestal sums",
+			      fNegPedSum, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_sum2", "Neg pedestal sums of squares",
+			      fNegPedSum2, fNelem);
+  gHcParms->DefineAccumulator(base+"neg_ped_count", "Neg pedestal counts",
+			      fNegPedCount, fNelem);
 }
@@ -0,0 +1,197 @@
+/** \class THcTaskPool
+    \ingroup Base
+
+ Runs the tasks of a dependency graph on a few threads.
+
+ The graph is set once with SetGraph.  Each Run then starts all tasks
+ without unfinished dependencies, and starts every other task as soon
+ as the last task it depends on is done.  The calling thread works on
+ tasks too, and Run returns when all tasks have finished.  THcAnalyzer
+ uses this to reconstruct independent apparatuses of an event at the
+ same time.  Threads without work spin briefly before sleeping, since
+ tasks of consecutive events follow each other closely.
+
+*/
+
+#include "THcTaskPool.h"
+#include <sched.h>
+
+using namespace std;
+
+//_____________________________________________________________________________
+THcTaskPool::THcTaskPool( Int_t nthreads ) :
+  fQuit(kFALSE), fNReady(0), fNSleeping(0), fRemaining(0), fFunc(0), fArg(0)
+{
+  // Constructor.  Starts nthreads-1 worker threads.
+
+  pthread_mutex_init(&fMutex, 0);
+  pthread_cond_init(&fCond, 0);
+  for( Int_t i = 1; i < nthreads; i++ ) {
+    pthread_t thread;
+    if( pthread_create(&thread, 0, WorkerMain, this) != 0 ) break;
+    fThreads.push_back(thread);
+  }
+}
+
+//_____________________________________________________________________________
+THcTaskPool::~THcTaskPool()
+{
+  // Destructor.  Stops the worker threads.
+
+  pthread_mutex_lock(&fMutex);
+  __atomic_store_n(&fQuit, kTRUE, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&fCond);
+  pthread_mutex_unlock(&fMutex);
+  for( UInt_t i = 0; i < fThreads.size(); i++ )
+    pthread_join(fThreads[i], 0);
+  pthread_cond_destroy(&fCond);
+  pthread_mutex_destroy(&fMutex);
+}
+
+//_____________________________________________________________________________
+Bool_t THcTaskPool::SetGraph( const vector< vector<Int_t> >& after )
+{
+  // Set the tasks and their dependencies
+
+  Int_t ntasks = after.size();
+  fSuccessors.assign(ntasks, vector<Int_t>());
+  fNPred.assign(ntasks, 0);
+  for( Int_t i = 0; i < ntasks; i++ ) {
+    for( UInt_t k = 0; k < after[i].size(); k++ ) {
+      Int_t j = after[i][k];
+      if( j < 0 || j >= ntasks || j == i ) continue;
+      fSuccessors[j].push_back(i);
+      fNPred[i]++;
+    }
+  }
+
+  // Every task must become ready eventually
+  vector<Int_t> count(fNPred), ready;
+  for( Int_t i = 0; i < ntasks; i++ )
+    if( count[i] == 0 ) ready.push_back(i);
+  for( UInt_t k = 0; k < ready.size(); k++ ) {
+    const vector<Int_t>& succ = fSuccessors[ready[k]];
+    for( UInt_t s = 0; s < succ.size(); s++ )
+      if( --count[succ[s]] == 0 ) ready.push_back(succ[s]);
+  }
+  if( (Int_t)ready.size() != ntasks ) {
+    fSuccessors.clear();
+    fNPred.clear();
+    return kFALSE;
+  }
+  return kTRUE;
+}
+
+//_____________________________________________________________________________
+void THcTaskPool::Run( Func_t func, void* arg )
+{
+  // Run all tasks
+
+  pthread_mutex_lock(&fMutex);
+  fFunc = func;
+  fArg = arg;
+  fCount = fNPred;
+  __atomic_store_n(&fRemaining, (Int_t)fNPred.size(), __ATOMIC_RELEASE);
+  fReady.clear();
+  for( Int_t i = fRemaining-1; i >= 0; i-- )
+    if( fCount[i] == 0 ) fReady.push_back(i);
+  __atomic_store_n(&fNReady, (Int_t)fReady.size(), __ATOMIC_RELEASE);
+  if( fNSleeping > 0 )
+    pthread_cond_broadcast(&fCond);
+
+  while( fRemaining > 0 ) {
+    if( fReady.empty() ) {
+      WaitForWork();
+      continue;
+    }
+    Int_t task = TakeTask();
+    pthread_mutex_unlock(&fMutex);
+    func(arg, task);
+    pthread_mutex_lock(&fMutex);
+    Finish(task);
+  }
+  fFunc = 0;
+  pthread_mutex_unlock(&fMutex);
+}
+
+//_____________________________________________________________________________
+void THcTaskPool::Finish( Int_t task )
+{
+  // Mark task as done and release the tasks waiting for it.  Called with
+  // the mutex held.
+
+  __atomic_store_n(&fRemaining, fRemaining-1, __ATOMIC_RELEASE);
+  Bool_t wake = (fRemaining == 0);
+  const vector<Int_t>& succ = fSuccessors[task];
+  for( UInt_t s = 0; s < succ.size(); s++ ) {
+    if( --fCount[succ[s]] == 0 ) {
+      fReady.push_back(succ[s]);
+      wake = kTRUE;
+    }
+  }
+  __atomic_store_n(&fNReady, (Int_t)fReady.size(), __ATOMIC_RELEASE);
+  if( wake && fNSleeping > 0 )
+    pthread_cond_broadcast(&fCond);
+}
+
+//_____________________________________________________________________________
+Int_t THcTaskPool::TakeTask()
+{
+  // Remove a task from the ready list.  Called with the mutex held.
+
+  Int_t task = fReady.back();
+  fReady.pop_back();
+  __atomic_store_n(&fNReady, (Int_t)fReady.size(), __ATOMIC_RELEASE);
+  return task;
+}
+
+//_____________________________________________________________________________
+void THcTaskPool::WaitForWork()
+{
+  // Wait for a change of the ready list or the end of a Run.  Called
+  // with the mutex held.  Spins for a while before sleeping.
+
+  Int_t remaining = fRemaining;
+  pthread_mutex_unlock(&fMutex);
+  for( Int_t spins = 0; spins < 4000; spins++ ) {
+    if( __atomic_load_n(&fNReady, __ATOMIC_ACQUIRE) > 0 ||
+	__atomic_load_n(&fQuit, __ATOMIC_ACQUIRE) ||
+	__atomic_load_n(&fRemaining, __ATOMIC_ACQUIRE) != remaining )
+      break;
+    if( spins % 64 == 63 ) sched_yield();
+  }
+  pthread_mutex_lock(&fMutex);
+  if( fReady.empty() && !fQuit && fRemaining == remaining ) {
+    fNSleeping++;
+    pthread_cond_wait(&fCond, &fMutex);
+    fNSleeping--;
+  }
+}
+
+//_____________________________________________________________________________
+void* THcTaskPool::WorkerMain( void* pool )
+{
+  static_cast<THcTaskPool*>(pool)->WorkLoop();
+  return 0;
+}
+
+//_____________________________________________________________________________
+void THcTaskPool::WorkLoop()
+{
+  // Worker thread: take ready tasks until the pool is deleted
+
+  pthread_mutex_lock(&fMutex);
+  for(;;) {
+    while( !fQuit && fReady.empty() )
+      WaitForWork();
+    if( fQuit ) break;
+    Int_t task = TakeTask();
+    Func_t func = fFunc;
+    void* arg = fArg;
+    pthread_mutex_unlock(&fMutex);
+    func(arg, task);
+    pthread_mutex_lock(&fMutex);
+    Finish(task);
+  }
+  pthread_mutex_unlock(&fMutex);
+}
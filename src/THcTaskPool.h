@@ -0,0 +1,62 @@
+#ifndef ROOT_THcTaskPool
+#define ROOT_THcTaskPool
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcTaskPool
+//
+// Small thread pool that runs a fixed graph of tasks, each task
+// starting once the tasks it depends on have finished.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <pthread.h>
+#include <vector>
+
+class THcTaskPool {
+
+public:
+  typedef void (*Func_t)( void* arg, Int_t task );
+
+  // nthreads threads in all, including the one calling Run
+  THcTaskPool( Int_t nthreads );
+  ~THcTaskPool();
+
+  // Tasks 0..after.size()-1; task i runs after the tasks listed in
+  // after[i].  Returns kFALSE if the dependencies contain a cycle.
+  Bool_t SetGraph( const std::vector< std::vector<Int_t> >& after );
+
+  // Run func(arg,i) for all tasks of the graph and wait until all are done
+  void   Run( Func_t func, void* arg );
+
+  Int_t  GetNThreads() const { return fThreads.size()+1; }
+
+protected:
+  std::vector<pthread_t> fThreads;
+  pthread_mutex_t fMutex;
+  pthread_cond_t  fCond;
+  Bool_t   fQuit;
+
+  std::vector< std::vector<Int_t> > fSuccessors;  // Tasks waiting for task i
+  std::vector<Int_t> fNPred;      // Number of tasks task i waits for
+  std::vector<Int_t> fCount;      // Of those, still running, in this Run
+  std::vector<Int_t> fReady;      // Tasks ready to start
+  Int_t    fNReady;               // Size of fReady, for spinning threads
+  Int_t    fNSleeping;            // Threads waiting on fCond
+  Int_t    fRemaining;            // Tasks of this Run not finished
+  Func_t   fFunc;
+  void*    fArg;
+
+  void         WorkLoop();
+  void         Finish( Int_t task );
+  Int_t        TakeTask();
+  void         WaitForWork();
+  static void* WorkerMain( void* pool );
+
+private:
+  THcTaskPool( const THcTaskPool& );
+  THcTaskPool& operator=( const THcTaskPool& );
+};
+
+#endif
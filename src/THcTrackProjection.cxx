@@ -0,0 +1,118 @@
+/** \class THcTrackProjection
+    \ingroup Base
+
+ Projections of the focal plane tracks to the detector planes.
+
+ Detectors register the z positions at which they need track coordinates
+ with THcHallCSpectrometer::AddProjectionPlane, normally during
+ initialization. Planes at the same z are shared. Once per event, after
+ tracking, THcHallCSpectrometer::GetTrackProjection computes the
+ intersection of every track with every registered plane,
+
+     x = x_fp + theta*z,   y = y_fp + phi*z,
+
+ in one pass over structure-of-arrays buffers. All detectors then read the
+ cached coordinates instead of projecting the tracks themselves.
+
+ Projections are stored by track number (THaTrack::GetTrkNum()), so they
+ can still be looked up after the tracks have been sorted.
+
+*/
+
+#include "THcTrackProjection.h"
+
+#include "THaTrack.h"
+#include "TClonesArray.h"
+#include "TMath.h"
+
+using namespace std;
+
+//_____________________________________________________________________________
+THcTrackProjection::THcTrackProjection() : fValid(kFALSE), fNtracks(0)
+{
+  // Constructor
+}
+
+//_____________________________________________________________________________
+THcTrackProjection::~THcTrackProjection()
+{
+  // Destructor
+}
+
+//_____________________________________________________________________________
+Int_t THcTrackProjection::AddPlane( Double_t z )
+{
+  // Register a plane at z and return its index. A plane already
+  // registered at the same z is reused.
+
+  for(UInt_t ip=0;ip<fZ.size();ip++) {
+    if(TMath::Abs(fZ[ip]-z) < 1.e-6) return ip;
+  }
+  fZ.push_back(z);
+  fValid = kFALSE;
+  return fZ.size()-1;
+}
+
+//_____________________________________________________________________________
+Int_t THcTrackProjection::GetTrackIndex( const THaTrack* track ) const
+{
+  // Index of track in the projection arrays, or -1 if the track is not
+  // one of the tracks projected
+
+  Int_t itrack = track->GetTrkNum()-1;
+  if(itrack < 0 || itrack >= fNtracks) return -1;
+  return itrack;
+}
+
+//_____________________________________________________________________________
+Double_t THcTrackProjection::GetPathLength( Int_t itrack, Int_t iplane ) const
+{
+  // Path length along track itrack from the focal plane (z = 0) to the
+  // plane iplane
+
+  return fZ[iplane]*TMath::Sqrt(1.0 + fTheta[itrack]*fTheta[itrack] +
+				fPhi[itrack]*fPhi[itrack]);
+}
+
+//_____________________________________________________________________________
+void THcTrackProjection::Compute( const TClonesArray& tracks )
+{
+  // Project all tracks to all registered planes
+
+  fNtracks = tracks.GetLast()+1;
+  const Int_t nplanes = fZ.size();
+
+  fX0.resize(fNtracks);
+  fY0.resize(fNtracks);
+  fTheta.resize(fNtracks);
+  fPhi.resize(fNtracks);
+  fX.resize(nplanes*fNtracks);
+  fY.resize(nplanes*fNtracks);
+
+  for(Int_t it=0;it<fNtracks;it++) {
+    const THaTrack* track = static_cast<const THaTrack*>( tracks.At(it) );
+    Int_t itrack = track->GetTrkNum()-1;
+    if(itrack < 0 || itrack >= fNtracks) itrack = it;
+    fX0[itrack] = track->GetX();
+    fY0[itrack] = track->GetY();
+    fTheta[itrack] = track->GetTheta();
+    fPhi[itrack] = track->GetPhi();
+  }
+
+  if(fNtracks > 0) {
+    const Double_t* x0 = &fX0[0];
+    const Double_t* y0 = &fY0[0];
+    const Double_t* th = &fTheta[0];
+    const Double_t* ph = &fPhi[0];
+    for(Int_t ip=0;ip<nplanes;ip++) {
+      const Double_t z = fZ[ip];
+      Double_t* x = &fX[ip*fNtracks];
+      Double_t* y = &fY[ip*fNtracks];
+      for(Int_t it=0;it<fNtracks;it++) {
+	x[it] = x0[it] + th[it]*z;
+	y[it] = y0[it] + ph[it]*z;
+      }
+    }
+  }
+  fValid = kTRUE;
+}
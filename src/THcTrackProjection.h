@@ -0,0 +1,62 @@
+#ifndef ROOT_THcTrackProjection
+#define ROOT_THcTrackProjection
+
+//////////////////////////////////////////////////////////////////////////
+//
+// THcTrackProjection
+//
+// Projections of the focal plane tracks of an event to the z positions
+// of the detector planes of a spectrometer.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "Rtypes.h"
+#include <vector>
+
+class TClonesArray;
+class THaTrack;
+
+class THcTrackProjection {
+
+public:
+  THcTrackProjection();
+  ~THcTrackProjection();
+
+  Int_t  AddPlane( Double_t z );
+  Int_t  GetNPlanes() const { return fZ.size(); }
+  Double_t GetPlaneZ( Int_t iplane ) const { return fZ[iplane]; }
+
+  void   Compute( const TClonesArray& tracks );
+  void   Invalidate() { fValid = kFALSE; }
+  Bool_t IsValid() const { return fValid; }
+
+  Int_t  GetNTracks() const { return fNtracks; }
+  // Index of track, or -1 if it was not projected
+  Int_t  GetTrackIndex( const THaTrack* track ) const;
+
+  // Track coordinates at plane iplane
+  Double_t GetX( Int_t itrack, Int_t iplane ) const
+  { return fX[iplane*fNtracks+itrack]; }
+  Double_t GetY( Int_t itrack, Int_t iplane ) const
+  { return fY[iplane*fNtracks+itrack]; }
+  // Path length along the track from the focal plane to plane iplane
+  Double_t GetPathLength( Int_t itrack, Int_t iplane ) const;
+
+protected:
+
+  Bool_t fValid;                  // Projections are for the current event
+  Int_t  fNtracks;                // Number of tracks projected
+  std::vector<Double_t> fZ;       // [nplanes] z positions of planes
+
+  // Track parameters at the focal plane, [fNtracks]
+  std::vector<Double_t> fX0;
+  std::vector<Double_t> fY0;
+  std::vector<Double_t> fTheta;
+  std::vector<Double_t> fPhi;
+
+  // Projected coordinates, [nplanes][fNtracks]
+  std::vector<Double_t> fX;
+  std::vector<Double_t> fY;
+};
+
+#endif